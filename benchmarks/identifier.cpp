@@ -0,0 +1,86 @@
+// Measures the cost of constructing an Identifier.
+//
+// Compares the escape check used by the Identifier constructor (character
+// class table and compile-time keyword table) against the previous
+// std::regex and std::unordered_set based check, and reports the cost of a
+// complete `make_id`.
+#include <chrono>
+#include <iostream>
+#include <regex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "verilogAST.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+// Previous implementation, kept here as the baseline (with a subset of the
+// keywords, which only makes the baseline faster)
+bool legacy_needs_escape(const std::string &value) {
+  static std::unordered_set<std::string> sKeywords{
+      "always", "and",   "assign", "begin", "case",   "else",   "end",
+      "for",    "if",    "input",  "logic", "module", "or",     "output",
+      "reg",    "table", "while",  "wire",  "xor",    "signed",
+  };
+  static std::regex sSimpleIdentifierRE{"^[a-zA-Z$_][a-zA-Z$_0-9]*$"};
+  return sKeywords.count(value) ||
+         !std::regex_match(value, sSimpleIdentifierRE);
+}
+
+template <typename Fn>
+double time_ns(int iterations, const std::vector<std::string> &names, Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    for (const auto &name : names) fn(name);
+  }
+  std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / (static_cast<double>(iterations) * names.size());
+}
+
+}  // namespace
+
+int main() {
+  const int iterations = 20;
+  std::vector<std::string> names;
+  for (int i = 0; i < 50000; i++) {
+    switch (i % 8) {
+      case 0:
+        names.push_back("or");
+        break;
+      case 1:
+        names.push_back("inst_" + std::to_string(i) + "[0]");
+        break;
+      default:
+        names.push_back("wire_" + std::to_string(i) + "_out");
+    }
+  }
+
+  std::size_t escaped = 0;
+  double legacy = time_ns(iterations, names, [&](const std::string &name) {
+    escaped += legacy_needs_escape(name);
+  });
+  std::size_t new_escaped = 0;
+  double table = time_ns(iterations, names, [&](const std::string &name) {
+    new_escaped += vAST::Identifier::needsEscape(name);
+  });
+  if (escaped != new_escaped) {
+    std::cerr << "Escape checks disagree" << std::endl;
+    return 1;
+  }
+  std::size_t length = 0;
+  double make_id = time_ns(iterations, names, [&](const std::string &name) {
+    length += vAST::make_id(name)->value.str().size();
+  });
+
+  std::cout << "escape check, " << names.size() << " names" << std::endl;
+  std::cout << "  regex + unordered_set: " << legacy << " ns/id" << std::endl;
+  std::cout << "  char table + keywords: " << table << " ns/id" << std::endl;
+  std::cout << "  speedup:               " << legacy / table << "x"
+            << std::endl;
+  std::cout << "make_id (check + interning + allocation): " << make_id
+            << " ns/id" << std::endl;
+  return length == 0;
+}
@@ -0,0 +1,100 @@
+// Measures emission of deeply nested If statements.
+//
+// Compares the sink based printer (which carries the indentation level down
+// the tree) against the previous string based scheme, where every enclosing If
+// re-indented its children's rendered text line by line with add_tab().
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include "verilogAST.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+std::unique_ptr<vAST::If> make_nested_if(int depth, int width) {
+  std::vector<std::unique_ptr<vAST::BehavioralStatement>> body;
+  for (int i = 0; i < width; i++) {
+    body.push_back(std::make_unique<vAST::BlockingAssign>(
+        vAST::make_id("x" + std::to_string(i)),
+        vAST::make_binop(vAST::make_id("a"), vAST::BinOp::ADD,
+                         vAST::make_num(std::to_string(depth)))));
+  }
+  if (depth > 1) body.push_back(make_nested_if(depth - 1, width));
+  std::vector<std::unique_ptr<vAST::BehavioralStatement>> else_body;
+  else_body.push_back(std::make_unique<vAST::BlockingAssign>(
+      vAST::make_id("y"), vAST::make_id("b")));
+  return std::make_unique<vAST::If>(
+      vAST::make_id("c" + std::to_string(depth)), std::move(body),
+      std::move(else_body));
+}
+
+// Previous implementation, kept here as the baseline
+std::string add_tab(std::string block) {
+  std::istringstream block_stream(block);
+  std::string new_block;
+  while (!block_stream.eof()) {
+    std::string line;
+    std::getline(block_stream, line);
+    new_block += "    " + line + "\n";
+  }
+  return new_block;
+}
+
+std::string legacy_to_string(vAST::BehavioralStatement &statement);
+
+std::string legacy_body(
+    std::vector<std::unique_ptr<vAST::BehavioralStatement>> &body) {
+  std::string result;
+  for (auto &statement : body) result += add_tab(legacy_to_string(*statement));
+  return result;
+}
+
+std::string legacy_to_string(vAST::BehavioralStatement &statement) {
+  auto if_stmt = dynamic_cast<vAST::If *>(&statement);
+  if (!if_stmt) return statement.toString();
+  std::string if_str = "if (" + if_stmt->cond->toString() + ") begin\n";
+  if_str += legacy_body(if_stmt->true_body) + "end";
+  if (if_stmt->else_body.size()) {
+    if_str += " else begin\n" + legacy_body(if_stmt->else_body) + "end";
+  }
+  return if_str;
+}
+
+template <typename Fn>
+double time_ms(int iterations, Fn fn) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) fn();
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+}  // namespace
+
+int main() {
+  const int depth = 64;
+  const int iterations = 20;
+  auto if_stmt = make_nested_if(depth, 8);
+
+  std::string expected = legacy_to_string(*if_stmt);
+  if (if_stmt->toString() != expected) {
+    std::cerr << "Output mismatch between printers" << std::endl;
+    return 1;
+  }
+
+  double legacy =
+      time_ms(iterations, [&]() { return legacy_to_string(*if_stmt); });
+  double sink = time_ms(iterations, [&]() {
+    std::string result;
+    vAST::StringSink string_sink(result);
+    if_stmt->emit(string_sink);
+    return result;
+  });
+  std::cout << "nested If, depth " << depth << " (" << expected.size()
+            << " bytes)" << std::endl;
+  std::cout << "  add_tab printer: " << legacy << " ms" << std::endl;
+  std::cout << "  sink printer:    " << sink << " ms" << std::endl;
+  std::cout << "  speedup:         " << legacy / sink << "x" << std::endl;
+  return 0;
+}
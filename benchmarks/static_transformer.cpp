@@ -0,0 +1,182 @@
+// Measures the cost of virtual dispatch in Transformer passes.
+//
+// Runs the same passes written against the virtual Transformer and against
+// StaticTransformer, on a large expression tree: an identity pass, a pass
+// renaming identifiers, and the library's ExprInterner (whose expression
+// traversal is a StaticTransformer) compared against the same interning
+// written against the virtual Transformer.
+#include <chrono>
+#include <iostream>
+#include <unordered_map>
+#include "verilogAST.hpp"
+#include "verilogAST/hash_cons.hpp"
+#include "verilogAST/static_transformer.hpp"
+#include "verilogAST/transformer.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+std::unique_ptr<vAST::Expression> make_leaf(int i) {
+  switch (i % 4) {
+    case 0:
+      return vAST::make_id("x" + std::to_string(i % 64));
+    case 1:
+      return std::make_unique<vAST::Index>(
+          vAST::make_id("x"), vAST::make_num(std::to_string(i % 8)));
+    case 2: {
+      std::vector<std::unique_ptr<vAST::Expression>> args;
+      args.push_back(vAST::make_id("y"));
+      return std::make_unique<vAST::CallExpr>("f", std::move(args));
+    }
+    default:
+      return std::make_unique<vAST::UnaryOp>(vAST::make_id("z"),
+                                             vAST::UnOp::INVERT);
+  }
+}
+
+std::unique_ptr<vAST::Expression> make_tree(int depth, int &leaf) {
+  if (depth == 0) return make_leaf(leaf++);
+  auto left = make_tree(depth - 1, leaf);
+  auto right = make_tree(depth - 1, leaf);
+  return vAST::make_binop(std::move(left), vAST::BinOp::ADD, std::move(right));
+}
+
+class VirtualIdentity : public vAST::Transformer {
+ public:
+  using vAST::Transformer::visit;
+};
+
+class StaticIdentity : public vAST::StaticTransformer<StaticIdentity> {
+ public:
+  using vAST::StaticTransformer<StaticIdentity>::visit;
+};
+
+// Swaps the names `y` and `z`, so running it twice restores the tree
+vAST::Symbol swapped(vAST::Symbol name) {
+  static const vAST::Symbol y("y"), z("z");
+  if (name == y) return z;
+  if (name == z) return y;
+  return name;
+}
+
+class VirtualRename : public vAST::Transformer {
+ public:
+  using vAST::Transformer::visit;
+  std::unique_ptr<vAST::Identifier> visit(
+      std::unique_ptr<vAST::Identifier> node) override {
+    node->value = swapped(node->value);
+    return node;
+  }
+};
+
+class StaticRename : public vAST::StaticTransformer<StaticRename> {
+ public:
+  using vAST::StaticTransformer<StaticRename>::visit;
+  std::unique_ptr<vAST::Identifier> visit(
+      std::unique_ptr<vAST::Identifier> node) {
+    node->value = swapped(node->value);
+    return node;
+  }
+};
+
+// ExprInterner written against the virtual Transformer, as it was before it
+// delegated to StaticExprInterner
+class VirtualInterner : public vAST::Transformer {
+  std::unordered_map<const vAST::Expression *,
+                     std::shared_ptr<const vAST::Expression>,
+                     vAST::StructuralHash, vAST::StructuralEqual>
+      table;
+
+ public:
+  using vAST::Transformer::visit;
+  std::unique_ptr<vAST::Expression> visit(
+      std::unique_ptr<vAST::Expression> node) override {
+    if (vAST::isa<vAST::SharedExpr>(node)) {
+      return this->visit(vAST::unique_cast<vAST::SharedExpr>(std::move(node)));
+    }
+    node = Transformer::visit(std::move(node));
+    auto it = this->table.find(node.get());
+    if (it == this->table.end()) {
+      std::shared_ptr<const vAST::Expression> shared = std::move(node);
+      it = this->table.emplace(shared.get(), shared).first;
+    }
+    return std::make_unique<vAST::SharedExpr>(it->second);
+  }
+  std::unique_ptr<vAST::Expression> visit(
+      std::unique_ptr<vAST::SharedExpr> node) override {
+    return node;
+  }
+};
+
+// Runs a new `Pass` over `tree` `iterations` times, in place
+template <typename Pass>
+double time_ms(int iterations, std::unique_ptr<vAST::Expression> &tree) {
+  Pass pass;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) tree = pass.visit(std::move(tree));
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+// Runs a new `Pass` over a copy of `tree` `iterations` times, the copies are
+// not timed
+template <typename Pass>
+double time_copies_ms(int iterations, const vAST::Expression &tree,
+                      std::string &result) {
+  std::chrono::duration<double, std::milli> elapsed{0};
+  for (int i = 0; i < iterations; i++) {
+    auto copy = tree.clone();
+    Pass pass;
+    auto start = std::chrono::steady_clock::now();
+    auto out = pass.visit(std::unique_ptr<vAST::Expression>(std::move(copy)));
+    elapsed += std::chrono::steady_clock::now() - start;
+    if (i == 0) result = out->toString();
+  }
+  return elapsed.count() / iterations;
+}
+
+void report(const std::string &name, double virtual_ms, double static_ms) {
+  std::cout << name << std::endl;
+  std::cout << "  Transformer:       " << virtual_ms << " ms" << std::endl;
+  std::cout << "  StaticTransformer: " << static_ms << " ms" << std::endl;
+  std::cout << "  speedup:           " << virtual_ms / static_ms << "x"
+            << std::endl;
+}
+
+}  // namespace
+
+int main() {
+  const int depth = 18;
+  const int iterations = 10;
+  int leaf = 0;
+  auto tree = make_tree(depth, leaf);
+  std::string expected = tree->toString();
+  std::cout << leaf << " leaves" << std::endl;
+
+  double virtual_identity = time_ms<VirtualIdentity>(iterations, tree);
+  double static_identity = time_ms<StaticIdentity>(iterations, tree);
+  report("identity pass", virtual_identity, static_identity);
+
+  // An even number of iterations, so the names are swapped back
+  double virtual_rename = time_ms<VirtualRename>(iterations, tree);
+  double static_rename = time_ms<StaticRename>(iterations, tree);
+  report("rename pass", virtual_rename, static_rename);
+  if (tree->toString() != expected) {
+    std::cerr << "Tree changed by identity passes" << std::endl;
+    return 1;
+  }
+
+  std::string virtual_result, static_result;
+  double virtual_intern =
+      time_copies_ms<VirtualInterner>(iterations, *tree, virtual_result);
+  double static_intern =
+      time_copies_ms<vAST::ExprInterner>(iterations, *tree, static_result);
+  if (virtual_result != expected || static_result != expected) {
+    std::cerr << "Tree changed by ExprInterner" << std::endl;
+    return 1;
+  }
+  report("ExprInterner", virtual_intern, static_intern);
+  return 0;
+}
@@ -0,0 +1,110 @@
+// Measures the cost of Transformer's expression dispatch.
+//
+// Compares the NodeKind switch used by `Transformer::visit(Expression)`
+// against the previous chain of `dynamic_cast`s, on an identity pass over a
+// large expression tree.
+#include <chrono>
+#include <iostream>
+#include "verilogAST.hpp"
+#include "verilogAST/transformer.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+std::unique_ptr<vAST::Expression> make_leaf(int i) {
+  switch (i % 4) {
+    case 0:
+      return vAST::make_id("x" + std::to_string(i));
+    case 1:
+      return std::make_unique<vAST::Index>(vAST::make_id("x"),
+                                           vAST::make_num(std::to_string(i)));
+    case 2: {
+      std::vector<std::unique_ptr<vAST::Expression>> args;
+      args.push_back(vAST::make_id("y"));
+      return std::make_unique<vAST::CallExpr>("f", std::move(args));
+    }
+    default:
+      return std::make_unique<vAST::UnaryOp>(vAST::make_id("z"),
+                                             vAST::UnOp::INVERT);
+  }
+}
+
+std::unique_ptr<vAST::Expression> make_tree(int depth, int &leaf) {
+  if (depth == 0) return make_leaf(leaf++);
+  auto left = make_tree(depth - 1, leaf);
+  auto right = make_tree(depth - 1, leaf);
+  return vAST::make_binop(std::move(left), vAST::BinOp::ADD, std::move(right));
+}
+
+// Previous implementation, kept here as the baseline
+class DynamicCastDispatch : public vAST::Transformer {
+  template <typename T>
+  bool try_visit(std::unique_ptr<vAST::Expression> &node,
+                 std::unique_ptr<vAST::Expression> &result) {
+    if (auto ptr = dynamic_cast<T *>(node.get())) {
+      node.release();
+      result = this->visit(std::unique_ptr<T>(ptr));
+      return true;
+    }
+    return false;
+  }
+
+ public:
+  using vAST::Transformer::visit;
+  std::unique_ptr<vAST::Expression> visit(
+      std::unique_ptr<vAST::Expression> node) override {
+    std::unique_ptr<vAST::Expression> result;
+    try_visit<vAST::NumericLiteral>(node, result) ||
+        try_visit<vAST::Identifier>(node, result) ||
+        try_visit<vAST::Cast>(node, result) ||
+        try_visit<vAST::Attribute>(node, result) ||
+        try_visit<vAST::String>(node, result) ||
+        try_visit<vAST::Index>(node, result) ||
+        try_visit<vAST::Slice>(node, result) ||
+        try_visit<vAST::BinaryOp>(node, result) ||
+        try_visit<vAST::UnaryOp>(node, result) ||
+        try_visit<vAST::TernaryOp>(node, result) ||
+        try_visit<vAST::Concat>(node, result) ||
+        try_visit<vAST::Replicate>(node, result) ||
+        try_visit<vAST::CallExpr>(node, result);
+    return result;
+  }
+};
+
+class KindDispatch : public vAST::Transformer {
+ public:
+  using vAST::Transformer::visit;
+};
+
+template <typename Pass>
+double time_ms(int iterations, std::unique_ptr<vAST::Expression> &tree) {
+  Pass pass;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) tree = pass.visit(std::move(tree));
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+}  // namespace
+
+int main() {
+  const int depth = 18;
+  const int iterations = 10;
+  int leaf = 0;
+  auto tree = make_tree(depth, leaf);
+  std::string expected = tree->toString();
+
+  double legacy = time_ms<DynamicCastDispatch>(iterations, tree);
+  double kind = time_ms<KindDispatch>(iterations, tree);
+  if (tree->toString() != expected) {
+    std::cerr << "Tree changed by identity pass" << std::endl;
+    return 1;
+  }
+  std::cout << "identity pass, " << leaf << " leaves" << std::endl;
+  std::cout << "  dynamic_cast dispatch: " << legacy << " ms" << std::endl;
+  std::cout << "  NodeKind dispatch:     " << kind << " ms" << std::endl;
+  std::cout << "  speedup:               " << legacy / kind << "x" << std::endl;
+  return 0;
+}
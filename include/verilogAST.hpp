@@ -3,14 +3,22 @@
 #define VERILOGAST_H
 
 #include <algorithm>
+#include <atomic>
+#include <cstddef>
 #include <map>
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <utility>  // std::pair
 #include <variant>
 #include <vector>
 
+#include "verilogAST/bit_vector.hpp"
+#include "verilogAST/sink.hpp"
+#include "verilogAST/symbol.hpp"
+
 namespace verilogAST {
 
 template <typename T>
@@ -21,8 +29,9 @@ class WithComment : public T {
   WithComment(std::unique_ptr<T> node, std::string comment)
       : T(std::move(node)), comment(comment){};
 
-  std::string toString() override {
-    return T::toString() + "/*" + this->comment + "*/";
+  void emit(Sink& sink) const override {
+    T::emit(sink);
+    sink << "/*" << this->comment << "*/";
   };
   ~WithComment(){};
 };
@@ -33,18 +42,211 @@ std::unique_ptr<WithComment<T>> AddComment(std::unique_ptr<T> node,
   return std::make_unique<WithComment<T>>(std::move(node), comment);
 }
 
+// Concrete type of a node, stored in every node so that dispatch and type
+// tests (see `isa`/`dyn_cast` below) do not need RTTI. Kinds of a common base
+// class are kept contiguous so that `classof` is a range check.
+enum class NodeKind {
+  // Expression
+  NumericLiteral,
+  Cast,
+  Identifier,
+  Attribute,
+  String,
+  Slice,
+  Index,
+  BinaryOp,
+  UnaryOp,
+  TernaryOp,
+  Concat,
+  Replicate,
+  CallExpr,
+  SharedExpr,
+  // Expression subclasses other than the ones defined here
+  Expression,
+  // Sensitivity list entries
+  NegEdge,
+  PosEdge,
+  Star,
+  // AbstractPort
+  Port,
+  StringPort,
+  // Vector
+  Vector,
+  NDVector,
+  PackedNDVector,
+  // StructuralStatement subclasses other than the ones defined here
+  StructuralStatement,
+  // StructuralStatement only
+  InlineVerilog,
+  ModuleInstantiation,
+  IfMacro,
+  IfDef,
+  IfNDef,
+  ContinuousAssign,
+  Always,
+  // Comments are both structural and behavioral statements
+  SingleLineComment,
+  BlockComment,
+  // BehavioralStatement only
+  BlockingAssign,
+  NonBlockingAssign,
+  CallStmt,
+  If,
+  // BehavioralStatement subclasses other than the ones defined here
+  BehavioralStatement,
+  // Declaration
+  Declaration,
+  Wire,
+  Reg,
+  // AbstractModule
+  Module,
+  StringBodyModule,
+  StringModule,
+  File,
+  // Assign subclasses other than the ones defined here
+  Assign,
+
+  FirstExpression = NumericLiteral,
+  LastExpression = Expression,
+  FirstStructuralStatement = StructuralStatement,
+  LastStructuralStatement = BlockComment,
+  FirstBehavioralStatement = SingleLineComment,
+  LastBehavioralStatement = BehavioralStatement,
+};
+
 class Node {
+  NodeKind kind;
+
+ protected:
+  explicit Node(NodeKind kind) : kind(kind){};
+
  public:
-  virtual std::string toString() = 0;
+  NodeKind getKind() const { return this->kind; }
+
+  // Writes the Verilog for this node into `sink`
+  virtual void emit(Sink& sink) const = 0;
+  // Convenience wrapper around `emit` that collects the output in a string
+  virtual std::string toString() const;
+
+  // Structural hash and equality: two nodes are equal if they have the same
+  // kind and equal fields (recursively), which is decided without rendering
+  // strings. The defaults fall back to `toString()` and are overridden by all
+  // nodes defined here.
+  virtual std::size_t hash() const;
+  virtual bool structurallyEqual(const Node& other) const;
+
   virtual ~Node() = default;
+
+  // Nodes are allocated in the current thread's ASTContext when one is active
+  // (see verilogAST/ast_context.hpp) and on the heap otherwise
+  static void* operator new(std::size_t size);
+  static void operator delete(void* ptr);
 };
 
+class Statement;
+class SingleLineComment;
+class BlockComment;
+class ContinuousAssign;
+class BlockingAssign;
+class NonBlockingAssign;
+
+// Comments and assigns have two Node (and comments two Statement) subobjects,
+// a `Node *` or `Statement *` to one of them may point to either, so it can't
+// be converted to the classes they derive from with a static_cast
+template <typename T, typename From>
+constexpr bool needs_dynamic_cast() {
+  using Base = std::remove_cv_t<From>;
+  if constexpr (!std::is_base_of_v<Base, T>) {
+    // Cross cast, e.g. from StructuralStatement to Assign
+    return true;
+  } else if constexpr (std::is_same_v<Base, Node> ||
+                       std::is_same_v<Base, Statement>) {
+    return std::is_base_of_v<T, SingleLineComment> ||
+           std::is_base_of_v<T, BlockComment> ||
+           std::is_base_of_v<T, ContinuousAssign> ||
+           std::is_base_of_v<T, BlockingAssign> ||
+           std::is_base_of_v<T, NonBlockingAssign>;
+  } else {
+    return false;
+  }
+}
+
+// Converts `node`, which must be known to be a `T`
+template <typename T, typename From>
+T* node_cast(From* node) {
+  if constexpr (needs_dynamic_cast<T, From>()) {
+    return dynamic_cast<T*>(node);
+  } else {
+    return static_cast<T*>(node);
+  }
+}
+
+// RTTI free replacements for `dynamic_cast` based on `NodeKind`, e.g.
+// `isa<Identifier>(expr)` or `dyn_cast<Index>(expr)`. A null `node` is not an
+// instance of any class (as with `dynamic_cast`). Casts that are ambiguous
+// with a static_cast (see `needs_dynamic_cast`) still use `dynamic_cast`.
+template <typename T, typename From>
+bool isa(const From* node) {
+  // Upcasts are known statically, this also covers classes with two Node bases
+  // (e.g. ContinuousAssign) which can't be converted to `const Node*`
+  if constexpr (std::is_base_of_v<T, From>) {
+    return node != nullptr;
+  } else {
+    return node && T::classof(node);
+  }
+}
+
+template <typename T, typename From>
+bool isa(const std::unique_ptr<From>& node) {
+  return isa<T>(node.get());
+}
+
+template <typename T, typename From>
+T* dyn_cast(From* node) {
+  return isa<T>(node) ? node_cast<T>(node) : nullptr;
+}
+
+template <typename T, typename From>
+const T* dyn_cast(const From* node) {
+  return isa<T>(node) ? node_cast<const T>(node) : nullptr;
+}
+
+// Transfers ownership of `node` to a pointer of its concrete type, which must
+// already be known to be `T` (e.g. from `getKind()`)
+template <typename T, typename From>
+std::unique_ptr<T> unique_cast(std::unique_ptr<From> node) {
+  return std::unique_ptr<T>(node_cast<T>(node.release()));
+}
+
 class Expression : public Node {
+  // 0 if not computed yet
+  mutable std::atomic<std::size_t> cached_hash{0};
+
  protected:
+  // Subclasses defined outside this library have the kind Expression, passes
+  // leave them as they are
+  Expression() : Node(NodeKind::Expression){};
+  explicit Expression(NodeKind kind) : Node(kind){};
+  Expression(const Expression& rhs) : Node(rhs){};
   virtual Expression* clone_impl() const = 0;
+  // The defaults compare the emitted Verilog, they are overridden by all
+  // expressions defined here
+  virtual std::size_t hash_impl() const;
+  // Only called with `other` of the same kind
+  virtual bool equal_impl(const Expression& other) const;
 
  public:
-  virtual std::string toString() = 0;
+  // The hash is cached on first use. After modifying a node in place, call
+  // `invalidateHash()` on it and on every expression containing it
+  // (Transformer does this for the nodes it visits).
+  std::size_t hash() const override;
+  void invalidateHash() { this->cached_hash = 0; }
+  bool structurallyEqual(const Node& other) const override;
+
+  static bool classof(const Node* node) {
+    return node->getKind() >= NodeKind::FirstExpression &&
+           node->getKind() <= NodeKind::LastExpression;
+  }
   virtual ~Expression() = default;
   auto clone() const { return std::unique_ptr<Expression>(clone_impl()); }
 };
@@ -52,21 +254,30 @@ class Expression : public Node {
 enum Radix { BINARY, OCTAL, HEX, DECIMAL };
 
 class NumericLiteral : public Expression {
+  // `value` parsed in `radix`, if it only contains digits. Kept in sync with
+  // `value`, `size` and `radix` by the constructors and setters.
+  std::optional<BitVector> bits;
+  // Digits in `radix` (may contain x/z digits or `_` separators), as written
+  // or, for literals built from a BitVector, rendered from it. Private so it
+  // can't change without `bits` being updated.
+  std::string value;
+
  protected:
   virtual NumericLiteral* clone_impl() const override {
-    return new NumericLiteral(this->value, this->size, this->_signed,
-                              this->radix, this->always_codegen_size);
+    return new NumericLiteral(*this);
   };
 
+  std::size_t hash_impl() const override;
+  bool equal_impl(const Expression& other) const override;
+
  public:
-  /// For now, we model values as strings because it depends on their radix
-  // (alternatively, we could store an unsigned integer representation and
-  //  convert it during code generation)
+  // Modify literals with `setValue`, `setSize` and `setRadix`, which keep the
+  // digits and the parsed value in sync, or call `reparse()` after assigning
+  // the fields below directly.
   //
   // TODO Maybe add special toString logic for the default case? E.g. if we're
   // generating a 32 bit unsigned decimal literal (commonly used for indexing
   // into ports) then we don't need to generate the "32'd" prefix
-  std::string value;
   unsigned int size;  // default 32
   bool _signed;       // default false
   Radix radix;        // default decimal
@@ -76,29 +287,98 @@ class NumericLiteral : public Expression {
 
   NumericLiteral(std::string value, unsigned int size, bool _signed,
                  Radix radix, bool always_codegen_size)
-      : value(value),
+      : Expression(NodeKind::NumericLiteral),
+        value(value),
         size(size),
         _signed(_signed),
         radix(radix),
-        always_codegen_size(always_codegen_size){};
+        always_codegen_size(always_codegen_size) {
+    this->reparse();
+  };
 
   NumericLiteral(std::string value, unsigned int size, bool _signed,
                  Radix radix)
-      : value(value), size(size), _signed(_signed), radix(radix){};
+      : Expression(NodeKind::NumericLiteral),
+        value(value),
+        size(size),
+        _signed(_signed),
+        radix(radix) {
+    this->reparse();
+  };
 
   NumericLiteral(std::string value, unsigned int size, bool _signed)
-      : value(value), size(size), _signed(_signed), radix(Radix::DECIMAL){};
+      : Expression(NodeKind::NumericLiteral),
+        value(value),
+        size(size),
+        _signed(_signed),
+        radix(Radix::DECIMAL) {
+    this->reparse();
+  };
 
   NumericLiteral(std::string value, unsigned int size)
-      : value(value), size(size), _signed(false), radix(Radix::DECIMAL){};
+      : Expression(NodeKind::NumericLiteral),
+        value(value),
+        size(size),
+        _signed(false),
+        radix(Radix::DECIMAL) {
+    this->reparse();
+  };
 
   explicit NumericLiteral(std::string value)
-      : value(value), size(32), _signed(false), radix(Radix::DECIMAL){};
+      : Expression(NodeKind::NumericLiteral),
+        value(value),
+        size(32),
+        _signed(false),
+        radix(Radix::DECIMAL) {
+    this->reparse();
+  };
 
   NumericLiteral(std::string value, Radix radix)
-      : value(value), size(32), _signed(false), radix(radix){};
+      : Expression(NodeKind::NumericLiteral),
+        value(value),
+        size(32),
+        _signed(false),
+        radix(radix) {
+    this->reparse();
+  };
 
-  std::string toString() override;
+  // Literal with the value `bits` and size `bits.width()`, `value` holds its
+  // digits in `radix`
+  explicit NumericLiteral(BitVector bits, Radix radix = Radix::DECIMAL,
+                          bool _signed = false);
+
+  // Value of the literal truncated to `size` bits (for the default unsized
+  // 32 bit literals, wide enough to hold the value), or nullptr if `value`
+  // is not a plain number (e.g. contains x/z digits).
+  const BitVector* getBits() const {
+    return this->bits ? &*this->bits : nullptr;
+  }
+  // Value of the literal if it has one and it fits in 64 bits
+  std::optional<std::uint64_t> getUInt() const {
+    if (!this->bits || !this->bits->fitsUInt64()) return std::nullopt;
+    return this->bits->toUInt64();
+  }
+  // Digits in `radix`, as written or rendered by `setRadix`. The parsed value
+  // is available from `getBits()`.
+  const std::string& getValue() const { return this->value; }
+  // Sets the digits, in `radix`
+  void setValue(std::string value);
+  // Truncates (or extends) the literal as written to `size` bits
+  void setSize(unsigned int size);
+  // Keeps the value of the literal and renders its digits in `radix`. Digits
+  // of literals without a value (x/z digits) are kept as they are.
+  void setRadix(Radix radix);
+  // Parses the digits again, call after assigning `size`, `radix` or
+  // `always_codegen_size` directly
+  void reparse();
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::NumericLiteral;
+  }
+  void emit(Sink& sink) const override;
+  // Leaves are cheap to hash and commonly mutated in place, so their hash
+  // is not cached
+  std::size_t hash() const override { return this->hash_impl(); }
   auto clone() const { return std::unique_ptr<NumericLiteral>(clone_impl()); }
 };
 
@@ -108,17 +388,27 @@ class Cast : public Expression {
     return new Cast(this->width, this->expr->clone());
   };
 
+  std::size_t hash_impl() const override;
+  bool equal_impl(const Expression& other) const override;
+
  public:
   // integer width because we want to avoid numeric literals with ' like 2'b01
   unsigned int width;
   std::unique_ptr<Expression> expr;
 
   Cast(unsigned int width, std::unique_ptr<Expression> expr)
-      : width(width), expr(std::move(expr)){};
-  Cast(const Cast& rhs) : width(rhs.width), expr(rhs.expr->clone()){};
+      : Expression(NodeKind::Cast), width(width), expr(std::move(expr)){};
+  Cast(const Cast& rhs)
+      : Expression(NodeKind::Cast),
+        width(rhs.width),
+        expr(rhs.expr->clone()){};
   auto clone() const { return std::unique_ptr<Cast>(clone_impl()); }
 
-  std::string toString() override;
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::Cast;
+  }
+
+  void emit(Sink& sink) const override;
   ~Cast(){};
 };
 
@@ -130,16 +420,35 @@ class Identifier : public Expression {
     return new Identifier(*this);
   };
 
- public:
-  std::string value;
+  std::size_t hash_impl() const override;
+  bool equal_impl(const Expression& other) const override;
 
-  explicit Identifier(std::string value);
-  Identifier(const Identifier& rhs) : value(rhs.value){};
+ public:
+  // Unescaped name, interned (see verilogAST/symbol.hpp). Names that need it
+  // are emitted as escaped identifiers (`\name `).
+  Symbol value;
+
+  explicit Identifier(std::string_view value)
+      : Expression(NodeKind::Identifier), value(value){};
+  explicit Identifier(Symbol value)
+      : Expression(NodeKind::Identifier), value(value){};
+  Identifier(const Identifier& rhs)
+      : Expression(NodeKind::Identifier), value(rhs.value){};
+
+  // True if `name` is not a simple identifier or is a keyword
+  static bool needsEscape(std::string_view name);
   auto clone() const { return std::unique_ptr<Identifier>(clone_impl()); }
 
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::Identifier;
+  }
+
   bool operator==(const Identifier& rhs) { return (this->value == rhs.value); }
 
-  std::string toString() override;
+  void emit(Sink& sink) const override;
+  // Leaves are cheap to hash and commonly mutated in place, so their hash
+  // is not cached
+  std::size_t hash() const override { return this->hash_impl(); }
   ~Identifier(){};
 };
 
@@ -149,6 +458,9 @@ class Attribute : public Expression {
     return new Attribute(*this);
   };
 
+  std::size_t hash_impl() const override;
+  bool equal_impl(const Expression& other) const override;
+
  public:
   std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Attribute>> value;
   std::string attr;
@@ -157,10 +469,11 @@ class Attribute : public Expression {
       std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Attribute>>
           value,
       std::string attr)
-      : value(std::move(value)), attr(attr){};
+      : Expression(NodeKind::Attribute), value(std::move(value)), attr(attr){};
 
   Attribute(const Attribute& rhs)
-      : value(std::visit(
+      : Expression(NodeKind::Attribute),
+        value(std::visit(
             [](auto&& val) -> std::variant<std::unique_ptr<Identifier>,
                                            std::unique_ptr<Attribute>> {
               return val->clone();
@@ -172,11 +485,15 @@ class Attribute : public Expression {
     return std::unique_ptr<Attribute>(clone_impl());
   }
 
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::Attribute;
+  }
+
   bool operator==(const Attribute& rhs) {
     return (this->value == rhs.value && this->attr == rhs.attr);
   }
 
-  std::string toString() override;
+  void emit(Sink& sink) const override;
   ~Attribute(){};
 };
 
@@ -184,13 +501,24 @@ class String : public Expression {
  protected:
   virtual String* clone_impl() const override { return new String(*this); };
 
+  std::size_t hash_impl() const override;
+  bool equal_impl(const Expression& other) const override;
+
  public:
   std::string value;
 
-  explicit String(std::string value) : value(value){};
-  String(const String& rhs) : value(rhs.value){};
+  explicit String(std::string value)
+      : Expression(NodeKind::String), value(value){};
+  String(const String& rhs) : Expression(NodeKind::String), value(rhs.value){};
 
-  std::string toString() override;
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::String;
+  }
+
+  void emit(Sink& sink) const override;
+  // Leaves are cheap to hash and commonly mutated in place, so their hash
+  // is not cached
+  std::size_t hash() const override { return this->hash_impl(); }
   ~String(){};
   auto clone() const { return std::unique_ptr<String>(clone_impl()); }
 };
@@ -202,6 +530,9 @@ class Slice : public Expression {
                      this->low_index->clone());
   };
 
+  std::size_t hash_impl() const override;
+  bool equal_impl(const Expression& other) const override;
+
  public:
   std::unique_ptr<Expression> expr;
   std::unique_ptr<Expression> high_index;
@@ -210,14 +541,20 @@ class Slice : public Expression {
   Slice(std::unique_ptr<Expression> expr,
         std::unique_ptr<Expression> high_index,
         std::unique_ptr<Expression> low_index)
-      : expr(std::move(expr)),
+      : Expression(NodeKind::Slice),
+        expr(std::move(expr)),
         high_index(std::move(high_index)),
         low_index(std::move(low_index)){};
   Slice(const Slice& rhs)
-      : expr(rhs.expr->clone()),
+      : Expression(NodeKind::Slice),
+        expr(rhs.expr->clone()),
         high_index(rhs.high_index->clone()),
         low_index(rhs.low_index->clone()){};
-  std::string toString() override;
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::Slice;
+  }
+  void emit(Sink& sink) const override;
   ~Slice(){};
   auto clone() const { return std::unique_ptr<Slice>(clone_impl()); }
 };
@@ -228,6 +565,9 @@ class Index : public Expression {
     return new Index(this->clone_index_value(), this->index->clone());
   };
 
+  std::size_t hash_impl() const override;
+  bool equal_impl(const Expression& other) const override;
+
  public:
   std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Attribute>,
                std::unique_ptr<Slice>, std::unique_ptr<Index>>
@@ -238,12 +578,20 @@ class Index : public Expression {
                      std::unique_ptr<Slice>, std::unique_ptr<Index>>
             value,
         std::unique_ptr<Expression> index)
-      : value(std::move(value)), index(std::move(index)){};
+      : Expression(NodeKind::Index),
+        value(std::move(value)),
+        index(std::move(index)){};
 
   Index(const Index& rhs)
-      : value(rhs.clone_index_value()), index(rhs.index->clone()){};
+      : Expression(NodeKind::Index),
+        value(rhs.clone_index_value()),
+        index(rhs.index->clone()){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::Index;
+  }
 
-  std::string toString() override;
+  void emit(Sink& sink) const override;
   ~Index(){};
   auto clone() const { return std::unique_ptr<Index>(clone_impl()); }
 
@@ -292,6 +640,9 @@ class BinaryOp : public Expression {
     return new BinaryOp(this->left->clone(), this->op, this->right->clone());
   };
 
+  std::size_t hash_impl() const override;
+  bool equal_impl(const Expression& other) const override;
+
  public:
   std::unique_ptr<Expression> left;
   BinOp::BinOp op;
@@ -299,11 +650,21 @@ class BinaryOp : public Expression {
 
   BinaryOp(std::unique_ptr<Expression> left, BinOp::BinOp op,
            std::unique_ptr<Expression> right)
-      : left(std::move(left)), op(op), right(std::move(right)){};
+      : Expression(NodeKind::BinaryOp),
+        left(std::move(left)),
+        op(op),
+        right(std::move(right)){};
   BinaryOp(const BinaryOp& rhs)
-      : left(rhs.left->clone()), op(rhs.op), right(rhs.right->clone()){};
+      : Expression(NodeKind::BinaryOp),
+        left(rhs.left->clone()),
+        op(rhs.op),
+        right(rhs.right->clone()){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::BinaryOp;
+  }
 
-  std::string toString() override;
+  void emit(Sink& sink) const override;
   ~BinaryOp(){};
   auto clone() const { return std::unique_ptr<BinaryOp>(clone_impl()); }
 };
@@ -330,16 +691,26 @@ class UnaryOp : public Expression {
     return new UnaryOp(this->operand->clone(), this->op);
   };
 
+  std::size_t hash_impl() const override;
+  bool equal_impl(const Expression& other) const override;
+
  public:
   std::unique_ptr<Expression> operand;
 
   UnOp::UnOp op;
 
   UnaryOp(std::unique_ptr<Expression> operand, UnOp::UnOp op)
-      : operand(std::move(operand)), op(op){};
-  UnaryOp(const UnaryOp& rhs) : operand(rhs.operand->clone()), op(rhs.op){};
+      : Expression(NodeKind::UnaryOp), operand(std::move(operand)), op(op){};
+  UnaryOp(const UnaryOp& rhs)
+      : Expression(NodeKind::UnaryOp),
+        operand(rhs.operand->clone()),
+        op(rhs.op){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::UnaryOp;
+  }
 
-  std::string toString() override;
+  void emit(Sink& sink) const override;
   ~UnaryOp(){};
   auto clone() const { return std::unique_ptr<UnaryOp>(clone_impl()); }
 };
@@ -351,6 +722,9 @@ class TernaryOp : public Expression {
                          this->false_value->clone());
   };
 
+  std::size_t hash_impl() const override;
+  bool equal_impl(const Expression& other) const override;
+
  public:
   std::unique_ptr<Expression> cond;
   std::unique_ptr<Expression> true_value;
@@ -359,15 +733,21 @@ class TernaryOp : public Expression {
   TernaryOp(std::unique_ptr<Expression> cond,
             std::unique_ptr<Expression> true_value,
             std::unique_ptr<Expression> false_value)
-      : cond(std::move(cond)),
+      : Expression(NodeKind::TernaryOp),
+        cond(std::move(cond)),
         true_value(std::move(true_value)),
         false_value(std::move(false_value)){};
   TernaryOp(const TernaryOp& rhs)
-      : cond(rhs.cond->clone()),
+      : Expression(NodeKind::TernaryOp),
+        cond(rhs.cond->clone()),
         true_value(rhs.true_value->clone()),
         false_value(rhs.false_value->clone()){};
 
-  std::string toString() override;
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::TernaryOp;
+  }
+
+  void emit(Sink& sink) const override;
   ~TernaryOp(){};
   auto clone() const { return std::unique_ptr<TernaryOp>(clone_impl()); }
 };
@@ -382,18 +762,27 @@ class Concat : public Expression {
     return new Concat(std::move(new_args));
   };
 
+  std::size_t hash_impl() const override;
+  bool equal_impl(const Expression& other) const override;
+
  public:
   std::vector<std::unique_ptr<Expression>> args;
   bool unpacked;
 
   explicit Concat(std::vector<std::unique_ptr<Expression>> args, bool unpacked = false)
-      : args(std::move(args)), unpacked(unpacked){};
-  Concat(const Concat& rhs) {
+      : Expression(NodeKind::Concat),
+        args(std::move(args)),
+        unpacked(unpacked){};
+  Concat(const Concat& rhs) : Expression(NodeKind::Concat) {
     for (const auto& arg : rhs.args) args.push_back(arg->clone());
     this->unpacked = rhs.unpacked;
   };
 
-  std::string toString() override;
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::Concat;
+  }
+
+  void emit(Sink& sink) const override;
   auto clone() const { return std::unique_ptr<Concat>(clone_impl()); }
 };
 
@@ -403,16 +792,27 @@ class Replicate : public Expression {
     return new Replicate(this->num->clone(), this->value->clone());
   };
 
+  std::size_t hash_impl() const override;
+  bool equal_impl(const Expression& other) const override;
+
  public:
   std::unique_ptr<Expression> num;
   std::unique_ptr<Expression> value;
 
   Replicate(std::unique_ptr<Expression> num, std::unique_ptr<Expression> value)
-      : num(std::move(num)), value(std::move(value)){};
+      : Expression(NodeKind::Replicate),
+        num(std::move(num)),
+        value(std::move(value)){};
   Replicate(const Replicate& rhs)
-      : num(rhs.num->clone()), value(rhs.value->clone()){};
+      : Expression(NodeKind::Replicate),
+        num(rhs.num->clone()),
+        value(rhs.value->clone()){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::Replicate;
+  }
 
-  std::string toString() override;
+  void emit(Sink& sink) const override;
   auto clone() const { return std::unique_ptr<Replicate>(clone_impl()); }
 };
 
@@ -420,8 +820,14 @@ class NegEdge : public Node {
  public:
   std::unique_ptr<Identifier> value;
 
-  explicit NegEdge(std::unique_ptr<Identifier> value) : value(std::move(value)){};
-  std::string toString() override;
+  explicit NegEdge(std::unique_ptr<Identifier> value)
+      : Node(NodeKind::NegEdge), value(std::move(value)){};
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::NegEdge;
+  }
+  void emit(Sink& sink) const override;
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
   ~NegEdge(){};
 };
 
@@ -429,8 +835,14 @@ class PosEdge : public Node {
  public:
   std::unique_ptr<Identifier> value;
 
-  explicit PosEdge(std::unique_ptr<Identifier> value) : value(std::move(value)){};
-  std::string toString() override;
+  explicit PosEdge(std::unique_ptr<Identifier> value)
+      : Node(NodeKind::PosEdge), value(std::move(value)){};
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::PosEdge;
+  }
+  void emit(Sink& sink) const override;
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
   ~PosEdge(){};
 };
 
@@ -442,7 +854,7 @@ class Call {
   Call(std::string func, std::vector<std::unique_ptr<Expression>> args)
       : func(func), args(std::move(args)){};
   explicit Call(std::string func) : func(func){};
-  std::string toString();
+  void emit(Sink& sink) const;
   ~Call(){};
 };
 
@@ -456,28 +868,99 @@ class CallExpr : public Expression, public Call {
     return new CallExpr(this->func, std::move(new_args));
   };
 
+  std::size_t hash_impl() const override;
+  bool equal_impl(const Expression& other) const override;
+
  public:
   CallExpr(std::string func, std::vector<std::unique_ptr<Expression>> args)
-      : Call(std::move(func), std::move(args)){};
-  explicit CallExpr(std::string func) : Call(std::move(func)){};
-  CallExpr(const CallExpr& rhs) : Call(std::move(rhs.func)) {
+      : Expression(NodeKind::CallExpr),
+        Call(std::move(func), std::move(args)){};
+  explicit CallExpr(std::string func)
+      : Expression(NodeKind::CallExpr), Call(std::move(func)){};
+  CallExpr(const CallExpr& rhs)
+      : Expression(NodeKind::CallExpr), Call(std::move(rhs.func)) {
     for (const auto& arg : rhs.args) {
       args.push_back(arg->clone());
     }
   };
 
-  std::string toString() override { return Call::toString(); };
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::CallExpr;
+  }
+
+  void emit(Sink& sink) const override { Call::emit(sink); };
   auto clone() const { return std::unique_ptr<CallExpr>(clone_impl()); }
 };
 
+// Reference to an immutable expression that can be shared by any number of
+// trees (see ExprInterner in verilogAST/hash_cons.hpp). Cloning only copies
+// the reference. It emits, hashes and compares as the expression it refers
+// to.
+class SharedExpr : public Expression {
+ protected:
+  virtual SharedExpr* clone_impl() const override {
+    return new SharedExpr(this->value);
+  };
+
+  std::size_t hash_impl() const override { return this->value->hash(); }
+  bool equal_impl(const Expression& other) const override;
+
+ public:
+  std::shared_ptr<const Expression> value;
+
+  explicit SharedExpr(std::shared_ptr<const Expression> value)
+      : Expression(NodeKind::SharedExpr), value(std::move(value)){};
+  SharedExpr(const SharedExpr& rhs)
+      : Expression(NodeKind::SharedExpr), value(rhs.value){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::SharedExpr;
+  }
+
+  // Returns a modifiable copy of the shared expression, its children are
+  // still shared
+  std::unique_ptr<Expression> materialize() const {
+    return this->value->clone();
+  }
+
+  void emit(Sink& sink) const override { this->value->emit(sink); };
+  // The referenced expression caches its own hash
+  std::size_t hash() const override { return this->hash_impl(); }
+  auto clone() const { return std::unique_ptr<SharedExpr>(clone_impl()); }
+};
+
+// Returns the expression `expr` refers to if it is a SharedExpr, and `expr`
+// otherwise
+inline const Expression* strip_shared(const Expression* expr) {
+  while (auto shared = dyn_cast<SharedExpr>(expr)) expr = shared->value.get();
+  return expr;
+}
+
 enum Direction { INPUT, OUTPUT, INOUT };
 
 // TODO: Unify with declarations?
 enum PortType { WIRE, REG };
 
-class AbstractPort : public Node {};
+class AbstractPort : public Node {
+ protected:
+  explicit AbstractPort(NodeKind kind) : Node(kind){};
+
+ public:
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::Port ||
+           node->getKind() == NodeKind::StringPort;
+  }
+};
 
 class Vector : public Node {
+ protected:
+  Vector(NodeKind kind, std::unique_ptr<Identifier> id,
+         std::unique_ptr<Expression> msb, std::unique_ptr<Expression> lsb)
+      : Node(kind),
+        id(std::move(id)),
+        msb(std::move(msb)),
+        lsb(std::move(lsb)){};
+
  public:
   std::unique_ptr<Identifier> id;
   std::unique_ptr<Expression> msb;
@@ -485,12 +968,29 @@ class Vector : public Node {
 
   Vector(std::unique_ptr<Identifier> id, std::unique_ptr<Expression> msb,
          std::unique_ptr<Expression> lsb)
-      : id(std::move(id)), msb(std::move(msb)), lsb(std::move(lsb)){};
-  std::string toString() override;
+      : Vector(NodeKind::Vector, std::move(id), std::move(msb),
+               std::move(lsb)){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() >= NodeKind::Vector &&
+           node->getKind() <= NodeKind::PackedNDVector;
+  }
+  void emit(Sink& sink) const override;
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
   ~Vector(){};
 };
 
 class NDVector : public Vector {
+ protected:
+  NDVector(NodeKind kind, std::unique_ptr<Identifier> id,
+           std::unique_ptr<Expression> msb, std::unique_ptr<Expression> lsb,
+           std::vector<std::pair<std::unique_ptr<Expression>,
+                                 std::unique_ptr<Expression>>>
+               outer_dims)
+      : Vector(kind, std::move(id), std::move(msb), std::move(lsb)),
+        outer_dims(std::move(outer_dims)){};
+
  public:
   std::vector<
       std::pair<std::unique_ptr<Expression>, std::unique_ptr<Expression>>>
@@ -501,9 +1001,16 @@ class NDVector : public Vector {
            std::vector<std::pair<std::unique_ptr<Expression>,
                                  std::unique_ptr<Expression>>>
                outer_dims)
-      : Vector(std::move(id), std::move(msb), std::move(lsb)),
-        outer_dims(std::move(outer_dims)){};
-  std::string toString() override;
+      : NDVector(NodeKind::NDVector, std::move(id), std::move(msb),
+                 std::move(lsb), std::move(outer_dims)){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::NDVector ||
+           node->getKind() == NodeKind::PackedNDVector;
+  }
+  void emit(Sink& sink) const override;
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
   ~NDVector(){};
 };
 
@@ -515,10 +1022,14 @@ class PackedNDVector : public NDVector {
       std::vector<
           std::pair<std::unique_ptr<Expression>, std::unique_ptr<Expression>>>
           outer_dims)
-      : NDVector(std::move(id), std::move(msb), std::move(lsb),
-                 std::move(outer_dims)) {}
+      : NDVector(NodeKind::PackedNDVector, std::move(id), std::move(msb),
+                 std::move(lsb), std::move(outer_dims)) {}
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::PackedNDVector;
+  }
 
-  std::string toString() override;
+  void emit(Sink& sink) const override;
   ~PackedNDVector() = default;
 };
 
@@ -537,12 +1048,22 @@ class Port : public AbstractPort {
 
   Port(std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Vector>> value,
        Direction direction, PortType data_type)
-      : value(std::move(value)), direction(direction), data_type(data_type){};
+      : AbstractPort(NodeKind::Port),
+        value(std::move(value)),
+        direction(direction),
+        data_type(data_type){};
   explicit Port(std::unique_ptr<Port> port)
-      : value(std::move(port->value)),
+      : AbstractPort(NodeKind::Port),
+        value(std::move(port->value)),
         direction(port->direction),
         data_type(port->data_type){};
-  std::string toString() override;
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::Port;
+  }
+  void emit(Sink& sink) const override;
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
   ~Port(){};
 };
 
@@ -550,15 +1071,50 @@ class StringPort : public AbstractPort {
  public:
   std::string value;
 
-  explicit StringPort(std::string value) : value(value){};
-  std::string toString() { return value; };
+  explicit StringPort(std::string value)
+      : AbstractPort(NodeKind::StringPort), value(value){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::StringPort;
+  }
+  void emit(Sink& sink) const override { sink << value; };
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
   ~StringPort(){};
 };
 
-class Statement : public Node {};
+class Statement : public Node {
+ protected:
+  explicit Statement(NodeKind kind) : Node(kind){};
+};
+
+class BehavioralStatement : public Statement {
+ protected:
+  // Subclasses defined outside this library have the kind
+  // BehavioralStatement, passes leave them as they are
+  BehavioralStatement() : Statement(NodeKind::BehavioralStatement){};
+  explicit BehavioralStatement(NodeKind kind) : Statement(kind){};
+
+ public:
+  static bool classof(const Node* node) {
+    return node->getKind() >= NodeKind::FirstBehavioralStatement &&
+           node->getKind() <= NodeKind::LastBehavioralStatement;
+  }
+};
 
-class BehavioralStatement : public Statement {};
-class StructuralStatement : public Statement {};
+class StructuralStatement : public Statement {
+ protected:
+  // Subclasses defined outside this library have the kind
+  // StructuralStatement, passes leave them as they are
+  StructuralStatement() : Statement(NodeKind::StructuralStatement){};
+  explicit StructuralStatement(NodeKind kind) : Statement(kind){};
+
+ public:
+  static bool classof(const Node* node) {
+    return node->getKind() >= NodeKind::FirstStructuralStatement &&
+           node->getKind() <= NodeKind::LastStructuralStatement;
+  }
+};
 
 class SingleLineComment : public StructuralStatement,
                           public BehavioralStatement {
@@ -567,10 +1123,27 @@ class SingleLineComment : public StructuralStatement,
   std::unique_ptr<Statement> statement;  // optional
 
   explicit SingleLineComment(std::string value)
-      : value(value), statement(std::unique_ptr<Statement>{}){};
+      : StructuralStatement(NodeKind::SingleLineComment),
+        BehavioralStatement(NodeKind::SingleLineComment),
+        value(value),
+        statement(std::unique_ptr<Statement>{}){};
   SingleLineComment(std::string value, std::unique_ptr<Statement> statement)
-      : value(value), statement(std::move(statement)){};
-  std::string toString() override;
+      : StructuralStatement(NodeKind::SingleLineComment),
+        BehavioralStatement(NodeKind::SingleLineComment),
+        value(value),
+        statement(std::move(statement)){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::SingleLineComment;
+  }
+  void emit(Sink& sink) const override;
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
+  // Multiple inheritance forces us to have to explicitly state this?
+  std::string toString() const override {
+    return StructuralStatement::toString();
+  };
+  using StructuralStatement::getKind;
   ~SingleLineComment(){};
 };
 
@@ -578,8 +1151,22 @@ class BlockComment : public StructuralStatement, public BehavioralStatement {
  public:
   std::string value;
 
-  explicit BlockComment(std::string value) : value(value){};
-  std::string toString() { return "/*\n" + value + "\n*/"; };
+  explicit BlockComment(std::string value)
+      : StructuralStatement(NodeKind::BlockComment),
+        BehavioralStatement(NodeKind::BlockComment),
+        value(value){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::BlockComment;
+  }
+  void emit(Sink& sink) const override { sink << "/*\n" << value << "\n*/"; };
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
+  // Multiple inheritance forces us to have to explicitly state this?
+  std::string toString() const override {
+    return StructuralStatement::toString();
+  };
+  using StructuralStatement::getKind;
   ~BlockComment(){};
 };
 
@@ -591,8 +1178,15 @@ class InlineVerilog : public StructuralStatement {
  public:
   std::string value;
 
-  explicit InlineVerilog(std::string value) : value(value){};
-  std::string toString() { return value; };
+  explicit InlineVerilog(std::string value)
+      : StructuralStatement(NodeKind::InlineVerilog), value(value){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::InlineVerilog;
+  }
+  void emit(Sink& sink) const override { sink << value; };
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
   ~InlineVerilog(){};
 };
 
@@ -628,6 +1222,10 @@ class Connections {
 
   ConnectionVector::iterator begin() { return connections.begin(); }
   ConnectionVector::iterator end() { return connections.end(); }
+  ConnectionVector::const_iterator begin() const {
+    return connections.begin();
+  }
+  ConnectionVector::const_iterator end() const { return connections.end(); }
 
   bool empty() const { return connections.empty(); }
 
@@ -652,15 +1250,30 @@ class ModuleInstantiation : public StructuralStatement {
   ModuleInstantiation(std::string module_name, Parameters parameters,
                       std::string instance_name,
                       std::unique_ptr<Connections> connections)
-      : module_name(module_name),
+      : StructuralStatement(NodeKind::ModuleInstantiation),
+        module_name(module_name),
         parameters(std::move(parameters)),
         instance_name(instance_name),
         connections(std::move(connections)){};
-  std::string toString() override;
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::ModuleInstantiation;
+  }
+  void emit(Sink& sink) const override;
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
   ~ModuleInstantiation(){};
 };
 
 class Declaration : public Node {
+ protected:
+  Declaration(NodeKind kind,
+              std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
+                           std::unique_ptr<Slice>, std::unique_ptr<Vector>>
+                  value,
+              std::string decl)
+      : Node(kind), decl(decl), value(std::move(value)){};
+
  public:
   std::string decl;
   std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
@@ -671,14 +1284,21 @@ class Declaration : public Node {
                            std::unique_ptr<Slice>, std::unique_ptr<Vector>>
                   value,
               std::string decl)
-      : decl(decl), value(std::move(value)){};
+      : Declaration(NodeKind::Declaration, std::move(value), decl){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() >= NodeKind::Declaration &&
+           node->getKind() <= NodeKind::Reg;
+  }
 
-  std::string toString() override;
+  void emit(Sink& sink) const override;
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
   virtual ~Declaration() = default;
 };
 
 class IfMacro : public StructuralStatement {
-  virtual std::string getMacroString() = 0;
+  virtual std::string getMacroString() const = 0;
 
  public:
   std::string condition_str;
@@ -688,34 +1308,64 @@ class IfMacro : public StructuralStatement {
   std::vector<std::variant<std::unique_ptr<StructuralStatement>,
                            std::unique_ptr<Declaration>>>
       else_body;
-  IfMacro(std::string condition_str,
+
+ protected:
+  IfMacro(NodeKind kind, std::string condition_str,
           std::vector<std::variant<std::unique_ptr<StructuralStatement>,
                                    std::unique_ptr<Declaration>>>
               true_body)
-      : condition_str(condition_str), true_body(std::move(true_body)){};
-  IfMacro(std::string condition_str,
+      : StructuralStatement(kind),
+        condition_str(condition_str),
+        true_body(std::move(true_body)){};
+  IfMacro(NodeKind kind, std::string condition_str,
           std::vector<std::variant<std::unique_ptr<StructuralStatement>,
                                    std::unique_ptr<Declaration>>>
               true_body,
           std::vector<std::variant<std::unique_ptr<StructuralStatement>,
                                    std::unique_ptr<Declaration>>>
               else_body)
-      : condition_str(condition_str),
+      : StructuralStatement(kind),
+        condition_str(condition_str),
         true_body(std::move(true_body)),
         else_body(std::move(else_body)){};
+
+ public:
+  // Macros other than IfDef and IfNDef have the kind IfMacro
+  IfMacro(std::string condition_str,
+          std::vector<std::variant<std::unique_ptr<StructuralStatement>,
+                                   std::unique_ptr<Declaration>>>
+              true_body)
+      : IfMacro(NodeKind::IfMacro, condition_str, std::move(true_body)){};
+  IfMacro(std::string condition_str,
+          std::vector<std::variant<std::unique_ptr<StructuralStatement>,
+                                   std::unique_ptr<Declaration>>>
+              true_body,
+          std::vector<std::variant<std::unique_ptr<StructuralStatement>,
+                                   std::unique_ptr<Declaration>>>
+              else_body)
+      : IfMacro(NodeKind::IfMacro, condition_str, std::move(true_body),
+                std::move(else_body)){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::IfMacro ||
+           node->getKind() == NodeKind::IfDef ||
+           node->getKind() == NodeKind::IfNDef;
+  }
   ~IfMacro(){};
-  std::string toString() override;
+  void emit(Sink& sink) const override;
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
 };
 
 class IfDef : public IfMacro {
-  std::string getMacroString() { return "`ifdef "; };
+  std::string getMacroString() const { return "`ifdef "; };
 
  public:
   IfDef(std::string condition_str,
         std::vector<std::variant<std::unique_ptr<StructuralStatement>,
                                  std::unique_ptr<Declaration>>>
             body)
-      : IfMacro(condition_str, std::move(body)){};
+      : IfMacro(NodeKind::IfDef, condition_str, std::move(body)){};
   IfDef(std::string condition_str,
         std::vector<std::variant<std::unique_ptr<StructuralStatement>,
                                  std::unique_ptr<Declaration>>>
@@ -723,19 +1373,23 @@ class IfDef : public IfMacro {
         std::vector<std::variant<std::unique_ptr<StructuralStatement>,
                                  std::unique_ptr<Declaration>>>
             else_body)
-      : IfMacro(condition_str, std::move(true_body), std::move(else_body)){};
+      : IfMacro(NodeKind::IfDef, condition_str, std::move(true_body),
+                std::move(else_body)){};
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::IfDef;
+  }
   ~IfDef(){};
 };
 
 class IfNDef : public IfMacro {
-  std::string getMacroString() { return "`ifndef "; };
+  std::string getMacroString() const { return "`ifndef "; };
 
  public:
   IfNDef(std::string condition_str,
          std::vector<std::variant<std::unique_ptr<StructuralStatement>,
                                   std::unique_ptr<Declaration>>>
              body)
-      : IfMacro(condition_str, std::move(body)){};
+      : IfMacro(NodeKind::IfNDef, condition_str, std::move(body)){};
   IfNDef(std::string condition_str,
          std::vector<std::variant<std::unique_ptr<StructuralStatement>,
                                   std::unique_ptr<Declaration>>>
@@ -743,7 +1397,11 @@ class IfNDef : public IfMacro {
          std::vector<std::variant<std::unique_ptr<StructuralStatement>,
                                   std::unique_ptr<Declaration>>>
              else_body)
-      : IfMacro(condition_str, std::move(true_body), std::move(else_body)){};
+      : IfMacro(NodeKind::IfNDef, condition_str, std::move(true_body),
+                std::move(else_body)){};
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::IfNDef;
+  }
   ~IfNDef(){};
 };
 
@@ -752,7 +1410,10 @@ class Wire : public Declaration {
   explicit Wire(std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
                     std::unique_ptr<Slice>, std::unique_ptr<Vector>>
            value)
-      : Declaration(std::move(value), "wire"){};
+      : Declaration(NodeKind::Wire, std::move(value), "wire"){};
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::Wire;
+  }
   ~Wire(){};
 };
 
@@ -761,7 +1422,10 @@ class Reg : public Declaration {
   explicit Reg(std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
                    std::unique_ptr<Slice>, std::unique_ptr<Vector>>
           value)
-      : Declaration(std::move(value), "reg"){};
+      : Declaration(NodeKind::Reg, std::move(value), "reg"){};
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::Reg;
+  }
   ~Reg(){};
 };
 
@@ -774,25 +1438,56 @@ class Assign : public Node {
   std::string prefix;
   std::string symbol;
 
-  Assign(std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
+ protected:
+  Assign(NodeKind kind,
+         std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
                       std::unique_ptr<Slice>>
              target,
          std::unique_ptr<Expression> value, std::string prefix)
-      : target(std::move(target)),
+      : Node(kind),
+        target(std::move(target)),
         value(std::move(value)),
         prefix(prefix),
         symbol("="){};
-  Assign(std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
+  Assign(NodeKind kind,
+         std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
                       std::unique_ptr<Slice>>
              target,
          std::unique_ptr<Expression> value, std::string prefix,
          std::string symbol)
-      : target(std::move(target)),
+      : Node(kind),
+        target(std::move(target)),
         value(std::move(value)),
         prefix(prefix),
         symbol(symbol){};
 
-  std::string toString() override;
+ public:
+  // Assigns other than ContinuousAssign, BlockingAssign and NonBlockingAssign
+  // have the kind Assign
+  Assign(std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
+                      std::unique_ptr<Slice>>
+             target,
+         std::unique_ptr<Expression> value, std::string prefix)
+      : Assign(NodeKind::Assign, std::move(target), std::move(value),
+               prefix){};
+  Assign(std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Index>,
+                      std::unique_ptr<Slice>>
+             target,
+         std::unique_ptr<Expression> value, std::string prefix,
+         std::string symbol)
+      : Assign(NodeKind::Assign, std::move(target), std::move(value), prefix,
+               symbol){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::Assign ||
+           node->getKind() == NodeKind::ContinuousAssign ||
+           node->getKind() == NodeKind::BlockingAssign ||
+           node->getKind() == NodeKind::NonBlockingAssign;
+  }
+
+  void emit(Sink& sink) const override;
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
   virtual ~Assign() = default;
 };
 
@@ -802,13 +1497,34 @@ class ContinuousAssign : public StructuralStatement, public Assign {
                                 std::unique_ptr<Index>, std::unique_ptr<Slice>>
                        target,
                    std::unique_ptr<Expression> value)
-      : Assign(std::move(target), std::move(value), "assign "){};
+      : StructuralStatement(NodeKind::ContinuousAssign),
+        Assign(NodeKind::ContinuousAssign, std::move(target), std::move(value),
+               "assign "){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::ContinuousAssign;
+  }
   // Multiple inheritance forces us to have to explicitly state this?
-  std::string toString() { return Assign::toString(); };
+  void emit(Sink& sink) const override { Assign::emit(sink); };
+  std::size_t hash() const override { return Assign::hash(); };
+  bool structurallyEqual(const Node& other) const override {
+    return Assign::structurallyEqual(other);
+  };
+  std::string toString() const override { return Assign::toString(); };
+  using Assign::getKind;
   ~ContinuousAssign(){};
 };
 
-class BehavioralAssign : public BehavioralStatement {};
+class BehavioralAssign : public BehavioralStatement {
+ protected:
+  explicit BehavioralAssign(NodeKind kind) : BehavioralStatement(kind){};
+
+ public:
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::BlockingAssign ||
+           node->getKind() == NodeKind::NonBlockingAssign;
+  }
+};
 
 class BlockingAssign : public BehavioralAssign, public Assign {
  public:
@@ -816,9 +1532,21 @@ class BlockingAssign : public BehavioralAssign, public Assign {
                               std::unique_ptr<Index>, std::unique_ptr<Slice>>
                      target,
                  std::unique_ptr<Expression> value)
-      : Assign(std::move(target), std::move(value), ""){};
+      : BehavioralAssign(NodeKind::BlockingAssign),
+        Assign(NodeKind::BlockingAssign, std::move(target), std::move(value),
+               ""){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::BlockingAssign;
+  }
   // Multiple inheritance forces us to have to explicitly state this?
-  std::string toString() { return Assign::toString(); };
+  void emit(Sink& sink) const override { Assign::emit(sink); };
+  std::size_t hash() const override { return Assign::hash(); };
+  bool structurallyEqual(const Node& other) const override {
+    return Assign::structurallyEqual(other);
+  };
+  std::string toString() const override { return Assign::toString(); };
+  using Assign::getKind;
   ~BlockingAssign(){};
 };
 
@@ -828,23 +1556,57 @@ class NonBlockingAssign : public BehavioralAssign, public Assign {
                                  std::unique_ptr<Index>, std::unique_ptr<Slice>>
                         target,
                     std::unique_ptr<Expression> value)
-      : Assign(std::move(target), std::move(value), "", "<="){};
+      : BehavioralAssign(NodeKind::NonBlockingAssign),
+        Assign(NodeKind::NonBlockingAssign, std::move(target), std::move(value),
+               "", "<="){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::NonBlockingAssign;
+  }
   // Multiple inheritance forces us to have to explicitly state this?
-  std::string toString() { return Assign::toString(); };
+  void emit(Sink& sink) const override { Assign::emit(sink); };
+  std::size_t hash() const override { return Assign::hash(); };
+  bool structurallyEqual(const Node& other) const override {
+    return Assign::structurallyEqual(other);
+  };
+  std::string toString() const override { return Assign::toString(); };
+  using Assign::getKind;
   ~NonBlockingAssign(){};
 };
 
 class CallStmt : public BehavioralStatement, public Call {
  public:
   CallStmt(std::string func, std::vector<std::unique_ptr<Expression>> args)
-      : Call(std::move(func), std::move(args)){};
-  explicit CallStmt(std::string func) : Call(std::move(func)){};
-  std::string toString() { return Call::toString() + ";"; };
+      : BehavioralStatement(NodeKind::CallStmt),
+        Call(std::move(func), std::move(args)){};
+  explicit CallStmt(std::string func)
+      : BehavioralStatement(NodeKind::CallStmt), Call(std::move(func)){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::CallStmt;
+  }
+  void emit(Sink& sink) const override {
+    Call::emit(sink);
+    sink << ';';
+  };
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
 };
 
 class Star : Node {
  public:
-  std::string toString() { return "*"; };
+  using Node::operator new;
+  using Node::operator delete;
+  using Node::getKind;
+  using Node::toString;
+  Star() : Node(NodeKind::Star){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::Star;
+  }
+  void emit(Sink& sink) const override { sink << '*'; };
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
   ~Star(){};
 };
 
@@ -861,14 +1623,20 @@ class Always : public StructuralStatement {
                           std::unique_ptr<NegEdge>, std::unique_ptr<Star>>>
              sensitivity_list,
          std::vector<std::unique_ptr<BehavioralStatement>> body)
-      : body(std::move(body)) {
+      : StructuralStatement(NodeKind::Always), body(std::move(body)) {
     if (sensitivity_list.empty()) {
       throw std::runtime_error(
           "vAST::Always expects non-empty sensitivity list");
     }
     this->sensitivity_list = std::move(sensitivity_list);
   };
-  std::string toString() override;
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::Always;
+  }
+  void emit(Sink& sink) const override;
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
   ~Always(){};
 };
 
@@ -888,7 +1656,8 @@ class If : public BehavioralStatement {
                            std::vector<std::unique_ptr<BehavioralStatement>>>>
          else_ifs,
      std::vector<std::unique_ptr<BehavioralStatement>> else_body)
-      : cond(std::move(cond)),
+      : BehavioralStatement(NodeKind::If),
+        cond(std::move(cond)),
         true_body(std::move(true_body)),
         else_ifs(std::move(else_ifs)),
         else_body(std::move(else_body)){};
@@ -896,17 +1665,43 @@ class If : public BehavioralStatement {
   If(std::unique_ptr<Expression> cond,
      std::vector<std::unique_ptr<BehavioralStatement>> true_body,
      std::vector<std::unique_ptr<BehavioralStatement>> else_body)
-      : cond(std::move(cond)),
+      : BehavioralStatement(NodeKind::If),
+        cond(std::move(cond)),
         true_body(std::move(true_body)),
         else_body(std::move(else_body)){};
 
-  std::string toString() override;
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::If;
+  }
+  void emit(Sink& sink) const override;
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
   ~If(){};
 };
 
-class AbstractModule : public Node {};
+class AbstractModule : public Node {
+ protected:
+  explicit AbstractModule(NodeKind kind) : Node(kind){};
+
+ public:
+  static bool classof(const Node* node) {
+    return node->getKind() >= NodeKind::Module &&
+           node->getKind() <= NodeKind::StringModule;
+  }
+};
 
 class Module : public AbstractModule {
+ protected:
+  // Protected initializer that is used by the StringBodyModule subclass which
+  // overrides the `body` field (but reuses the other fields)
+  Module(NodeKind kind, std::string name,
+         std::vector<std::unique_ptr<AbstractPort>> ports,
+         Parameters parameters)
+      : AbstractModule(kind),
+        name(name),
+        ports(std::move(ports)),
+        parameters(std::move(parameters)){};
+
  public:
   std::string name;
   std::vector<std::unique_ptr<AbstractPort>> ports;
@@ -914,21 +1709,16 @@ class Module : public AbstractModule {
                            std::unique_ptr<Declaration>>>
       body;
   Parameters parameters;
-  std::string emitModuleHeader();
-  // Protected initializer that is used by the StringBodyModule subclass which
-  // overrides the `body` field (but reuses the other fields)
-  Module(std::string name, std::vector<std::unique_ptr<AbstractPort>> ports,
-         Parameters parameters)
-      : name(name),
-        ports(std::move(ports)),
-        parameters(std::move(parameters)){};
+  void emitModuleHeader(Sink& sink) const;
+  std::string emitModuleHeader() const;
 
   Module(std::string name, std::vector<std::unique_ptr<AbstractPort>> ports,
          std::vector<std::variant<std::unique_ptr<StructuralStatement>,
                                   std::unique_ptr<Declaration>>>
              body,
          Parameters parameters)
-      : name(name),
+      : AbstractModule(NodeKind::Module),
+        name(name),
         ports(std::move(ports)),
         body(std::move(body)),
         parameters(std::move(parameters)){};
@@ -937,9 +1727,18 @@ class Module : public AbstractModule {
          std::vector<std::variant<std::unique_ptr<StructuralStatement>,
                                   std::unique_ptr<Declaration>>>
              body)
-      : name(name), ports(std::move(ports)), body(std::move(body)){};
+      : AbstractModule(NodeKind::Module),
+        name(name),
+        ports(std::move(ports)),
+        body(std::move(body)){};
 
-  std::string toString() override;
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::Module ||
+           node->getKind() == NodeKind::StringBodyModule;
+  }
+  void emit(Sink& sink) const override;
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
   ~Module(){};
 };
 
@@ -950,8 +1749,16 @@ class StringBodyModule : public Module {
   StringBodyModule(std::string name,
                    std::vector<std::unique_ptr<AbstractPort>> ports,
                    std::string body, Parameters parameters)
-      : Module(name, std::move(ports), std::move(parameters)), body(body){};
-  std::string toString() override;
+      : Module(NodeKind::StringBodyModule, name, std::move(ports),
+               std::move(parameters)),
+        body(body){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::StringBodyModule;
+  }
+  void emit(Sink& sink) const override;
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
   ~StringBodyModule(){};
 };
 
@@ -959,8 +1766,15 @@ class StringModule : public AbstractModule {
  public:
   std::string definition;
 
-  explicit StringModule(std::string definition) : definition(definition){};
-  std::string toString() { return definition; };
+  explicit StringModule(std::string definition)
+      : AbstractModule(NodeKind::StringModule), definition(definition){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::StringModule;
+  }
+  void emit(Sink& sink) const override { sink << definition; };
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
   ~StringModule(){};
 };
 
@@ -969,11 +1783,58 @@ class File : public Node {
   std::vector<std::unique_ptr<AbstractModule>> modules;
 
   explicit File(std::vector<std::unique_ptr<AbstractModule>>& modules)
-      : modules(std::move(modules)){};
-  std::string toString() override;
+      : Node(NodeKind::File), modules(std::move(modules)){};
+
+  static bool classof(const Node* node) {
+    return node->getKind() == NodeKind::File;
+  }
+  void emit(Sink& sink) const override;
+  std::size_t hash() const override;
+  bool structurallyEqual(const Node& other) const override;
+  // Renders up to `num_threads` modules concurrently into per-module buffers
+  // and writes them to `sink` in their original order, so the output is
+  // identical to `emit(sink)`. `num_threads <= 1` emits serially.
+  void emit(Sink& sink, unsigned int num_threads) const;
+  using Node::toString;
+  std::string toString(unsigned int num_threads) const;
+  // Destructive variant of `emit`: each module is freed once it has been
+  // written, so the written modules do not stay in memory until the end.
+  // `modules` is empty afterwards. If writing throws, it holds the modules
+  // not fully written yet.
+  void emitAndRelease(Sink& sink);
   ~File(){};
 };
 
+// Function objects for hashed containers keyed on nodes, e.g.
+// std::unordered_map<const Expression*, int, StructuralHash, StructuralEqual>
+struct StructuralHash {
+  std::size_t operator()(const Node* node) const { return node->hash(); }
+  template <typename T>
+  std::size_t operator()(const std::unique_ptr<T>& node) const {
+    return node->hash();
+  }
+  template <typename T>
+  std::size_t operator()(const std::shared_ptr<T>& node) const {
+    return node->hash();
+  }
+};
+
+struct StructuralEqual {
+  bool operator()(const Node* lhs, const Node* rhs) const {
+    return lhs->structurallyEqual(*rhs);
+  }
+  template <typename T>
+  bool operator()(const std::unique_ptr<T>& lhs,
+                  const std::unique_ptr<T>& rhs) const {
+    return lhs->structurallyEqual(*rhs);
+  }
+  template <typename T>
+  bool operator()(const std::shared_ptr<T>& lhs,
+                  const std::shared_ptr<T>& rhs) const {
+    return lhs->structurallyEqual(*rhs);
+  }
+};
+
 // Helper functions for constructing unique pointers
 std::unique_ptr<Identifier> make_id(std::string name);
 
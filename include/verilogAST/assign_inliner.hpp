@@ -1,172 +1,170 @@
 #pragma once
 #ifndef VERILOGAST_ASSIGN_INLINER_H
 #define VERILOGAST_ASSIGN_INLINER_H
+#include <limits>
+#include <optional>
 #include <set>
 #include "verilogAST.hpp"
+#include "verilogAST/const_visitor.hpp"
+#include "verilogAST/symbol_map.hpp"
 #include "verilogAST/transformer.hpp"
 
 namespace verilogAST {
 
-class AssignMapBuilder : public Transformer {
-  std::map<std::string, int> &assign_count;
-  std::map<std::string, std::unique_ptr<Expression>> &assign_map;
-  std::set<std::string> &non_input_ports;
-  std::set<std::string> &output_ports;
-  std::set<std::string> &input_ports;
+// The assign driving a signal, inside the module being inlined
+struct AssignDriver {
+  // Value slot of the assign statement, which owns the driver
+  const std::unique_ptr<Expression> *value = nullptr;
+};
+
+// Budget for the expressions created by AssignInliner. A signal is kept as a
+// wire when inlining it would make the expression it is inlined into larger
+// or deeper than the budget. The cost of an expression is the sum of the
+// weights of its nodes, its depth is the number of nodes along its longest
+// path. Unlimited by default.
+struct InlineCostModel {
+  unsigned int max_cost = std::numeric_limits<unsigned int>::max();
+  unsigned int max_depth = std::numeric_limits<unsigned int>::max();
+  // Identifiers and literals
+  unsigned int leaf_weight = 1;
+  unsigned int op_weight = 1;
+  // Multiplication, division, modulo and power
+  unsigned int mul_weight = 4;
+
+  bool unlimited() const {
+    return this->max_cost == std::numeric_limits<unsigned int>::max() &&
+           this->max_depth == std::numeric_limits<unsigned int>::max();
+  }
+};
+
+class AssignAnalyzer : public ConstVisitor {
+  // Collects everything the inliner needs to know about a module in a single
+  // traversal, replacing the former AssignMapBuilder, WireReadCounter and
+  // *Blacklister passes:
+  // * the driver and number of assigns of each signal assigned as a whole,
+  //   index and slice targets are never inlined
+  // * the number of times each signal is read
+  // * the port directions
+  // * the signals used where only simple drivers can be inlined, e.g.
+  //   wire [7:0] x;
+  //   assign x = y + z;
+  //   assign w = x[4:0];  // Verilog does not support (y + z)[4:0]
+  //   These are signals used inside an index, slice or `ifdef`, or connected
+  //   to a module instance (some tools do not support general expressions
+  //   inside module instance statements, but numeric literals are fine).
+  // * the signals assigned inside an `ifdef`, whose driver is conditional
+  // * the expressions outside the values of inlinable assigns that read
+  //   signals (e.g. NonBlockingAssign values, `If` conditions, call
+  //   arguments), which the cost model budget applies to as well
+  SymbolMap<int> &assign_count;
+  SymbolMap<AssignDriver> &assign_map;
+  SymbolMap<int> &read_count;
+  // Assign whose value contains the (last) read of each signal, or nullopt
+  // for a read outside any assign value
+  SymbolMap<std::optional<Symbol>> &read_sites;
+  SymbolSet &non_input_ports;
+  std::set<Symbol> &output_ports;
+  SymbolSet &input_ports;
+  // Signals whose driver must be checked, mapped to whether a numeric literal
+  // driver is allowed
+  SymbolMap<bool> &driver_checks;
+  SymbolSet &macro_targets;
+  std::vector<const Expression *> &read_roots;
+
+  // Assign targets are not reads
+  bool count_reads = true;
+  // Set while visiting a declaration, until the declared name is visited
+  bool in_declared_name = false;
+  // Assign whose value is being visited
+  std::optional<Symbol> current_assign;
+  // Set while visiting an expression outside an assign value, and whether it
+  // read a signal so far
+  bool in_read_root = false;
+  bool root_has_reads = false;
+  // Nesting depth of index, slice and `ifdef` nodes
+  int restricted_depth = 0;
+  // Nesting depth of `ifdef` nodes
+  int macro_depth = 0;
+  bool in_instance = false;
 
   template <typename T>
-  std::unique_ptr<T> process_assign(std::unique_ptr<T> node);
+  void process_assign(const T &node);
 
  public:
-  AssignMapBuilder(
-      std::map<std::string, int> &assign_count,
-      std::map<std::string, std::unique_ptr<Expression>> &assign_map,
-      std::set<std::string> &non_input_ports,
-      std::set<std::string> &output_ports, std::set<std::string> &input_ports)
+  AssignAnalyzer(SymbolMap<int> &assign_count,
+                 SymbolMap<AssignDriver> &assign_map,
+                 SymbolMap<int> &read_count,
+                 SymbolMap<std::optional<Symbol>> &read_sites,
+                 SymbolSet &non_input_ports, std::set<Symbol> &output_ports,
+                 SymbolSet &input_ports, SymbolMap<bool> &driver_checks,
+                 SymbolSet &macro_targets,
+                 std::vector<const Expression *> &read_roots)
       : assign_count(assign_count),
         assign_map(assign_map),
+        read_count(read_count),
+        read_sites(read_sites),
         non_input_ports(non_input_ports),
         output_ports(output_ports),
-        input_ports(input_ports){};
-
-  using Transformer::visit;
-  virtual std::unique_ptr<Port> visit(std::unique_ptr<Port> node);
-  virtual std::unique_ptr<ContinuousAssign> visit(
-      std::unique_ptr<ContinuousAssign> node);
-  virtual std::unique_ptr<BlockingAssign> visit(
-      std::unique_ptr<BlockingAssign> node);
-};
-
-class WireReadCounter : public Transformer {
-  // Counts number of times a wire is read
-  //
-  std::map<std::string, int> &read_count;
-
-  template <typename T>
-  std::unique_ptr<T> process_assign(std::unique_ptr<T> node);
-
- public:
-  WireReadCounter(std::map<std::string, int> &read_count)
-      : read_count(read_count){};
-
-  using Transformer::visit;
-  // Increment read count
-  virtual std::unique_ptr<Identifier> visit(std::unique_ptr<Identifier> node);
-  // Skip target of assign (not read)
-  virtual std::unique_ptr<ContinuousAssign> visit(
-      std::unique_ptr<ContinuousAssign> node);
-  virtual std::unique_ptr<BlockingAssign> visit(
-      std::unique_ptr<BlockingAssign> node);
-  // Skip declarations (not read)
-  virtual std::unique_ptr<Declaration> visit(std::unique_ptr<Declaration> node);
-};
-
-class Blacklister : public Transformer {
-  std::set<std::string> &wire_blacklist;
-  std::map<std::string, std::unique_ptr<Expression>> &assign_map;
-
- protected:
-  bool blacklist = false;
-  // Allow numeric literals as valid drivers (okay for module instances, not
-  // okay for slice/index)
-  virtual bool allowNumDriver() { return false; };
-  void blacklist_invalid_driver(std::unique_ptr<Identifier> node);
-
- public:
-  Blacklister(std::set<std::string> &wire_blacklist,
-              std::map<std::string, std::unique_ptr<Expression>> &assign_map)
-      : wire_blacklist(wire_blacklist), assign_map(assign_map){};
-  using Transformer::visit;
-  virtual std::unique_ptr<Identifier> visit(std::unique_ptr<Identifier> node);
-};
-
-class SliceBlacklister : public Blacklister {
-  // Prevent inling wires into slice nodes, e.g.
-  // wire [7:0] x;
-  // assign x = y + z;
-  // assign w = x[4:0];
-  //
-  // Verilog does not support (y + z)[4:0]
- public:
-  SliceBlacklister(
-      std::set<std::string> &wire_blacklist,
-      std::map<std::string, std::unique_ptr<Expression>> &assign_map)
-      : Blacklister(wire_blacklist, assign_map){};
-  using Blacklister::visit;
-  virtual std::unique_ptr<Slice> visit(std::unique_ptr<Slice> node);
-};
-
-class IndexBlacklister : public Blacklister {
-  // Prevent inling wires into index nodes, e.g.
-  // wire x;
-  // assign x = y + z;
-  // assign w = x[0];
-  //
-  // Verilog does not support (y + z)[0]
- public:
-  IndexBlacklister(
-      std::set<std::string> &wire_blacklist,
-      std::map<std::string, std::unique_ptr<Expression>> &assign_map)
-      : Blacklister(wire_blacklist, assign_map){};
-  using Blacklister::visit;
-  virtual std::unique_ptr<Index> visit(std::unique_ptr<Index> node);
-};
-
-class IfMacroBlacklister : public Blacklister {
-  // Prevent inling wires defined inside a macro, e.g.
-  // `ifdef ASSERT_ON
-  // assign x = y + z;
-  // assign w = x[0];
-  // `else
-  // assign x = 0;
-  // assign w = 0;
-  // `endif
- public:
-  IfMacroBlacklister(
-      std::set<std::string> &wire_blacklist,
-      std::map<std::string, std::unique_ptr<Expression>> &assign_map)
-      : Blacklister(wire_blacklist, assign_map){};
-  using Blacklister::visit;
-  virtual std::unique_ptr<IfMacro> visit(std::unique_ptr<IfMacro> node);
-};
-
-class ModuleInstanceBlacklister : public Blacklister {
-  // Prevent inling wires into module instance nodes, e.g.
-  // wire z;
-  // assign b = a;
-  // assign z = i + a;  // <--- not inlined into .w below
-  // inner_module inner_module_inst (
-  //     .c(a),
-  //     .i(i),
-  //     .w(z),
-  //     .o(o)
-  // );
-  //
-  // We can make this configurable, but for now we keep it as the default since
-  // some tools do not support general expressions inside module instance
-  // statements
- protected:
-  bool allowNumDriver() override { return true; };
-
- public:
-  ModuleInstanceBlacklister(
-      std::set<std::string> &wire_blacklist,
-      std::map<std::string, std::unique_ptr<Expression>> &assign_map)
-      : Blacklister(wire_blacklist, assign_map){};
-  using Blacklister::visit;
-  virtual std::unique_ptr<ModuleInstantiation> visit(
-      std::unique_ptr<ModuleInstantiation> node) override;
+        input_ports(input_ports),
+        driver_checks(driver_checks),
+        macro_targets(macro_targets),
+        read_roots(read_roots){};
+
+  using ConstVisitor::visit;
+  void visit(const Expression &node) override;
+  void visit(const Identifier &node) override;
+  void visit(const Index &node) override;
+  void visit(const Slice &node) override;
+  void visit(const Port &node) override;
+  void visit(const IfMacro &node) override;
+  void visit(const ModuleInstantiation &node) override;
+  void visit(const ContinuousAssign &node) override;
+  void visit(const BlockingAssign &node) override;
+  void visit(const Declaration &node) override;
 };
 
 class AssignInliner : public Transformer {
-  std::map<std::string, int> read_count;
-  std::map<std::string, int> assign_count;
-  std::map<std::string, std::unique_ptr<Expression>> assign_map;
-  std::set<std::string> non_input_ports;
-  std::set<std::string> output_ports;
-  std::set<std::string> input_ports;
-  std::set<std::string> inlined_outputs;
-  std::set<std::string> wire_blacklist;
+  // Configuration, shared by every module
+  SymbolSet blacklist;
+  InlineCostModel cost_model;
+
+  // The rest is the state of the module being inlined, reset for each module
+  SymbolMap<int> read_count;
+  SymbolMap<int> assign_count;
+  // Drivers and read sites point into the current module, they are cleared
+  // once it is inlined
+  SymbolMap<AssignDriver> assign_map;
+  // Kept alive until the module is done, their values may still be inlined
+  std::vector<std::unique_ptr<Assign>> removed_assigns;
+  SymbolMap<std::optional<Symbol>> read_sites;
+  // Expressions outside inlinable assign values that read signals, the reads
+  // inlined into them count against the cost model budget too
+  std::vector<const Expression *> read_roots;
+  // Signals replaced by their driver
+  SymbolSet inlinable;
+  // Inlined signals driven by another signal, mapped to that signal (or a
+  // later one along the chain)
+  SymbolMap<Symbol> aliases;
+  // Copies of the drivers of inlined signals whose assign is kept, taken
+  // before the assign is rewritten
+  SymbolMap<std::unique_ptr<Expression>> kept_drivers;
+  // See `driver_uses`
+  SymbolMap<int> driver_use_counts;
+  SymbolSet non_input_ports;
+  // Ordered, the order outputs are reverse inlined in is visible in the output
+  std::set<Symbol> output_ports;
+  SymbolSet input_ports;
+  SymbolSet inlined_outputs;
+  // `blacklist` and the signals found not inlinable in the current module
+  SymbolSet wire_blacklist;
+  SymbolMap<bool> driver_checks;
+  // Signals assigned inside an `ifdef`, never inlined or reverse inlined
+  SymbolSet macro_targets;
+  SymbolMap<Symbol> chain_ends;
+  // Wires replaced by the output they drive ("reverse inlined")
+  SymbolMap<Symbol> output_renames;
+
+  void clear_module_state();
 
   std::vector<std::variant<std::unique_ptr<StructuralStatement>,
                            std::unique_ptr<Declaration>>>
@@ -174,16 +172,60 @@ class AssignInliner : public Transformer {
                                      std::unique_ptr<Declaration>>>
                 body);
 
-  bool can_inline(std::string key);
+  // Fills `inlinable` and `aliases`
+  void find_inlinable();
+  // Removes the signals that would exceed the cost model budget from
+  // `inlinable`
+  void apply_cost_model();
+  bool can_inline(Symbol key);
+  // First signal along the chain of inlined identifier drivers starting at
+  // `key` that is not an alias
+  Symbol resolve_alias(Symbol key);
+  // Whether inlining removes the assign driving `key`
+  bool removes_assign(Symbol key);
+  // Number of reads of `key` that inlining replaces
+  int replaced_reads(Symbol key);
+  // Number of copies of the driver of `key` in the inlined module (1 if it is
+  // not inlined), saturated at 2
+  int driver_uses(Symbol key);
+  // Driver of `key` to inline at a read. Moved out of the removed assign if
+  // this is its only use, copied otherwise.
+  std::unique_ptr<Expression> take_driver(Symbol key);
+  // Last signal along the chain of identifier drivers starting at `key`,
+  // stopping at blacklisted signals. Memoized in `chain_ends`, so resolving
+  // the chains of all signals is linear.
+  Symbol chain_end(Symbol key);
+  // Blacklists the end of the chain of identifier drivers starting at `key`
+  // if it has an invalid driver
+  void check_driver(Symbol key, bool allow_num_driver);
+  // Name `key` is emitted as after reverse inlining outputs
+  Symbol renamed(Symbol key);
+  void reverse_inline_outputs();
 
   template <typename T>
   std::unique_ptr<T> process_assign(std::unique_ptr<T> node);
 
  public:
-  AssignInliner() : wire_blacklist(){};
-  explicit AssignInliner(std::set<std::string> wire_blacklist)
-      : wire_blacklist(wire_blacklist){};
+  AssignInliner() : blacklist(){};
+  explicit AssignInliner(const std::set<std::string> &wire_blacklist) {
+    for (const auto &wire : wire_blacklist) {
+      this->blacklist.insert(Symbol(wire));
+    }
+  };
+  void setCostModel(const InlineCostModel &cost_model) {
+    this->cost_model = cost_model;
+  }
   using Transformer::visit;
+  // Inlines up to `num_threads` modules concurrently, each with its own
+  // inliner from `makeWorker` configured like this one, modules do not depend
+  // on each other. `num_threads <= 1` inlines serially.
+  std::unique_ptr<File> visit(std::unique_ptr<File> node,
+                              unsigned int num_threads);
+  // Inliner used by a worker thread of the parallel `visit`, or nullptr to
+  // inline the modules serially with this inliner. The default only creates
+  // workers for a plain AssignInliner, subclasses have to return an instance
+  // of themselves to be run in parallel.
+  virtual std::unique_ptr<AssignInliner> makeWorker() const;
   virtual std::unique_ptr<Expression> visit(std::unique_ptr<Expression> node);
   virtual std::unique_ptr<Index> visit(std::unique_ptr<Index> node);
   virtual std::unique_ptr<ContinuousAssign> visit(
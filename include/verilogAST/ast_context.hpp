@@ -0,0 +1,82 @@
+#pragma once
+#ifndef VERILOGAST_AST_CONTEXT_H
+#define VERILOGAST_AST_CONTEXT_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+
+// Bump pointer arena for AST nodes.
+//
+// While an `ASTContext::Scope` is alive, every node created on that thread
+// (`std::make_unique`, `make_id`, `clone()`, pass rewrites, ...) is placed in
+// the context, so nodes built together sit next to each other in memory.
+// Nodes are still owned through `std::unique_ptr` and tearing down a tree
+// still runs the destructor of every node, which frees their strings, vectors
+// and children one at a time. Only the nodes' own memory is not freed by
+// `delete`, it is released with the context's chunks when the context is
+// destroyed.
+//
+// All nodes allocated in a context must be destroyed before the context,
+// including nodes that escape the scope (e.g. into an ExprInterner table).
+// The context counts its live nodes and aborts if any are left when it is
+// destroyed. A context must only be allocated from by one thread at a time,
+// its nodes can be deleted from any thread.
+class ASTContext {
+  std::size_t chunk_size;
+  // Start and size of each chunk
+  std::vector<std::pair<char*, std::size_t>> chunks;
+  char* next = nullptr;
+  std::size_t remaining = 0;
+  std::size_t bytes_allocated = 0;
+  // Nodes allocated in this context and not deleted yet
+  std::atomic<std::size_t> live_nodes{0};
+  friend class Node;
+
+  // New chunk of at least `size` bytes, owned by this context
+  void* allocate_chunk(std::size_t size);
+
+ public:
+  explicit ASTContext(std::size_t chunk_size = 1 << 16)
+      : chunk_size(chunk_size){};
+  ASTContext(const ASTContext&) = delete;
+  ASTContext& operator=(const ASTContext&) = delete;
+  ~ASTContext();
+
+  // Makes `context` the current context of this thread until the scope ends,
+  // scopes can be nested
+  class Scope {
+    ASTContext* previous;
+
+   public:
+    explicit Scope(ASTContext& context);
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    ~Scope();
+  };
+
+  // Constructs a `T` (and any nodes its constructor creates) in this context
+  template <typename T, typename... Args>
+  std::unique_ptr<T> make(Args&&... args) {
+    Scope scope(*this);
+    return std::make_unique<T>(std::forward<Args>(args)...);
+  }
+
+  void* allocate(std::size_t size);
+
+  // Total bytes handed out by `allocate`
+  std::size_t bytesAllocated() const { return this->bytes_allocated; }
+  // Number of nodes of this context that have not been deleted
+  std::size_t liveNodes() const { return this->live_nodes.load(); }
+
+  // Context used for node allocation on this thread, or nullptr for the heap
+  static ASTContext* current();
+};
+
+}  // namespace verilogAST
+#endif
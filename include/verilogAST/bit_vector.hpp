@@ -0,0 +1,72 @@
+#pragma once
+#ifndef VERILOGAST_BIT_VECTOR_H
+#define VERILOGAST_BIT_VECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace verilogAST {
+
+// Fixed width unsigned integer of arbitrary width. Values of 64 bits or fewer
+// are stored inline, wider values in 64 bit words (least significant first).
+// Bits above the width are always zero.
+class BitVector {
+  unsigned int width_ = 0;
+  std::uint64_t inline_word = 0;
+  // Only used if width_ > 64
+  std::vector<std::uint64_t> words;
+
+  std::uint64_t* data() {
+    return this->words.empty() ? &this->inline_word : this->words.data();
+  }
+  void clearUnusedBits();
+
+ public:
+  BitVector() = default;
+  // Truncates `value` to `width` bits
+  explicit BitVector(unsigned int width, std::uint64_t value = 0);
+
+  // Parses the digits of a Verilog literal in the given base (2, 8, 10 or 16),
+  // `_` separators are skipped. The value is truncated to `width` bits.
+  // Returns std::nullopt if `digits` is empty or contains anything else (e.g.
+  // x/z digits).
+  static std::optional<BitVector> parse(std::string_view digits,
+                                        unsigned int base, unsigned int width);
+
+  unsigned int width() const { return this->width_; }
+  std::size_t numWords() const { return (this->width_ + 63) / 64; }
+  const std::uint64_t* data() const {
+    return this->words.empty() ? &this->inline_word : this->words.data();
+  }
+
+  bool getBit(unsigned int index) const {
+    return (this->data()[index / 64] >> (index % 64)) & 1;
+  }
+  void setBit(unsigned int index, bool value);
+
+  // Number of bits needed to represent the value (0 for zero)
+  unsigned int activeBits() const;
+  bool isZero() const { return this->activeBits() == 0; }
+  bool fitsUInt64() const { return this->activeBits() <= 64; }
+  // Low 64 bits of the value
+  std::uint64_t toUInt64() const { return this->width_ ? this->data()[0] : 0; }
+
+  // Zero extends or truncates to `width` bits
+  void resize(unsigned int width);
+
+  // Digits of the value in the given base (2, 8, 10 or 16), without leading
+  // zeros
+  std::string toString(unsigned int base) const;
+
+  std::size_t hash() const;
+  bool operator==(const BitVector& rhs) const;
+  bool operator!=(const BitVector& rhs) const { return !(*this == rhs); }
+};
+
+}  // namespace verilogAST
+
+#endif  // VERILOGAST_BIT_VECTOR_H
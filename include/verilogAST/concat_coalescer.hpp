@@ -2,15 +2,37 @@
 #define VERILOGAST_CONCAT_COALESCER_H
 
 #include "verilogAST.hpp"
+#include "verilogAST/hash_cons.hpp"
+#include "verilogAST/mutating_visitor.hpp"
 #include "verilogAST/transformer.hpp"
 
 namespace verilogAST {
 
 class ConcatCoalescer : public Transformer {
  public:
+  // If `pool` is given, the index constants of generated runs are taken from
+  // it instead of allocating a new literal for each
+  explicit ConcatCoalescer(LiteralPool* pool = nullptr) : pool_(pool) {}
+
   using Transformer::visit;
 
   std::unique_ptr<Expression> visit(std::unique_ptr<Expression> node) override;
+
+ private:
+  LiteralPool* const pool_;
+};
+
+// ConcatCoalescer as a MutatingVisitor, rewrites the tree in place
+class ConcatCoalescerInPlace : public MutatingVisitor {
+ public:
+  explicit ConcatCoalescerInPlace(LiteralPool* pool = nullptr) : pool_(pool) {}
+
+  using MutatingVisitor::visit;
+
+  void visit(std::unique_ptr<Expression>& node) override;
+
+ private:
+  LiteralPool* const pool_;
 };
 
 }  // namespace verilogAST
@@ -0,0 +1,76 @@
+#pragma once
+#ifndef VERILOGAST_CONST_VISITOR_H
+#define VERILOGAST_CONST_VISITOR_H
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+
+// Walks the AST without modifying it, for passes that only analyze it.
+// Unlike Transformer, the tree is not moved through the visitor, so a
+// ConstVisitor does not need to own it and several of them can walk the same
+// tree from different threads.
+//
+// Abstract nodes (e.g. `visit(const Expression &)`) dispatch on the kind of
+// the node, the other overloads visit the children of a node. A shared
+// expression is visited as the expression it refers to.
+class ConstVisitor {
+ public:
+  virtual ~ConstVisitor() = default;
+
+  template <typename... Ts>
+  void visit(const std::variant<Ts...> &node) {
+    std::visit([&](auto &value) { this->visit(*value); }, node);
+  }
+
+  virtual void visit(const Expression &node);
+  virtual void visit(const NumericLiteral &node);
+  virtual void visit(const Identifier &node);
+  virtual void visit(const Cast &node);
+  virtual void visit(const Attribute &node);
+  virtual void visit(const String &node);
+  virtual void visit(const Index &node);
+  virtual void visit(const Slice &node);
+  virtual void visit(const BinaryOp &node);
+  virtual void visit(const UnaryOp &node);
+  virtual void visit(const TernaryOp &node);
+  virtual void visit(const Concat &node);
+  virtual void visit(const Replicate &node);
+  virtual void visit(const CallExpr &node);
+  virtual void visit(const SharedExpr &node);
+
+  virtual void visit(const NegEdge &node);
+  virtual void visit(const PosEdge &node);
+  virtual void visit(const Star &node);
+
+  virtual void visit(const Vector &node);
+
+  virtual void visit(const AbstractPort &node);
+  virtual void visit(const Port &node);
+  virtual void visit(const StringPort &node);
+
+  virtual void visit(const StructuralStatement &node);
+  virtual void visit(const Declaration &node);
+  virtual void visit(const BehavioralStatement &node);
+  virtual void visit(const SingleLineComment &node);
+  virtual void visit(const BlockComment &node);
+  virtual void visit(const InlineVerilog &node);
+  virtual void visit(const IfMacro &node);
+  virtual void visit(const ModuleInstantiation &node);
+  virtual void visit(const Wire &node);
+  virtual void visit(const Reg &node);
+  virtual void visit(const ContinuousAssign &node);
+  virtual void visit(const BlockingAssign &node);
+  virtual void visit(const NonBlockingAssign &node);
+  virtual void visit(const CallStmt &node);
+  virtual void visit(const If &node);
+  virtual void visit(const Always &node);
+
+  virtual void visit(const AbstractModule &node);
+  virtual void visit(const Module &node);
+  virtual void visit(const StringBodyModule &node);
+  virtual void visit(const StringModule &node);
+  virtual void visit(const File &node);
+};
+
+}  // namespace verilogAST
+#endif
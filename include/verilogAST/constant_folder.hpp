@@ -0,0 +1,47 @@
+#ifndef VERILOGAST_CONSTANT_FOLDER_H
+#define VERILOGAST_CONSTANT_FOLDER_H
+
+#include "verilogAST.hpp"
+#include "verilogAST/transformer.hpp"
+
+namespace verilogAST {
+
+// Evaluates BinaryOp, UnaryOp and TernaryOp nodes whose operands are numeric
+// literals (of at most 64 bits), in one bottom-up pass.
+//
+// Verilog extends context-determined operands to the width of the enclosing
+// expression, so a literal only replaces an operator if it has the same value
+// in every context: `8'd3 + 8'd4` becomes `8'd7`, but `8'd200 + 8'd100`,
+// `~8'd0` or `8'd3 - 8'd4` are left alone since their value depends on the
+// width they are evaluated at. Comparisons, logical and reduction operators
+// always fold to a 1 bit literal.
+//
+// With `fold_identities`, identity and annihilator patterns with one literal
+// operand are folded as well (`x + 0`, `x * 1`, `x | 0` become `x`, `x & 0`
+// becomes the literal, and a constant condition selects a branch of a
+// TernaryOp), but only where the result provably has the same width and
+// signedness. The width of an identifier is not known, so e.g. `x + 1'sb0`
+// becomes `x` but `x + 0` does not (`x` may be narrower than 32 bits). Like
+// the operators they replace, these never change the value of a known bit,
+// although `x + 0` no longer makes the whole result unknown when `x` has an
+// `x` or `z` bit. `x && 0`, `x || 1` and `x << 0` are always folded.
+class ConstantFolder : public Transformer {
+ public:
+  explicit ConstantFolder(bool fold_identities = false)
+      : fold_identities_(fold_identities) {}
+
+  using Transformer::visit;
+
+  std::unique_ptr<Expression> visit(std::unique_ptr<Expression> node) override;
+
+ private:
+  std::unique_ptr<Expression> fold(std::unique_ptr<BinaryOp> node);
+  std::unique_ptr<Expression> fold(std::unique_ptr<UnaryOp> node);
+  std::unique_ptr<Expression> fold(std::unique_ptr<TernaryOp> node);
+
+  const bool fold_identities_;
+};
+
+}  // namespace verilogAST
+
+#endif  // VERILOGAST_CONSTANT_FOLDER_H
@@ -0,0 +1,74 @@
+#pragma once
+#ifndef VERILOGAST_FILE_WRITER_H
+#define VERILOGAST_FILE_WRITER_H
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "verilogAST.hpp"
+#include "verilogAST/sink.hpp"
+
+namespace verilogAST {
+
+// Incremental counterpart of `File`: modules are appended one at a time as
+// they are produced, rendered into a large buffer and freed immediately. Full
+// buffers are written to the sink, optionally by a background thread so that
+// building the next modules overlaps with I/O (the buffer being filled and the
+// one being written are swapped, i.e. double buffering).
+//
+// The output is identical to `File::toString()` for the same modules.
+class FileWriter {
+  std::unique_ptr<FdSink> owned_sink;
+  int fd = -1;
+  Sink* sink;
+  std::size_t buffer_size;
+  std::string buffer;
+  bool first = true;
+  bool closed = false;
+
+  // Background writer state, `pending` is owned by the writer thread while
+  // `has_pending` is set
+  std::thread writer;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::string pending;
+  bool has_pending = false;
+  bool stopping = false;
+  std::exception_ptr error;
+
+  void start(bool background);
+  void submit();
+  void write_pending();
+
+ public:
+  // Writes to a caller owned sink, which must outlive the writer
+  explicit FileWriter(Sink& sink, bool background = false,
+                      std::size_t buffer_size = 1 << 20);
+  // Creates (or truncates) the file at `path`
+  explicit FileWriter(const std::string& path, bool background = false,
+                      std::size_t buffer_size = 1 << 20);
+  FileWriter(const FileWriter&) = delete;
+  FileWriter& operator=(const FileWriter&) = delete;
+
+  // Renders `module` (with the options of the sink) and releases it
+  void append(std::unique_ptr<AbstractModule> module);
+
+  // Sets the options modules are rendered with, e.g. for a writer that opened
+  // its own file
+  void setOptions(const EmitOptions& options) {
+    this->sink->setOptions(options);
+  }
+
+  // Writes out any buffered output, stops the background thread and closes
+  // the file (if opened by the writer). Rethrows errors raised while writing.
+  void close();
+
+  // Closes the writer, errors are dropped (call `close()` to observe them)
+  ~FileWriter();
+};
+
+}  // namespace verilogAST
+#endif
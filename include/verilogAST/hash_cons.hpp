@@ -0,0 +1,105 @@
+#pragma once
+#ifndef VERILOGAST_HASH_CONS_H
+#define VERILOGAST_HASH_CONS_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include "verilogAST.hpp"
+#include "verilogAST/static_transformer.hpp"
+#include "verilogAST/transformer.hpp"
+
+namespace verilogAST {
+
+// Hash-conses expressions: every expression visited is replaced by a
+// SharedExpr, and structurally equal expressions (across all trees visited
+// with the same interner) refer to a single immutable node. Cloning an
+// interned expression only copies a reference, and repeated subexpressions
+// are stored once.
+//
+// Interned expressions are visited like any other expression by other passes
+// (see `Transformer::visit(std::unique_ptr<SharedExpr>)`); code inspecting
+// the kind of an expression directly should look through references with
+// `strip_shared`.
+//
+// Only expression slots typed `std::unique_ptr<Expression>` are interned,
+// e.g. the identifier of an Index is kept as is. An interner is not thread
+// safe.
+//
+// StaticExprInterner does the interning, written against StaticTransformer so
+// the expression traversal is resolved at compile time. ExprInterner is the
+// Transformer wrapping it: modules and statements are traversed as by any
+// Transformer, and each expression reached is interned by the
+// StaticExprInterner, so overriding the visit of a node inside an
+// expression in a subclass of ExprInterner has no effect.
+class StaticExprInterner : public StaticTransformer<StaticExprInterner> {
+  std::unordered_map<const Expression*, std::shared_ptr<const Expression>,
+                     StructuralHash, StructuralEqual>
+      table;
+
+ public:
+  using StaticTransformer<StaticExprInterner>::visit;
+  std::unique_ptr<Expression> visit(std::unique_ptr<Expression> node);
+  // Already interned
+  std::unique_ptr<Expression> visit(std::unique_ptr<SharedExpr> node) {
+    return node;
+  }
+
+  // Number of distinct expressions interned
+  std::size_t size() const { return this->table.size(); }
+};
+
+class ExprInterner : public Transformer {
+  StaticExprInterner interner;
+
+ public:
+  using Transformer::visit;
+  std::unique_ptr<Expression> visit(std::unique_ptr<Expression> node) override {
+    return this->interner.visit(std::move(node));
+  }
+  // Already interned
+  std::unique_ptr<Expression> visit(std::unique_ptr<SharedExpr> node) override {
+    return node;
+  }
+
+  // Interns `node` and returns a reference to the shared expression
+  std::unique_ptr<SharedExpr> intern(std::unique_ptr<Expression> node);
+
+  // Number of distinct expressions interned
+  std::size_t size() const { return this->interner.size(); }
+};
+
+// Flyweight pool of NumericLiterals. Every request for the same (value, size,
+// signed, radix, always_codegen_size) returns a reference to one shared
+// literal, so frequent constants take memory once no matter how often they
+// occur. A pool can be shared between threads.
+class LiteralPool {
+  using Key = std::tuple<std::string, unsigned int, bool, Radix, bool>;
+  struct KeyHash {
+    std::size_t operator()(const Key& key) const;
+  };
+
+  std::mutex mutex;
+  std::unordered_map<Key, std::shared_ptr<const NumericLiteral>, KeyHash>
+      literals;
+
+ public:
+  std::unique_ptr<SharedExpr> get(std::string value, unsigned int size = 32,
+                                  bool _signed = false,
+                                  Radix radix = Radix::DECIMAL,
+                                  bool always_codegen_size = false);
+  // Unsized decimal literal
+  std::unique_ptr<SharedExpr> get(int value) {
+    return this->get(std::to_string(value));
+  }
+
+  // Number of distinct literals in the pool
+  std::size_t size();
+};
+
+}  // namespace verilogAST
+
+#endif  // VERILOGAST_HASH_CONS_H
@@ -0,0 +1,90 @@
+#pragma once
+#ifndef VERILOGAST_INCREMENTAL_ASSIGN_INLINER_H
+#define VERILOGAST_INCREMENTAL_ASSIGN_INLINER_H
+#include <set>
+#include <unordered_set>
+#include "verilogAST.hpp"
+#include "verilogAST/assign_inliner.hpp"
+#include "verilogAST/symbol_map.hpp"
+
+namespace verilogAST {
+
+// Keeps a module inlined while it is edited. The body is edited through
+// `insert`, `erase` and `replace`, then `update` runs AssignInliner over the
+// statements the edits can affect instead of the whole module.
+//
+// Inlining a statement depends only on the signals that can be inlined or
+// renamed: signals that are assigned, output ports, and signals other than
+// inputs driving an output port. Each of them couples every statement that
+// mentions it (its assigns, reads and declaration). The statements affected
+// by an edit are the edited ones and those coupled to them, transitively,
+// i.e. the fan-in and fan-out cone of the edited signals. Other statements
+// are left as they are, and the signals each statement mentions are kept
+// across updates.
+//
+// `update` still scans the body once to pull the cone out and put it back,
+// which only moves pointers. Like AssignInliner, it leaves the module in an
+// unspecified state if inlining throws.
+class IncrementalAssignInliner {
+ public:
+  using Statement = std::variant<std::unique_ptr<StructuralStatement>,
+                                 std::unique_ptr<Declaration>>;
+
+ private:
+  // Signals mentioned by a statement of the body
+  struct Entry {
+    std::vector<Symbol> signals;
+    // Signals assigned, once per assign
+    std::vector<Symbol> targets;
+    // Signals assigned to an output port as is, once per assign
+    std::vector<Symbol> output_drivers;
+    bool in_cone = false;
+  };
+
+  std::unique_ptr<Module> module;
+  // Parallel to the body of `module`
+  std::vector<std::unique_ptr<Entry>> entries;
+  SymbolMap<std::unordered_set<Entry *>> mentions;
+  SymbolMap<int> assign_count;
+  SymbolMap<int> output_driver_count;
+  SymbolSet output_ports;
+  SymbolSet input_ports;
+  // Edited since the last update
+  std::unordered_set<Entry *> pending;
+  std::vector<Symbol> seeds;
+  AssignInliner inliner;
+
+  bool couples(Symbol signal) const;
+  void index(Entry &entry, const Statement &statement);
+  void unindex(Entry &entry);
+  // Seeds the cone with the signals of `entry` coupling statements
+  void seed(const Entry &entry);
+
+ public:
+  // The whole module is inlined by the first update
+  explicit IncrementalAssignInliner(std::unique_ptr<Module> module)
+      : IncrementalAssignInliner(std::move(module), {}){};
+  IncrementalAssignInliner(std::unique_ptr<Module> module,
+                           const std::set<std::string> &wire_blacklist);
+
+  void setCostModel(const InlineCostModel &cost_model) {
+    this->inliner.setCostModel(cost_model);
+  }
+
+  // Edits of the body, `index` is the position of a statement in the body of
+  // `getModule()`
+  void insert(std::size_t index, Statement statement);
+  void erase(std::size_t index);
+  void replace(std::size_t index, Statement statement);
+
+  // Inlines the cone of the edits since the last update, returns the number
+  // of statements inlined
+  std::size_t update();
+
+  const Module &getModule() const { return *this->module; }
+  // Gives up the module, edits since the last update are not inlined
+  std::unique_ptr<Module> release() { return std::move(this->module); }
+};
+
+}  // namespace verilogAST
+#endif
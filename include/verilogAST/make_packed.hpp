@@ -2,6 +2,7 @@
 #define VERILOGAST_MAKE_PACKED_H
 
 #include "verilogAST.hpp"
+#include "verilogAST/mutating_visitor.hpp"
 #include "verilogAST/transformer.hpp"
 
 namespace verilogAST {
@@ -15,6 +16,16 @@ class MakePacked : public Transformer {
   std::unique_ptr<Vector> visit(std::unique_ptr<Vector> vector) override;
 };
 
+// MakePacked as a MutatingVisitor, rewrites the tree in place
+class MakePackedInPlace : public MutatingVisitor {
+ public:
+  MakePackedInPlace() = default;
+
+  using MutatingVisitor::visit;
+
+  void visit(std::unique_ptr<Vector>& vector) override;
+};
+
 }  // namespace verilogAST
 
 #endif  // VERILOGAST_MAKE_PACKED_H
@@ -0,0 +1,167 @@
+#pragma once
+#ifndef VERILOGAST_MUTATING_VISITOR_H
+#define VERILOGAST_MUTATING_VISITOR_H
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+
+// Visits the AST in place. Unlike Transformer, which moves every child into
+// `visit` and assigns the result back, nodes are visited through references
+// and a child pointer is only reassigned when a pass rewrites it.
+//
+// Node references (e.g. `visit(BinaryOp &)`) visit the children of a node.
+// Owning pointers are visited where a pass may replace the node: expressions,
+// vectors, ports, statements, declarations and modules. A pass replaces a
+// node with `replace`, or calls `markModified` after changing it in place,
+// so the hashes cached by the expressions containing it are invalidated.
+class MutatingVisitor {
+  // Set once the subtree being visited has changed
+  bool modified = false;
+
+  // Result of each shared expression visited by `visitMemoized`, keyed by the
+  // referenced expression (kept alive so the key is not reused)
+  std::unordered_map<const Expression *,
+                     std::pair<std::shared_ptr<const Expression>,
+                               std::shared_ptr<const Expression>>>
+      shared_results;
+  bool memoize_shared = false;
+
+  // Visits the children of `node` with `visit_fn`, then invalidates its
+  // hash if any of them changed
+  template <typename F>
+  void visit_children(Expression &node, F visit_fn);
+  // Visits the SharedExpr `node` through a copy of the shared expression
+  void visit_shared(std::unique_ptr<Expression> &node);
+
+  // Nodes a pass may replace, visited through their owning pointer
+  template <typename T>
+  static constexpr bool replaceable =
+      std::is_same_v<T, Expression> || std::is_same_v<T, Vector> ||
+      std::is_same_v<T, AbstractPort> ||
+      std::is_same_v<T, StructuralStatement> ||
+      std::is_same_v<T, Declaration> ||
+      std::is_same_v<T, BehavioralStatement> ||
+      std::is_same_v<T, AbstractModule>;
+
+ protected:
+  template <typename T, typename U>
+  void replace(std::unique_ptr<T> &node, std::unique_ptr<U> replacement) {
+    node = std::move(replacement);
+    this->modified = true;
+  }
+  void markModified() { this->modified = true; }
+
+ public:
+  virtual ~MutatingVisitor() = default;
+
+  // Visits a node owned by the caller, so a MutatingVisitor can be used like
+  // a Transformer. As with Transformer, any expression is returned as an
+  // Expression since a pass may replace it with another kind of expression.
+  template <typename T>
+  auto visit(std::unique_ptr<T> node) {
+    if constexpr (std::is_base_of_v<Expression, T>) {
+      std::unique_ptr<Expression> expr = std::move(node);
+      this->visit(expr);
+      return expr;
+    } else {
+      if constexpr (replaceable<T>) {
+        this->visit(node);
+      } else {
+        this->visit(*node);
+      }
+      return node;
+    }
+  }
+
+  // Visits `node` like `visit`, but each shared expression is visited once:
+  // every reference to it is replaced by a reference to the same (shared)
+  // result, so a pass over a hash-consed DAG does work per DAG node instead
+  // of per path. Only for passes that rewrite an expression the same way
+  // wherever it occurs.
+  template <typename T>
+  auto visitMemoized(std::unique_ptr<T> node) {
+    if (this->memoize_shared) return this->visit(std::move(node));
+    this->memoize_shared = true;
+    struct Reset {
+      MutatingVisitor *visitor;
+      ~Reset() {
+        visitor->memoize_shared = false;
+        visitor->shared_results.clear();
+      }
+    } reset{this};
+    return this->visit(std::move(node));
+  }
+
+  template <typename... Ts>
+  void visit(std::variant<Ts...> &node) {
+    std::visit(
+        [&](auto &value) {
+          using T = typename std::decay_t<decltype(value)>::element_type;
+          if constexpr (replaceable<T>) {
+            this->visit(value);
+          } else {
+            this->visit(*value);
+          }
+        },
+        node);
+  }
+
+  // A shared expression is visited as a copy, which replaces it only if the
+  // pass changed it. Within `visitMemoized` the result is shared as well, and
+  // reused for the other references to the same expression.
+  virtual void visit(std::unique_ptr<Expression> &node);
+  virtual void visit(NumericLiteral &node);
+  virtual void visit(Identifier &node);
+  virtual void visit(Cast &node);
+  virtual void visit(Attribute &node);
+  virtual void visit(String &node);
+  virtual void visit(Index &node);
+  virtual void visit(Slice &node);
+  virtual void visit(BinaryOp &node);
+  virtual void visit(UnaryOp &node);
+  virtual void visit(TernaryOp &node);
+  virtual void visit(Concat &node);
+  virtual void visit(Replicate &node);
+  virtual void visit(CallExpr &node);
+
+  virtual void visit(NegEdge &node);
+  virtual void visit(PosEdge &node);
+  virtual void visit(Star &node);
+
+  virtual void visit(std::unique_ptr<Vector> &node);
+  virtual void visit(Vector &node);
+
+  virtual void visit(std::unique_ptr<AbstractPort> &node);
+  virtual void visit(Port &node);
+  virtual void visit(StringPort &node);
+
+  virtual void visit(std::unique_ptr<StructuralStatement> &node);
+  virtual void visit(std::unique_ptr<Declaration> &node);
+  virtual void visit(std::unique_ptr<BehavioralStatement> &node);
+  virtual void visit(SingleLineComment &node);
+  virtual void visit(BlockComment &node);
+  virtual void visit(InlineVerilog &node);
+  virtual void visit(IfMacro &node);
+  virtual void visit(ModuleInstantiation &node);
+  virtual void visit(Wire &node);
+  virtual void visit(Reg &node);
+  virtual void visit(ContinuousAssign &node);
+  virtual void visit(BlockingAssign &node);
+  virtual void visit(NonBlockingAssign &node);
+  virtual void visit(CallStmt &node);
+  virtual void visit(If &node);
+  virtual void visit(Always &node);
+
+  virtual void visit(std::unique_ptr<AbstractModule> &node);
+  virtual void visit(Module &node);
+  virtual void visit(StringBodyModule &node);
+  virtual void visit(StringModule &node);
+  virtual void visit(File &node);
+};
+
+}  // namespace verilogAST
+#endif
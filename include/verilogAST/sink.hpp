@@ -0,0 +1,123 @@
+#pragma once
+#ifndef VERILOGAST_SINK_H
+#define VERILOGAST_SINK_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace verilogAST {
+
+// Options controlling how nodes are emitted, the defaults reproduce the AST
+// as constructed.
+struct EmitOptions {
+  // Re-encode sized and based numeric literals in the radix that needs the
+  // fewest digits (the value, size and signedness are kept). Unsized decimal
+  // literals are left alone since they are signed integers in Verilog.
+  bool shortest_literals = false;
+};
+
+// Destination for emitted Verilog. Nodes write their text directly into a
+// sink (see `Node::emit`), so each byte of output is produced exactly once
+// instead of being copied into every enclosing node's string.
+class Sink {
+  // Current indentation depth (in units of four spaces) and whether the next
+  // byte written starts a new line
+  unsigned int indent_level = 0;
+  bool at_line_start = true;
+  EmitOptions options;
+
+  void write_indented(const char* data, std::size_t size);
+
+ protected:
+  virtual void put(const char* data, std::size_t size) = 0;
+
+ public:
+  virtual ~Sink() = default;
+
+  void write(const char* data, std::size_t size) {
+    if (size == 0) return;
+    if (this->indent_level) return this->write_indented(data, size);
+    this->put(data, size);
+    this->at_line_start = data[size - 1] == '\n';
+  }
+
+  // Every line started between `indent()` and the matching `dedent()` is
+  // prefixed with four spaces per level, so nested blocks are written once at
+  // their final indentation rather than re-indented by each enclosing block.
+  void indent() { this->indent_level++; }
+  void dedent() { this->indent_level--; }
+
+  // Pushes any buffered output to the underlying destination.
+  virtual void flush() {}
+
+  const EmitOptions& getOptions() const { return this->options; }
+  void setOptions(const EmitOptions& options) { this->options = options; }
+
+  Sink& operator<<(std::string_view str) {
+    this->write(str.data(), str.size());
+    return *this;
+  }
+
+  Sink& operator<<(char c) {
+    this->write(&c, 1);
+    return *this;
+  }
+
+  Sink& operator<<(unsigned int value) {
+    return *this << std::string_view(std::to_string(value));
+  }
+};
+
+// Writes to a std::ostream (e.g. a std::ofstream or std::cout).
+class OStreamSink : public Sink {
+  std::ostream& stream;
+
+ protected:
+  void put(const char* data, std::size_t size) override {
+    this->stream.write(data, size);
+  }
+
+ public:
+  explicit OStreamSink(std::ostream& stream) : stream(stream){};
+  void flush() override { this->stream.flush(); }
+};
+
+// Appends to a caller owned std::string.
+class StringSink : public Sink {
+  std::string& buffer;
+
+ protected:
+  void put(const char* data, std::size_t size) override {
+    this->buffer.append(data, size);
+  }
+
+ public:
+  explicit StringSink(std::string& buffer) : buffer(buffer){};
+};
+
+// Buffered writer for a POSIX file descriptor. The descriptor is not owned
+// (it is not closed by the sink). Output is flushed when the buffer fills, on
+// `flush()`, and on destruction.
+class FdSink : public Sink {
+  int fd;
+  std::vector<char> buffer;
+  std::size_t used = 0;
+
+  void drain(const char* data, std::size_t size);
+
+ protected:
+  void put(const char* data, std::size_t size) override;
+
+ public:
+  explicit FdSink(int fd, std::size_t buffer_size = 1 << 16)
+      : fd(fd), buffer(buffer_size){};
+  FdSink(const FdSink&) = delete;
+  void flush() override;
+  ~FdSink();
+};
+
+}  // namespace verilogAST
+#endif
@@ -0,0 +1,506 @@
+#pragma once
+#ifndef VERILOGAST_STATIC_TRANSFORMER_H
+#define VERILOGAST_STATIC_TRANSFORMER_H
+#include "verilogAST.hpp"
+
+namespace verilogAST {
+
+// Transformer resolved at compile time. A pass derives from
+// `StaticTransformer<Pass>` and declares the `visit` overloads of the nodes it
+// rewrites, with the same signatures as in Transformer but not virtual:
+//
+//   class Pass : public StaticTransformer<Pass> {
+//    public:
+//     using StaticTransformer<Pass>::visit;
+//     std::unique_ptr<Expression> visit(std::unique_ptr<Expression> node);
+//   };
+//
+// The children of a node are visited through `Pass`, so the overload called
+// for each child is chosen when the pass is compiled and the default
+// traversal of the nodes the pass does not override can be inlined. The
+// abstract nodes (expressions, statements, ports and modules) are still
+// dispatched on their NodeKind.
+template <typename Derived>
+class StaticTransformer {
+  Derived& derived() { return static_cast<Derived&>(*this); }
+
+ public:
+  template <typename T>
+  T visit(T node) {
+    return std::visit(
+        [&](auto&& value) -> T {
+          return this->derived().visit(std::move(value));
+        },
+        node);
+  }
+
+  std::unique_ptr<Expression> visit(std::unique_ptr<Expression> node) {
+    if (!node) return node;
+    switch (node->getKind()) {
+      case NodeKind::NumericLiteral:
+        return this->derived().visit(
+            unique_cast<NumericLiteral>(std::move(node)));
+      case NodeKind::Identifier:
+        return this->derived().visit(unique_cast<Identifier>(std::move(node)));
+      case NodeKind::Cast:
+        return this->derived().visit(unique_cast<Cast>(std::move(node)));
+      case NodeKind::Attribute:
+        return this->derived().visit(unique_cast<Attribute>(std::move(node)));
+      case NodeKind::String:
+        return this->derived().visit(unique_cast<String>(std::move(node)));
+      case NodeKind::Index:
+        return this->derived().visit(unique_cast<Index>(std::move(node)));
+      case NodeKind::Slice:
+        return this->derived().visit(unique_cast<Slice>(std::move(node)));
+      case NodeKind::BinaryOp:
+        return this->derived().visit(unique_cast<BinaryOp>(std::move(node)));
+      case NodeKind::UnaryOp:
+        return this->derived().visit(unique_cast<UnaryOp>(std::move(node)));
+      case NodeKind::TernaryOp:
+        return this->derived().visit(unique_cast<TernaryOp>(std::move(node)));
+      case NodeKind::Concat:
+        return this->derived().visit(unique_cast<Concat>(std::move(node)));
+      case NodeKind::Replicate:
+        return this->derived().visit(unique_cast<Replicate>(std::move(node)));
+      case NodeKind::CallExpr:
+        return this->derived().visit(unique_cast<CallExpr>(std::move(node)));
+      case NodeKind::SharedExpr:
+        return this->derived().visit(unique_cast<SharedExpr>(std::move(node)));
+      case NodeKind::Expression:
+        // Expression subclasses defined outside this library
+        return node;
+      default:
+        break;
+    }
+    throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
+    return node;                              // LCOV_EXCL_LINE
+  }
+
+  std::unique_ptr<NumericLiteral> visit(std::unique_ptr<NumericLiteral> node) {
+    return node;
+  }
+
+  std::unique_ptr<Identifier> visit(std::unique_ptr<Identifier> node) {
+    return node;
+  }
+
+  std::unique_ptr<Cast> visit(std::unique_ptr<Cast> node) {
+    node->expr = this->derived().visit(std::move(node->expr));
+    node->invalidateHash();
+    return node;
+  }
+
+  std::unique_ptr<Attribute> visit(std::unique_ptr<Attribute> node) {
+    node->value = this->derived().visit(std::move(node->value));
+    node->invalidateHash();
+    return node;
+  }
+
+  std::unique_ptr<String> visit(std::unique_ptr<String> node) {
+    return node;
+  }
+
+  std::unique_ptr<Index> visit(std::unique_ptr<Index> node) {
+    node->value = this->derived().visit(std::move(node->value));
+    node->index = this->derived().visit(std::move(node->index));
+    node->invalidateHash();
+    return node;
+  }
+
+  std::unique_ptr<Slice> visit(std::unique_ptr<Slice> node) {
+    node->expr = this->derived().visit(std::move(node->expr));
+    node->high_index = this->derived().visit(std::move(node->high_index));
+    node->low_index = this->derived().visit(std::move(node->low_index));
+    node->invalidateHash();
+    return node;
+  }
+
+  std::unique_ptr<BinaryOp> visit(std::unique_ptr<BinaryOp> node) {
+    node->left = this->derived().visit(std::move(node->left));
+    node->right = this->derived().visit(std::move(node->right));
+    node->invalidateHash();
+    return node;
+  }
+
+  std::unique_ptr<UnaryOp> visit(std::unique_ptr<UnaryOp> node) {
+    node->operand = this->derived().visit(std::move(node->operand));
+    node->invalidateHash();
+    return node;
+  }
+
+  std::unique_ptr<TernaryOp> visit(std::unique_ptr<TernaryOp> node) {
+    node->cond = this->derived().visit(std::move(node->cond));
+    node->true_value = this->derived().visit(std::move(node->true_value));
+    node->false_value = this->derived().visit(std::move(node->false_value));
+    node->invalidateHash();
+    return node;
+  }
+
+  std::unique_ptr<Concat> visit(std::unique_ptr<Concat> node) {
+    std::vector<std::unique_ptr<Expression>> new_args;
+    for (auto&& expr : node->args) {
+      new_args.push_back(this->derived().visit(std::move(expr)));
+    }
+    node->args = std::move(new_args);
+    node->invalidateHash();
+    return node;
+  }
+
+  std::unique_ptr<Replicate> visit(std::unique_ptr<Replicate> node) {
+    node->num = this->derived().visit(std::move(node->num));
+    node->value = this->derived().visit(std::move(node->value));
+    node->invalidateHash();
+    return node;
+  }
+
+  std::unique_ptr<NegEdge> visit(std::unique_ptr<NegEdge> node) {
+    node->value = this->derived().visit(std::move(node->value));
+    return node;
+  }
+
+  std::unique_ptr<PosEdge> visit(std::unique_ptr<PosEdge> node) {
+    node->value = this->derived().visit(std::move(node->value));
+    return node;
+  }
+
+  std::unique_ptr<CallExpr> visit(std::unique_ptr<CallExpr> node) {
+    std::vector<std::unique_ptr<Expression>> new_args;
+    for (auto&& expr : node->args) {
+      new_args.push_back(this->derived().visit(std::move(expr)));
+    }
+    node->args = std::move(new_args);
+    node->invalidateHash();
+    return node;
+  }
+
+  std::unique_ptr<Expression> visit(std::unique_ptr<SharedExpr> node) {
+    std::unique_ptr<Expression> result =
+        this->derived().visit(node->materialize());
+    // Children left unchanged are still references to the same expressions, so
+    // this only compares the top level
+    if (result->structurallyEqual(*node->value)) return node;
+    return result;
+  }
+
+  std::unique_ptr<Vector> visit(std::unique_ptr<Vector> node) {
+    node->id = this->derived().visit(std::move(node->id));
+    node->msb = this->derived().visit(std::move(node->msb));
+    node->lsb = this->derived().visit(std::move(node->lsb));
+    if (auto ptr = dyn_cast<NDVector>(node.get())) {
+      std::vector<
+          std::pair<std::unique_ptr<Expression>, std::unique_ptr<Expression>>>
+          new_outer_dims;
+      for (auto& dim : ptr->outer_dims) {
+        new_outer_dims.push_back(
+            {this->derived().visit(std::move(dim.first)),
+             this->derived().visit(std::move(dim.second))});
+      }
+      ptr->outer_dims = std::move(new_outer_dims);
+    }
+    return node;
+  }
+
+  std::unique_ptr<Port> visit(std::unique_ptr<Port> node) {
+    node->value = this->derived().visit(std::move(node->value));
+    return node;
+  }
+
+  std::unique_ptr<StringPort> visit(std::unique_ptr<StringPort> node) {
+    return node;
+  }
+
+  std::unique_ptr<SingleLineComment> visit(
+      std::unique_ptr<SingleLineComment> node) {
+    return node;
+  }
+
+  std::unique_ptr<BlockComment> visit(std::unique_ptr<BlockComment> node) {
+    return node;
+  }
+
+  std::unique_ptr<If> visit(std::unique_ptr<If> node) {
+    node->cond = this->derived().visit(std::move(node->cond));
+
+    std::vector<std::unique_ptr<BehavioralStatement>> new_true_body;
+    for (auto&& item : node->true_body) {
+      new_true_body.push_back(this->derived().visit(std::move(item)));
+    }
+    node->true_body = std::move(new_true_body);
+
+    std::vector<std::pair<std::unique_ptr<Expression>,
+                          std::vector<std::unique_ptr<BehavioralStatement>>>>
+        new_else_ifs;
+    for (auto&& item : node->else_ifs) {
+      std::vector<std::unique_ptr<BehavioralStatement>> new_body;
+      for (auto&& inner_statement : item.second) {
+        new_body.push_back(this->derived().visit(std::move(inner_statement)));
+      }
+      new_else_ifs.push_back(
+          {this->derived().visit(std::move(item.first)), std::move(new_body)});
+    }
+    node->else_ifs = std::move(new_else_ifs);
+
+    std::vector<std::unique_ptr<BehavioralStatement>> new_else_body;
+    for (auto&& item : node->else_body) {
+      new_else_body.push_back(this->derived().visit(std::move(item)));
+    }
+    node->else_body = std::move(new_else_body);
+
+    return node;
+  }
+
+  std::unique_ptr<InlineVerilog> visit(std::unique_ptr<InlineVerilog> node) {
+    return node;
+  }
+
+  std::unique_ptr<IfMacro> visit(std::unique_ptr<IfMacro> node) {
+    std::vector<std::variant<std::unique_ptr<StructuralStatement>,
+                             std::unique_ptr<Declaration>>>
+        new_true_body;
+    for (auto&& item : node->true_body) {
+      new_true_body.push_back(this->derived().visit(std::move(item)));
+    }
+    node->true_body = std::move(new_true_body);
+    std::vector<std::variant<std::unique_ptr<StructuralStatement>,
+                             std::unique_ptr<Declaration>>>
+        new_else_body;
+    for (auto&& item : node->else_body) {
+      new_else_body.push_back(this->derived().visit(std::move(item)));
+    }
+    node->else_body = std::move(new_else_body);
+    return node;
+  }
+
+  std::unique_ptr<ModuleInstantiation> visit(
+      std::unique_ptr<ModuleInstantiation> node) {
+    for (auto&& conn : *node->connections) {
+      conn.second = this->derived().visit(std::move(conn.second));
+    }
+    for (auto&& param : node->parameters) {
+      param.first = this->derived().visit(std::move(param.first));
+      param.second = this->derived().visit(std::move(param.second));
+    }
+    return node;
+  }
+
+  std::unique_ptr<Wire> visit(std::unique_ptr<Wire> node) {
+    node->value = this->derived().visit(std::move(node->value));
+    return node;
+  }
+
+  std::unique_ptr<Reg> visit(std::unique_ptr<Reg> node) {
+    node->value = this->derived().visit(std::move(node->value));
+    return node;
+  }
+
+  std::unique_ptr<ContinuousAssign> visit(
+      std::unique_ptr<ContinuousAssign> node) {
+    node->target = this->derived().visit(std::move(node->target));
+    node->value = this->derived().visit(std::move(node->value));
+    return node;
+  }
+
+  std::unique_ptr<Declaration> visit(std::unique_ptr<Declaration> node) {
+    if (!node) return node;
+    switch (node->getKind()) {
+      case NodeKind::Wire:
+        return this->derived().visit(unique_cast<Wire>(std::move(node)));
+      case NodeKind::Reg:
+        return this->derived().visit(unique_cast<Reg>(std::move(node)));
+      default:
+        break;
+    }
+    throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
+    return node;                              // LCOV_EXCL_LINE
+  }
+
+  std::unique_ptr<BehavioralStatement> visit(
+      std::unique_ptr<BehavioralStatement> node) {
+    if (!node) return node;
+    switch (node->getKind()) {
+      case NodeKind::BlockingAssign:
+        return this->derived().visit(
+            unique_cast<BlockingAssign>(std::move(node)));
+      case NodeKind::NonBlockingAssign:
+        return this->derived().visit(
+            unique_cast<NonBlockingAssign>(std::move(node)));
+      case NodeKind::CallStmt:
+        return this->derived().visit(unique_cast<CallStmt>(std::move(node)));
+      case NodeKind::SingleLineComment:
+        return this->derived().visit(
+            unique_cast<SingleLineComment>(std::move(node)));
+      case NodeKind::BlockComment:
+        return this->derived().visit(
+            unique_cast<BlockComment>(std::move(node)));
+      case NodeKind::If:
+        return this->derived().visit(unique_cast<If>(std::move(node)));
+      case NodeKind::BehavioralStatement:
+        // Statements defined outside this library
+        return node;
+      default:
+        break;
+    }
+    throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
+    return node;                              // LCOV_EXCL_LINE
+  }
+
+  std::unique_ptr<BlockingAssign> visit(std::unique_ptr<BlockingAssign> node) {
+    node->target = this->derived().visit(std::move(node->target));
+    node->value = this->derived().visit(std::move(node->value));
+    return node;
+  }
+
+  std::unique_ptr<NonBlockingAssign> visit(
+      std::unique_ptr<NonBlockingAssign> node) {
+    node->target = this->derived().visit(std::move(node->target));
+    node->value = this->derived().visit(std::move(node->value));
+    return node;
+  }
+
+  std::unique_ptr<CallStmt> visit(std::unique_ptr<CallStmt> node) {
+    std::vector<std::unique_ptr<Expression>> new_args;
+    for (auto&& expr : node->args) {
+      new_args.push_back(this->derived().visit(std::move(expr)));
+    }
+    node->args = std::move(new_args);
+    return node;
+  }
+
+  std::unique_ptr<Star> visit(std::unique_ptr<Star> node) {
+    return node;
+  }
+
+  std::unique_ptr<Always> visit(std::unique_ptr<Always> node) {
+    std::vector<
+        std::variant<std::unique_ptr<Identifier>, std::unique_ptr<PosEdge>,
+                     std::unique_ptr<NegEdge>, std::unique_ptr<Star>>>
+        new_sensitivity_list;
+    for (auto&& item : node->sensitivity_list) {
+      new_sensitivity_list.push_back(this->derived().visit(std::move(item)));
+    }
+    node->sensitivity_list = std::move(new_sensitivity_list);
+    std::vector<std::unique_ptr<BehavioralStatement>> new_body;
+    for (auto&& item : node->body) {
+      new_body.push_back(this->derived().visit(std::move(item)));
+    }
+    node->body = std::move(new_body);
+    return node;
+  }
+
+  std::unique_ptr<AbstractPort> visit(std::unique_ptr<AbstractPort> node) {
+    if (!node) return node;
+    switch (node->getKind()) {
+      case NodeKind::Port:
+        return this->derived().visit(unique_cast<Port>(std::move(node)));
+      case NodeKind::StringPort:
+        return this->derived().visit(unique_cast<StringPort>(std::move(node)));
+      default:
+        break;
+    }
+    throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
+    return node;                              // LCOV_EXCL_LINE
+  }
+
+  std::unique_ptr<StructuralStatement> visit(
+      std::unique_ptr<StructuralStatement> node) {
+    if (!node) return node;
+    switch (node->getKind()) {
+      case NodeKind::ModuleInstantiation:
+        return this->derived().visit(
+            unique_cast<ModuleInstantiation>(std::move(node)));
+      case NodeKind::ContinuousAssign:
+        return this->derived().visit(
+            unique_cast<ContinuousAssign>(std::move(node)));
+      case NodeKind::Always:
+        return this->derived().visit(unique_cast<Always>(std::move(node)));
+      case NodeKind::SingleLineComment:
+        return this->derived().visit(
+            unique_cast<SingleLineComment>(std::move(node)));
+      case NodeKind::BlockComment:
+        return this->derived().visit(
+            unique_cast<BlockComment>(std::move(node)));
+      case NodeKind::InlineVerilog:
+        return this->derived().visit(
+            unique_cast<InlineVerilog>(std::move(node)));
+      case NodeKind::IfMacro:
+      case NodeKind::IfDef:
+      case NodeKind::IfNDef:
+        return this->derived().visit(unique_cast<IfMacro>(std::move(node)));
+      case NodeKind::StructuralStatement:
+        // Statements defined outside this library
+        return node;
+      default:
+        break;
+    }
+    throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
+    return node;                              // LCOV_EXCL_LINE
+  }
+
+  std::unique_ptr<Module> visit(std::unique_ptr<Module> node) {
+    std::vector<std::unique_ptr<AbstractPort>> new_ports;
+    for (auto&& item : node->ports) {
+      new_ports.push_back(this->derived().visit(std::move(item)));
+    }
+    node->ports = std::move(new_ports);
+    for (auto&& param : node->parameters) {
+      param.first = this->derived().visit(std::move(param.first));
+      param.second = this->derived().visit(std::move(param.second));
+    }
+    std::vector<std::variant<std::unique_ptr<StructuralStatement>,
+                             std::unique_ptr<Declaration>>>
+        new_body;
+    for (auto&& item : node->body) {
+      new_body.push_back(this->derived().visit(std::move(item)));
+    }
+    node->body = std::move(new_body);
+    return node;
+  }
+
+  std::unique_ptr<StringBodyModule> visit(
+      std::unique_ptr<StringBodyModule> node) {
+    std::vector<std::unique_ptr<AbstractPort>> new_ports;
+    for (auto&& item : node->ports) {
+      new_ports.push_back(this->derived().visit(std::move(item)));
+    }
+    node->ports = std::move(new_ports);
+    for (auto&& param : node->parameters) {
+      param.first = this->derived().visit(std::move(param.first));
+      param.second = this->derived().visit(std::move(param.second));
+    }
+    return node;
+  }
+
+  std::unique_ptr<StringModule> visit(std::unique_ptr<StringModule> node) {
+    return node;
+  }
+
+  std::unique_ptr<AbstractModule> visit(std::unique_ptr<AbstractModule> node) {
+    if (!node) return node;
+    switch (node->getKind()) {
+      case NodeKind::StringBodyModule:
+        return this->derived().visit(
+            unique_cast<StringBodyModule>(std::move(node)));
+      case NodeKind::Module:
+        return this->derived().visit(unique_cast<Module>(std::move(node)));
+      case NodeKind::StringModule:
+        return this->derived().visit(
+            unique_cast<StringModule>(std::move(node)));
+      default:
+        break;
+    }
+    throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
+    return node;                              // LCOV_EXCL_LINE
+  }
+
+  std::unique_ptr<File> visit(std::unique_ptr<File> node) {
+    std::vector<std::unique_ptr<AbstractModule>> new_modules;
+    for (auto&& item : node->modules) {
+      new_modules.push_back(this->derived().visit(std::move(item)));
+    }
+    node->modules = std::move(new_modules);
+    return node;
+  }
+};
+
+}  // namespace verilogAST
+#endif
@@ -0,0 +1,161 @@
+#pragma once
+#ifndef VERILOGAST_SYMBOL_H
+#define VERILOGAST_SYMBOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <ostream>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace verilogAST {
+
+// A string interned in a SymbolTable, the global one unless a
+// SymbolTable::Scope is active. Symbols are one pointer wide, and copying,
+// hashing and comparing two symbols for equality are O(1). Ordering
+// (`operator<`) compares the strings, so ordered containers iterate in the
+// same order as they would with std::string keys.
+//
+// Symbols convert to `const std::string&` and have the common read only
+// string members, so code that used a `std::string` name keeps working.
+class Symbol {
+ public:
+  struct Entry {
+    std::string str;
+    std::uint32_t id;
+    // Whether `str` has to be written as an escaped Verilog identifier,
+    // computed once when the string is interned
+    bool needs_escape;
+  };
+
+ private:
+  const Entry* entry;
+
+  explicit Symbol(const Entry* entry) : entry(entry){};
+  friend class SymbolTable;
+
+ public:
+  // The empty string, which is the same symbol in every table
+  Symbol();
+  // Interns `str` in `SymbolTable::current()`
+  explicit Symbol(std::string_view str);
+
+  Symbol& operator=(std::string_view str) { return *this = Symbol(str); }
+
+  const std::string& str() const { return this->entry->str; }
+  operator const std::string&() const { return this->entry->str; }
+  operator std::string_view() const { return this->entry->str; }
+  // Dense id, symbols are numbered in the order they are first interned
+  std::uint32_t id() const { return this->entry->id; }
+  // Same as `Identifier::needsEscape(str())`, without rescanning the string
+  bool needsEscape() const { return this->entry->needs_escape; }
+  bool empty() const { return this->entry->str.empty(); }
+  std::size_t size() const { return this->entry->str.size(); }
+  std::size_t length() const { return this->entry->str.length(); }
+  const char* c_str() const { return this->entry->str.c_str(); }
+  char operator[](std::size_t i) const { return this->entry->str[i]; }
+  std::string::const_iterator begin() const { return this->str().begin(); }
+  std::string::const_iterator end() const { return this->str().end(); }
+  std::size_t find(std::string_view str, std::size_t pos = 0) const {
+    return this->entry->str.find(str, pos);
+  }
+  std::string substr(std::size_t pos = 0,
+                     std::size_t count = std::string::npos) const {
+    return this->entry->str.substr(pos, count);
+  }
+
+  bool operator==(Symbol rhs) const { return this->entry == rhs.entry; }
+  bool operator!=(Symbol rhs) const { return this->entry != rhs.entry; }
+  bool operator<(Symbol rhs) const {
+    return this->entry != rhs.entry && this->str() < rhs.str();
+  }
+
+  friend bool operator==(Symbol lhs, std::string_view rhs) {
+    return lhs.str() == rhs;
+  }
+  friend bool operator==(std::string_view lhs, Symbol rhs) {
+    return lhs == rhs.str();
+  }
+  friend bool operator!=(Symbol lhs, std::string_view rhs) {
+    return lhs.str() != rhs;
+  }
+  friend bool operator!=(std::string_view lhs, Symbol rhs) {
+    return lhs != rhs.str();
+  }
+
+  friend std::string operator+(Symbol lhs, std::string_view rhs) {
+    return lhs.str() + std::string(rhs);
+  }
+  friend std::string operator+(std::string_view lhs, Symbol rhs) {
+    return std::string(lhs) + rhs.str();
+  }
+  friend std::string operator+(Symbol lhs, Symbol rhs) {
+    return lhs.str() + rhs.str();
+  }
+};
+
+inline std::ostream& operator<<(std::ostream& stream, Symbol symbol) {
+  return stream << symbol.str();
+}
+
+// Thread safe string interner. Interned strings live as long as the table,
+// and symbols from different tables never compare equal (even if their ids
+// do, SymbolMap tells them apart).
+//
+// The global table is never destroyed. Programs that keep creating new names
+// (e.g. long running generators) can bound its growth by interning the names
+// of each design in a table of their own (see `Scope`) that is destroyed
+// with the design.
+class SymbolTable {
+  mutable std::shared_mutex mutex;
+  // Entries never move, `index` keys point into them
+  std::deque<Symbol::Entry> entries;
+  std::unordered_map<std::string_view, const Symbol::Entry*> index;
+
+ public:
+  SymbolTable() = default;
+  SymbolTable(const SymbolTable&) = delete;
+  SymbolTable& operator=(const SymbolTable&) = delete;
+
+  Symbol intern(std::string_view str);
+  // Symbol with the given `id()`
+  Symbol lookup(std::uint32_t id) const;
+  std::size_t size() const;
+
+  // Makes `table` the current table of this thread until the scope ends,
+  // scopes can be nested. Symbols created in the scope must not outlive
+  // `table`, and are only equal to the symbols of the same table.
+  class Scope {
+    SymbolTable* previous;
+
+   public:
+    explicit Scope(SymbolTable& table);
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    ~Scope();
+  };
+
+  static SymbolTable& global();
+  // Table used by Symbol's constructors on this thread, the global table
+  // outside of a `Scope`
+  static SymbolTable& current();
+};
+
+}  // namespace verilogAST
+
+namespace std {
+
+template <>
+struct hash<verilogAST::Symbol> {
+  std::size_t operator()(verilogAST::Symbol symbol) const {
+    return std::hash<std::uint32_t>{}(symbol.id());
+  }
+};
+
+}  // namespace std
+
+#endif  // VERILOGAST_SYMBOL_H
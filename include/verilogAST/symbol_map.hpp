@@ -0,0 +1,225 @@
+#pragma once
+#ifndef VERILOGAST_SYMBOL_MAP_H
+#define VERILOGAST_SYMBOL_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include "verilogAST/symbol.hpp"
+
+namespace verilogAST {
+
+// Hash map keyed by Symbol, using open addressing with linear probing.
+//
+// Symbols are numbered densely, so the table hashes `Symbol::id()` and
+// probes a flat array of ids. Symbols of different tables may have the same
+// id, so a matching id is confirmed by comparing the symbols. Lookups never
+// touch the strings and never allocate. Iteration order is unspecified.
+// Inserting or erasing invalidates iterators and references.
+//
+// `V` must be default constructible and movable.
+template <typename V>
+class SymbolMap {
+  static constexpr std::uint32_t empty_slot = UINT32_MAX;
+
+  // `ids[i]` is the id of the symbol in `slots[i]`, or `empty_slot`
+  std::vector<std::uint32_t> ids;
+  std::vector<std::pair<Symbol, V>> slots;
+  std::size_t num_entries = 0;
+  unsigned int shift = 32;
+
+  std::size_t mask() const { return this->ids.size() - 1; }
+
+  // Fibonacci hashing, spreads consecutive ids over the table
+  std::size_t home(std::uint32_t id) const {
+    return static_cast<std::uint32_t>(id * 2654435769u) >> this->shift;
+  }
+
+  // Slot holding `key`, or the empty slot it would be inserted in
+  std::size_t probe(Symbol key) const {
+    std::uint32_t id = key.id();
+    std::size_t i = this->home(id);
+    while (this->ids[i] != empty_slot &&
+           (this->ids[i] != id || this->slots[i].first != key)) {
+      i = (i + 1) & this->mask();
+    }
+    return i;
+  }
+
+  void rehash(std::size_t capacity) {
+    std::vector<std::uint32_t> new_ids(capacity, empty_slot);
+    std::vector<std::pair<Symbol, V>> new_slots(capacity);
+    std::vector<std::uint32_t> old_ids =
+        std::exchange(this->ids, std::move(new_ids));
+    std::vector<std::pair<Symbol, V>> old_slots =
+        std::exchange(this->slots, std::move(new_slots));
+    this->shift = 32;
+    for (std::size_t c = capacity; c > 1; c >>= 1) this->shift--;
+    for (std::size_t i = 0; i < old_ids.size(); i++) {
+      if (old_ids[i] == empty_slot) continue;
+      std::size_t j = this->probe(old_slots[i].first);
+      this->ids[j] = old_ids[i];
+      this->slots[j] = std::move(old_slots[i]);
+    }
+  }
+
+  template <typename Map, typename Value>
+  class Iterator {
+    Map* map;
+    std::size_t i;
+
+    void skip() {
+      while (this->i < this->map->ids.size() &&
+             this->map->ids[this->i] == empty_slot) {
+        this->i++;
+      }
+    }
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::pair<Symbol, V>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Value*;
+    using reference = Value&;
+
+    Iterator(Map* map, std::size_t i) : map(map), i(i) { this->skip(); };
+
+    reference operator*() const { return this->map->slots[this->i]; }
+    pointer operator->() const { return &this->map->slots[this->i]; }
+    Iterator& operator++() {
+      this->i++;
+      this->skip();
+      return *this;
+    }
+    bool operator==(const Iterator& rhs) const { return this->i == rhs.i; }
+    bool operator!=(const Iterator& rhs) const { return this->i != rhs.i; }
+  };
+
+ public:
+  using iterator = Iterator<SymbolMap, std::pair<Symbol, V>>;
+  using const_iterator =
+      Iterator<const SymbolMap, const std::pair<Symbol, V>>;
+
+  SymbolMap() = default;
+
+  std::size_t size() const { return this->num_entries; }
+  bool empty() const { return this->num_entries == 0; }
+
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, this->ids.size()); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, this->ids.size()); }
+
+  iterator find(Symbol key) {
+    if (this->empty()) return this->end();
+    std::size_t i = this->probe(key);
+    return this->ids[i] == empty_slot ? this->end() : iterator(this, i);
+  }
+  const_iterator find(Symbol key) const {
+    if (this->empty()) return this->end();
+    std::size_t i = this->probe(key);
+    return this->ids[i] == empty_slot ? this->end() : const_iterator(this, i);
+  }
+  std::size_t count(Symbol key) const {
+    return this->find(key) != this->end() ? 1 : 0;
+  }
+
+  // Inserts `value` if `key` is not present, like std::unordered_map
+  std::pair<iterator, bool> emplace(Symbol key, V value) {
+    auto it = this->find(key);
+    if (it != this->end()) return {it, false};
+    // Keeps the load factor at most 3/4
+    if ((this->num_entries + 1) * 4 > this->ids.size() * 3) {
+      this->rehash(this->ids.empty() ? 16 : this->ids.size() * 2);
+    }
+    std::size_t i = this->probe(key);
+    this->ids[i] = key.id();
+    this->slots[i] = {key, std::move(value)};
+    this->num_entries++;
+    return {iterator(this, i), true};
+  }
+
+  V& operator[](Symbol key) { return this->emplace(key, V()).first->second; }
+
+  std::size_t erase(Symbol key) {
+    if (this->empty()) return 0;
+    std::size_t i = this->probe(key);
+    if (this->ids[i] == empty_slot) return 0;
+    // Backward shift deletion, moves later entries of the probe sequence
+    // into the hole so no tombstones are needed
+    for (std::size_t j = (i + 1) & this->mask();
+         this->ids[j] != empty_slot; j = (j + 1) & this->mask()) {
+      std::size_t k = this->home(this->ids[j]);
+      // Entry at `j` can fill the hole if its home is not in (i, j]
+      if (((j - k) & this->mask()) >= ((j - i) & this->mask())) {
+        this->ids[i] = this->ids[j];
+        this->slots[i] = std::move(this->slots[j]);
+        i = j;
+      }
+    }
+    this->ids[i] = empty_slot;
+    this->slots[i] = {};
+    this->num_entries--;
+    return 1;
+  }
+
+  void clear() {
+    this->ids.clear();
+    this->slots.clear();
+    this->num_entries = 0;
+    this->shift = 32;
+  }
+};
+
+// Hash set of Symbols, see SymbolMap.
+class SymbolSet {
+  struct Unit {};
+  SymbolMap<Unit> map;
+
+  template <typename MapIterator>
+  class Iterator {
+    MapIterator it;
+
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Symbol;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Symbol*;
+    using reference = const Symbol&;
+
+    explicit Iterator(MapIterator it) : it(it){};
+
+    reference operator*() const { return this->it->first; }
+    pointer operator->() const { return &this->it->first; }
+    Iterator& operator++() {
+      ++this->it;
+      return *this;
+    }
+    bool operator==(const Iterator& rhs) const { return this->it == rhs.it; }
+    bool operator!=(const Iterator& rhs) const { return this->it != rhs.it; }
+  };
+
+ public:
+  using const_iterator = Iterator<SymbolMap<Unit>::const_iterator>;
+  using iterator = const_iterator;
+
+  SymbolSet() = default;
+
+  std::size_t size() const { return this->map.size(); }
+  bool empty() const { return this->map.empty(); }
+
+  const_iterator begin() const { return const_iterator(this->map.begin()); }
+  const_iterator end() const { return const_iterator(this->map.end()); }
+
+  std::size_t count(Symbol key) const { return this->map.count(key); }
+  // Returns whether `key` was inserted
+  bool insert(Symbol key) { return this->map.emplace(key, Unit()).second; }
+  std::size_t erase(Symbol key) { return this->map.erase(key); }
+  void clear() { this->map.clear(); }
+};
+
+}  // namespace verilogAST
+
+#endif  // VERILOGAST_SYMBOL_MAP_H
@@ -1,18 +1,50 @@
 #pragma once
 #ifndef VERILOGAST_TRANSFORMER_H
 #define VERILOGAST_TRANSFORMER_H
+#include <memory>
+#include <unordered_map>
+#include <utility>
 #include "verilogAST.hpp"
 
 namespace verilogAST {
 
 class Transformer {
+  // Result of each shared expression visited by `visitMemoized`, keyed by the
+  // referenced expression (kept alive so the key is not reused)
+  std::unordered_map<const Expression*,
+                     std::pair<std::shared_ptr<const Expression>,
+                               std::shared_ptr<const Expression>>>
+      shared_results;
+  bool memoize_shared = false;
+
  public:
+  virtual ~Transformer() = default;
+
   template <typename T>
   T visit(T node) {
     return std::visit(
         [&](auto&& value) -> T { return this->visit(std::move(value)); }, node);
   }
 
+  // Visits `node` like `visit`, but each shared expression is visited once:
+  // every reference to it is replaced by a reference to the same (shared)
+  // result, so a pass over a hash-consed DAG does work per DAG node instead
+  // of per path. Only for passes that rewrite an expression the same way
+  // wherever it occurs.
+  template <typename T>
+  T visitMemoized(T node) {
+    if (this->memoize_shared) return this->visit(std::move(node));
+    this->memoize_shared = true;
+    struct Reset {
+      Transformer* transformer;
+      ~Reset() {
+        transformer->memoize_shared = false;
+        transformer->shared_results.clear();
+      }
+    } reset{this};
+    return this->visit(std::move(node));
+  }
+
   virtual std::unique_ptr<Expression> visit(std::unique_ptr<Expression> node);
 
   virtual std::unique_ptr<NumericLiteral> visit(
@@ -46,6 +78,12 @@ class Transformer {
 
   virtual std::unique_ptr<CallExpr> visit(std::unique_ptr<CallExpr> node);
 
+  // Visits a modifiable copy of the shared expression. If the pass leaves the
+  // copy unchanged the original reference is returned, so unchanged subtrees
+  // stay shared. Within `visitMemoized` the result is shared as well, and
+  // reused for the other references to the same expression.
+  virtual std::unique_ptr<Expression> visit(std::unique_ptr<SharedExpr> node);
+
   virtual std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Vector>>
   visit(
       std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Vector>> node);
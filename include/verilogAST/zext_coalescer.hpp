@@ -2,13 +2,17 @@
 #define VERILOGAST_ZEXT_COALESCER_H
 
 #include "verilogAST.hpp"
+#include "verilogAST/hash_cons.hpp"
+#include "verilogAST/mutating_visitor.hpp"
 #include "verilogAST/transformer.hpp"
 
 namespace verilogAST {
 
 class ZextCoalescer : public Transformer {
  public:
-  ZextCoalescer(bool elide = false) : elide_(elide) {}
+  // If `pool` is given, the generated zero literals are taken from it
+  ZextCoalescer(bool elide = false, LiteralPool* pool = nullptr)
+      : elide_(elide), pool_(pool) {}
 
   using Transformer::visit;
 
@@ -16,6 +20,22 @@ class ZextCoalescer : public Transformer {
 
  private:
   const bool elide_;
+  LiteralPool* const pool_;
+};
+
+// ZextCoalescer as a MutatingVisitor, rewrites the tree in place
+class ZextCoalescerInPlace : public MutatingVisitor {
+ public:
+  ZextCoalescerInPlace(bool elide = false, LiteralPool* pool = nullptr)
+      : elide_(elide), pool_(pool) {}
+
+  using MutatingVisitor::visit;
+
+  void visit(std::unique_ptr<Expression>& node) override;
+
+ private:
+  const bool elide_;
+  LiteralPool* const pool_;
 };
 
 }  // namespace verilogAST
@@ -1,177 +1,547 @@
 #include "verilogAST/assign_inliner.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <iostream>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <typeinfo>
 
 namespace verilogAST {
 
-void Blacklister::blacklist_invalid_driver(std::unique_ptr<Identifier> node) {
-  if (this->wire_blacklist.count(node->value)) {
-    // Already blacklisted
-    return;
-  }
-  if (!assign_map.count(node->toString())) {
-    // Not in assign map, means it's a module input, don't need to do anything
-    // because it won't be inlined
-    return;
-  }
-  auto driver = assign_map[node->toString()]->clone();
-  // Can only inline if driven by identifier, index, or slice
-  bool valid_driver =
-      dynamic_cast<Identifier*>(driver.get()) ||
-      dynamic_cast<Index*>(driver.get()) ||
-      dynamic_cast<Slice*>(driver.get()) ||
-      (this->allowNumDriver() && dynamic_cast<NumericLiteral*>(driver.get()));
-  if (!valid_driver) {
-    this->wire_blacklist.insert(node->value);
-  } else if (auto ptr = dynamic_cast<Identifier*>(driver.get())) {
-    // if driven by an id, we need to recursively blacklist any invalid
-    // drivers, else they'll eventually get inlined into here
-    driver.release();
-    blacklist_invalid_driver(std::unique_ptr<Identifier>(ptr));
-  }
-}
+namespace {
 
-std::unique_ptr<Identifier> Blacklister::visit(
-    std::unique_ptr<Identifier> node) {
-  if (this->blacklist) {
-    blacklist_invalid_driver(node->clone());
-  }
-  return node;
-}
+struct ExprCost {
+  unsigned int cost = 0;
+  unsigned int depth = 0;
+};
 
-std::unique_ptr<Slice> SliceBlacklister::visit(std::unique_ptr<Slice> node) {
-  bool prev = this->blacklist;
-  this->blacklist = true;
-  node = Transformer::visit(std::move(node));
-  // Restore prev value, since we could be nested inside an slice
-  this->blacklist = prev;
-  return node;
+// Cost of a driver expression and the signals it reads
+struct DriverCost {
+  ExprCost own;
+  // Signals read, with the depth of the read
+  std::vector<std::pair<Symbol, unsigned int>> reads;
+};
+
+// Saturates, costs along long chains must not wrap around
+unsigned int add_cost(unsigned int a, unsigned int b) {
+  unsigned int max = std::numeric_limits<unsigned int>::max();
+  return a > max - b ? max : a + b;
 }
 
-std::unique_ptr<Index> IndexBlacklister::visit(std::unique_ptr<Index> node) {
-  bool prev = this->blacklist;
-  this->blacklist = true;
-  node = Transformer::visit(std::move(node));
-  // Restore prev value, since we could be nested inside an index
-  this->blacklist = prev;
-  return node;
+void measure(const Expression *node, unsigned int depth,
+             const InlineCostModel &model, DriverCost &driver) {
+  std::vector<const Expression *> children;
+  unsigned int weight = model.op_weight;
+  switch (node->getKind()) {
+    case NodeKind::SharedExpr:
+      // Emitted as the expression it refers to
+      measure(static_cast<const SharedExpr *>(node)->value.get(), depth, model,
+              driver);
+      return;
+    case NodeKind::Identifier:
+      driver.reads.emplace_back(static_cast<const Identifier *>(node)->value,
+                                depth);
+      weight = model.leaf_weight;
+      break;
+    case NodeKind::NumericLiteral:
+    case NodeKind::String:
+    case NodeKind::Attribute:
+      weight = model.leaf_weight;
+      break;
+    case NodeKind::Cast:
+      children.push_back(static_cast<const Cast *>(node)->expr.get());
+      break;
+    case NodeKind::Index: {
+      auto index = static_cast<const Index *>(node);
+      children.push_back(std::visit(
+          [](auto &&value) -> const Expression * { return value.get(); },
+          index->value));
+      children.push_back(index->index.get());
+      break;
+    }
+    case NodeKind::Slice: {
+      auto slice = static_cast<const Slice *>(node);
+      children = {slice->expr.get(), slice->high_index.get(),
+                  slice->low_index.get()};
+      break;
+    }
+    case NodeKind::BinaryOp: {
+      auto binary_op = static_cast<const BinaryOp *>(node);
+      children = {binary_op->left.get(), binary_op->right.get()};
+      switch (binary_op->op) {
+        case BinOp::MUL:
+        case BinOp::DIV:
+        case BinOp::MOD:
+        case BinOp::POW:
+          weight = model.mul_weight;
+          break;
+        default:
+          break;
+      }
+      break;
+    }
+    case NodeKind::UnaryOp:
+      children.push_back(static_cast<const UnaryOp *>(node)->operand.get());
+      break;
+    case NodeKind::TernaryOp: {
+      auto ternary_op = static_cast<const TernaryOp *>(node);
+      children = {ternary_op->cond.get(), ternary_op->true_value.get(),
+                  ternary_op->false_value.get()};
+      break;
+    }
+    case NodeKind::Concat:
+      for (auto &arg : static_cast<const Concat *>(node)->args) {
+        children.push_back(arg.get());
+      }
+      break;
+    case NodeKind::Replicate: {
+      auto replicate = static_cast<const Replicate *>(node);
+      children = {replicate->num.get(), replicate->value.get()};
+      break;
+    }
+    case NodeKind::CallExpr:
+      for (auto &arg : static_cast<const CallExpr *>(node)->args) {
+        children.push_back(arg.get());
+      }
+      break;
+    default:
+      break;
+  }
+  driver.own.cost = add_cost(driver.own.cost, weight);
+  driver.own.depth = std::max(driver.own.depth, depth);
+  for (auto child : children) measure(child, depth + 1, model, driver);
 }
 
-std::unique_ptr<IfMacro> IfMacroBlacklister::visit(std::unique_ptr<IfMacro> node) {
-  bool prev = this->blacklist;
-  this->blacklist = true;
-  node = Transformer::visit(std::move(node));
-  // Restore prev value, since we could be nested
-  this->blacklist = prev;
-  return node;
+// Cost of `driver` once the inlined signals it reads are replaced by their
+// (merged) drivers
+ExprCost merged_cost(const DriverCost &driver, const SymbolSet &inlinable,
+                     const SymbolMap<ExprCost> &merged,
+                     const InlineCostModel &model) {
+  ExprCost cost = driver.own;
+  for (auto &read : driver.reads) {
+    if (!inlinable.count(read.first)) continue;
+    auto it = merged.find(read.first);
+    // Part of a loop, counted as an identifier
+    if (it == merged.end()) continue;
+    unsigned int extra = it->second.cost > model.leaf_weight
+                             ? it->second.cost - model.leaf_weight
+                             : 0;
+    cost.cost = add_cost(cost.cost, extra);
+    cost.depth =
+        std::max(cost.depth, add_cost(read.second - 1, it->second.depth));
+  }
+  return cost;
 }
 
-std::unique_ptr<ModuleInstantiation> ModuleInstanceBlacklister::visit(
-    std::unique_ptr<ModuleInstantiation> node) {
-  this->blacklist = true;
-  for (auto&& conn : *node->connections) {
-    conn.second = this->visit(std::move(conn.second));
+}  // namespace
+
+void AssignAnalyzer::visit(const Expression &node) {
+  if (this->current_assign || this->in_read_root || !this->count_reads) {
+    ConstVisitor::visit(node);
+    return;
   }
-  this->blacklist = false;
-  return node;
+  this->in_read_root = true;
+  this->root_has_reads = false;
+  ConstVisitor::visit(node);
+  this->in_read_root = false;
+  if (this->root_has_reads) this->read_roots.push_back(&node);
 }
 
-std::unique_ptr<Identifier> WireReadCounter::visit(
-    std::unique_ptr<Identifier> node) {
-  this->read_count[node->toString()]++;
-  return node;
+void AssignAnalyzer::visit(const Identifier &node) {
+  bool declared_name = this->in_declared_name;
+  this->in_declared_name = false;
+  if (this->count_reads && !declared_name) {
+    this->read_count[node.value]++;
+    this->read_sites[node.value] = this->current_assign;
+    this->root_has_reads = true;
+  }
+  if (this->restricted_depth > 0 || this->in_instance) {
+    bool allow_num_driver = this->restricted_depth == 0;
+    auto result = this->driver_checks.emplace(node.value, allow_num_driver);
+    if (!result.second) result.first->second &= allow_num_driver;
+  }
 }
 
-std::unique_ptr<Declaration> WireReadCounter::visit(
-    std::unique_ptr<Declaration> node) {
-  return node;
+void AssignAnalyzer::visit(const Index &node) {
+  this->restricted_depth++;
+  ConstVisitor::visit(node);
+  this->restricted_depth--;
 }
 
-template <typename T>
-std::unique_ptr<T> WireReadCounter::process_assign(std::unique_ptr<T> node) {
-  node->value = this->visit(std::move(node->value));
-  return node;
+void AssignAnalyzer::visit(const Slice &node) {
+  this->restricted_depth++;
+  ConstVisitor::visit(node);
+  this->restricted_depth--;
 }
 
-std::unique_ptr<ContinuousAssign> WireReadCounter::visit(
-    std::unique_ptr<ContinuousAssign> node) {
-  return this->process_assign(std::move(node));
+void AssignAnalyzer::visit(const IfMacro &node) {
+  this->restricted_depth++;
+  this->macro_depth++;
+  ConstVisitor::visit(node);
+  this->macro_depth--;
+  this->restricted_depth--;
 }
 
-std::unique_ptr<BlockingAssign> WireReadCounter::visit(
-    std::unique_ptr<BlockingAssign> node) {
-  return this->process_assign(std::move(node));
+void AssignAnalyzer::visit(const ModuleInstantiation &node) {
+  // Only the connections, not the parameters
+  this->in_instance = true;
+  for (auto &&conn : *node.connections) this->visit(*conn.second);
+  this->in_instance = false;
+  for (auto &&param : node.parameters) {
+    this->visit(param.first);
+    this->visit(*param.second);
+  }
 }
 
-std::unique_ptr<Port> AssignMapBuilder::visit(std::unique_ptr<Port> node) {
-  std::string port_str = std::visit(
-      [](auto&& value) -> std::string {
-        if (auto ptr = dynamic_cast<Identifier*>(value.get())) {
-          return ptr->toString();
-        } else if (auto ptr = dynamic_cast<Vector*>(value.get())) {
-          return ptr->id->toString();
+void AssignAnalyzer::visit(const Port &node) {
+  Symbol port_str = std::visit(
+      [](auto &&value) -> Symbol {
+        using ValueType = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<ValueType, std::unique_ptr<Identifier>>) {
+          return value->value;
+        } else {
+          return value->id->value;
         }
-        throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
-        return "";                                // LCOV_EXCL_LINE
       },
-      node->value);
-  if (node->direction != Direction::INPUT) {
+      node.value);
+  if (node.direction != Direction::INPUT) {
     this->non_input_ports.insert(port_str);
-    if (node->direction == Direction::OUTPUT) {
+    if (node.direction == Direction::OUTPUT) {
       this->output_ports.insert(port_str);
     }
   } else {
     this->input_ports.insert(port_str);
   }
-  return node;
+  ConstVisitor::visit(node);
 }
+
+void AssignAnalyzer::visit(const Declaration &node) {
+  // The declared name comes first and is not a read, identifiers in its
+  // dimensions are
+  this->in_declared_name = true;
+  ConstVisitor::visit(node);
+  this->in_declared_name = false;
+}
+
 template <typename T>
-std::unique_ptr<T> AssignMapBuilder::process_assign(std::unique_ptr<T> node) {
-  node = Transformer::visit(std::move(node));
-  std::string key =
-      std::visit([](auto&& value) -> std::string { return value->toString(); },
-                 node->target);
-  this->assign_map[key] = node->value->clone();
+void AssignAnalyzer::process_assign(const T &node) {
+  bool prev = this->count_reads;
+  this->count_reads = false;
+  this->visit(node.target);
+  this->count_reads = prev;
+  auto id = std::get_if<std::unique_ptr<Identifier>>(&node.target);
+  if (!id) {
+    // Index and slice targets are never inlined, the assign is kept and only
+    // its reads matter
+    this->visit(*node.value);
+    return;
+  }
+  Symbol key = (*id)->value;
+  this->current_assign = key;
+  this->visit(*node.value);
+  this->current_assign.reset();
+  this->assign_map[key] = {&node.value};
   this->assign_count[key]++;
-  return node;
+  if (this->macro_depth > 0) this->macro_targets.insert(key);
 }
 
-std::unique_ptr<BlockingAssign> AssignMapBuilder::visit(
-    std::unique_ptr<BlockingAssign> node) {
-  return this->process_assign(std::move(node));
+void AssignAnalyzer::visit(const BlockingAssign &node) {
+  this->process_assign(node);
 }
 
-std::unique_ptr<ContinuousAssign> AssignMapBuilder::visit(
-    std::unique_ptr<ContinuousAssign> node) {
-  return this->process_assign(std::move(node));
+void AssignAnalyzer::visit(const ContinuousAssign &node) {
+  this->process_assign(node);
+}
+
+Symbol AssignInliner::chain_end(Symbol key) {
+  // Signals whose chain end is resolved by this call
+  std::vector<Symbol> path;
+  while (true) {
+    auto known = this->chain_ends.find(key);
+    if (known != this->chain_ends.end()) {
+      key = known->second;
+      break;
+    }
+    // Blacklisted signals are not inlined, so their drivers don't matter
+    if (this->wire_blacklist.count(key)) break;
+    auto it = this->assign_map.find(key);
+    // Not in assign map, means it's a module input
+    if (it == this->assign_map.end()) break;
+    auto id = dyn_cast<Identifier>(strip_shared(it->second.value->get()));
+    if (!id) break;
+    path.push_back(key);
+    // A chain looping back ends here
+    this->chain_ends[key] = key;
+    key = id->value;
+  }
+  for (auto signal : path) this->chain_ends[signal] = key;
+  return key;
+}
+
+void AssignInliner::check_driver(Symbol key, bool allow_num_driver) {
+  // if driven by an id, we need to check its driver as well, else it'll
+  // eventually get inlined into here
+  key = this->chain_end(key);
+  if (this->wire_blacklist.count(key)) return;
+  auto it = this->assign_map.find(key);
+  // Not in assign map, means it's a module input, don't need to do anything
+  // because it won't be inlined
+  if (it == this->assign_map.end()) return;
+  auto driver = strip_shared(it->second.value->get());
+  // Can only inline if driven by identifier, index, or slice
+  bool valid_driver = isa<Identifier>(driver) || isa<Index>(driver) ||
+                      isa<Slice>(driver) ||
+                      (allow_num_driver && isa<NumericLiteral>(driver));
+  if (!valid_driver) this->wire_blacklist.insert(key);
+}
+
+Symbol AssignInliner::renamed(Symbol key) {
+  for (auto it = this->output_renames.find(key);
+       it != this->output_renames.end() && !this->wire_blacklist.count(key);
+       it = this->output_renames.find(key)) {
+    key = it->second;
+  }
+  return key;
+}
+
+void AssignInliner::find_inlinable() {
+  for (auto& entry : this->assign_map) {
+    if (this->wire_blacklist.count(entry.first)) continue;
+    auto driver = strip_shared(entry.second.value->get());
+    auto reads = this->read_count.find(entry.first);
+    if ((reads != this->read_count.end() && reads->second == 1) ||
+        isa<Identifier>(driver) || isa<NumericLiteral>(driver)) {
+      this->inlinable.insert(entry.first);
+    }
+  }
+  if (!this->cost_model.unlimited()) this->apply_cost_model();
+  for (auto key : this->inlinable) {
+    auto driver =
+        strip_shared(this->assign_map.find(key)->second.value->get());
+    if (auto id = dyn_cast<Identifier>(driver)) {
+      this->aliases[key] = id->value;
+    }
+  }
+}
+
+void AssignInliner::apply_cost_model() {
+  const InlineCostModel &model = this->cost_model;
+  // Each driver is measured once, `merged` caches the cost of each inlined
+  // signal once the signals it reads are inlined. Drivers are still pristine
+  // here, the costs are not stored on the nodes since the rewrite mutates
+  // them.
+  std::vector<DriverCost> drivers;
+  SymbolMap<std::size_t> driver_index;
+  SymbolMap<ExprCost> merged;
+  SymbolSet visiting;
+
+  // Keeps the inlined signals `driver` reads as wires until it fits the
+  // budget, returns its cost with the remaining ones inlined
+  auto fit = [&](const DriverCost &driver) {
+    // Inlined signal read by `driver` making the expression the most
+    // expensive (or deepest beyond the budget)
+    auto worst_read = [&](bool by_depth) {
+      std::optional<Symbol> worst;
+      unsigned int worst_cost = 0;
+      for (auto &read : driver.reads) {
+        if (!this->inlinable.count(read.first)) continue;
+        auto it = merged.find(read.first);
+        if (it == merged.end()) continue;
+        unsigned int read_cost =
+            by_depth ? add_cost(read.second - 1, it->second.depth)
+                     : it->second.cost;
+        if (by_depth && read_cost <= model.max_depth) continue;
+        if (!worst || read_cost > worst_cost) {
+          worst = read.first;
+          worst_cost = read_cost;
+        }
+      }
+      return worst;
+    };
+    ExprCost cost = merged_cost(driver, this->inlinable, merged, model);
+    while (true) {
+      std::optional<Symbol> worst;
+      if (cost.depth > model.max_depth) worst = worst_read(true);
+      if (!worst && cost.cost > model.max_cost) worst = worst_read(false);
+      // Fits, or the driver alone exceeds the budget
+      if (!worst) break;
+      this->inlinable.erase(*worst);
+      cost = merged_cost(driver, this->inlinable, merged, model);
+    }
+    return cost;
+  };
+
+  for (auto &entry : this->assign_map) {
+    // Post-order over the inlined signals read, iterative since alias chains
+    // can be long
+    std::vector<Symbol> stack{entry.first};
+    while (!stack.empty()) {
+      Symbol key = stack.back();
+      if (merged.count(key)) {
+        stack.pop_back();
+        continue;
+      }
+      auto index = driver_index.find(key);
+      if (index == driver_index.end()) {
+        DriverCost driver;
+        measure(this->assign_map.find(key)->second.value->get(), 1, model,
+                driver);
+        index = driver_index.emplace(key, drivers.size()).first;
+        drivers.push_back(std::move(driver));
+      }
+      const DriverCost &driver = drivers[index->second];
+      visiting.insert(key);
+      bool ready = true;
+      for (auto &read : driver.reads) {
+        if (this->inlinable.count(read.first) && !merged.count(read.first) &&
+            !visiting.count(read.first)) {
+          stack.push_back(read.first);
+          ready = false;
+        }
+      }
+      if (!ready) continue;
+      stack.pop_back();
+      visiting.erase(key);
+
+      merged[key] = fit(driver);
+    }
+  }
+
+  // Expressions outside the assigns (NonBlockingAssign values, `If`
+  // conditions, ...) get the reads inlined into them trimmed the same way
+  for (auto root : this->read_roots) {
+    DriverCost driver;
+    measure(root, 1, model, driver);
+    fit(driver);
+  }
+}
+
+Symbol AssignInliner::resolve_alias(Symbol key) {
+  std::vector<Symbol> path;
+  for (auto it = this->aliases.find(key); it != this->aliases.end();
+       it = this->aliases.find(key)) {
+    // A loop of aliases, inlining it would not terminate
+    if (path.size() > this->aliases.size()) {
+      throw std::runtime_error("Combinational loop through " + key.str());
+    }
+    path.push_back(key);
+    key = it->second;
+  }
+  // Path compression, later reads of the chain resolve in one step
+  for (auto alias : path) this->aliases[alias] = key;
+  return key;
+}
+
+bool AssignInliner::can_inline(Symbol key) {
+  return this->inlinable.count(key);
+}
+
+bool AssignInliner::removes_assign(Symbol key) {
+  auto it = this->assign_map.find(key);
+  if (it == this->assign_map.end()) return false;
+  return (this->can_inline(key) && this->non_input_ports.count(key) == 0) ||
+         this->inlined_outputs.count(key);
 }
 
-bool AssignInliner::can_inline(std::string key) {
-  if (this->wire_blacklist.count(key)) {
-    return false;
+int AssignInliner::replaced_reads(Symbol key) {
+  auto it = this->read_count.find(key);
+  int reads = it == this->read_count.end() ? 0 : it->second;
+  // The name of a port is counted as a read, but never replaced
+  if (this->input_ports.count(key) || this->non_input_ports.count(key)) {
+    reads--;
   }
-  auto it = assign_map.find(key);
-  return it != assign_map.end() &&
-         (this->read_count[key] == 1 ||
-          dynamic_cast<Identifier*>(it->second.get()) ||
-          dynamic_cast<NumericLiteral*>(it->second.get()));
+  return reads;
+}
+
+int AssignInliner::driver_uses(Symbol key) {
+  // A driver is copied once for each read of its signal, and a read inside
+  // another driver once for each copy of that driver. Follows the chain of
+  // single reads, signals read once are the only ones that can end up with
+  // one use.
+  std::vector<Symbol> chain;
+  int uses;
+  while (true) {
+    auto known = this->driver_use_counts.find(key);
+    if (known != this->driver_use_counts.end()) {
+      uses = known->second;
+      break;
+    }
+    if (!this->can_inline(key)) {
+      // The assign is kept and rewritten in place
+      uses = 1;
+      break;
+    }
+    chain.push_back(key);
+    // Placeholder, in case the chain loops back
+    this->driver_use_counts[key] = 2;
+    int reads = this->replaced_reads(key);
+    auto site = this->read_sites.find(key);
+    if (reads <= 0) {
+      uses = 0;
+      break;
+    }
+    // Read more than once, or read in a previous module
+    if (reads > 1 || site == this->read_sites.end()) {
+      uses = 2;
+      break;
+    }
+    if (!site->second) {
+      uses = 1;
+      break;
+    }
+    key = *site->second;
+  }
+  for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+    // Plus the kept assign
+    uses = std::min(2, uses + (this->removes_assign(*it) ? 0 : 1));
+    this->driver_use_counts[*it] = uses;
+  }
+  return uses;
+}
+
+std::unique_ptr<Expression> AssignInliner::take_driver(Symbol key) {
+  auto kept = this->kept_drivers.find(key);
+  if (kept != this->kept_drivers.end()) return kept->second->clone();
+  auto it = this->assign_map.find(key);
+  // The analyzer only reads the module, which is owned by the inliner
+  auto& value = const_cast<std::unique_ptr<Expression>&>(*it->second.value);
+  if (this->driver_uses(key) == 1) return std::move(value);
+  return value->clone();
 }
 
 std::unique_ptr<Index> AssignInliner::visit(std::unique_ptr<Index> node) {
   if (std::holds_alternative<std::unique_ptr<Identifier>>(node->value)) {
-    std::string key =
-        std::get<std::unique_ptr<Identifier>>(node->value)->toString();
+    Symbol name = std::get<std::unique_ptr<Identifier>>(node->value)->value;
+    Symbol key = this->resolve_alias(name);
     if (this->can_inline(key)) {
-      std::unique_ptr<Expression> value = this->visit(assign_map[key]->clone());
-      if (auto ptr = dynamic_cast<Identifier*>(value.get())) {
-        value.release();
-        node->value = std::unique_ptr<Identifier>(ptr);
-      } else if (auto ptr = dynamic_cast<Index*>(value.get())) {
-        value.release();
-        node->value = std::unique_ptr<Index>(ptr);
-      } else if (auto ptr = dynamic_cast<Slice*>(value.get())) {
-        value.release();
-        node->value = std::unique_ptr<Slice>(ptr);
+      std::unique_ptr<Expression> value = this->visit(this->take_driver(key));
+      if (auto shared = dyn_cast<SharedExpr>(value.get())) {
+        value = shared->materialize();
+      }
+      switch (value->getKind()) {
+        case NodeKind::Identifier:
+          node->value = unique_cast<Identifier>(std::move(value));
+          break;
+        case NodeKind::Index:
+          node->value = unique_cast<Index>(std::move(value));
+          break;
+        case NodeKind::Slice:
+          node->value = unique_cast<Slice>(std::move(value));
+          break;
+        default:
+          break;
       }
+      if (!std::holds_alternative<std::unique_ptr<Identifier>>(node->value)) {
+        node->index = this->visit(std::move(node->index));
+      }
+    } else {
+      key = this->renamed(key);
+      if (key != name) node->value = std::make_unique<Identifier>(key);
     }
     return node;
   }
@@ -180,13 +550,14 @@ std::unique_ptr<Index> AssignInliner::visit(std::unique_ptr<Index> node) {
 
 std::unique_ptr<Expression> AssignInliner::visit(
     std::unique_ptr<Expression> node) {
-  if (auto ptr = dynamic_cast<Identifier*>(node.get())) {
-    node.release();
-    std::unique_ptr<Identifier> id(ptr);
-    std::string key = id->toString();
+  if (isa<Identifier>(node)) {
+    std::unique_ptr<Identifier> id = unique_cast<Identifier>(std::move(node));
+    Symbol key = this->resolve_alias(id->value);
     if (this->can_inline(key)) {
-      return this->visit(assign_map[key]->clone());
+      return this->visit(this->take_driver(key));
     }
+    key = this->renamed(key);
+    if (key != id->value) return std::make_unique<Identifier>(key);
     return id;
   }
   return Transformer::visit(std::move(node));
@@ -196,10 +567,14 @@ std::unique_ptr<Wire> AssignInliner::visit(std::unique_ptr<Wire> node) {
   bool remove = false;
   std::visit(
       [&](auto&& value) {
-        if (auto ptr = dynamic_cast<Identifier*>(value.get())) {
-          remove = this->can_inline(ptr->toString());
-        } else if (auto ptr = dynamic_cast<Vector*>(value.get())) {
-          remove = this->can_inline(ptr->id->toString());
+        using ValueType = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<ValueType, std::unique_ptr<Identifier>>) {
+          remove = this->can_inline(value->value) ||
+                   this->renamed(value->value) != value->value;
+        } else if constexpr (std::is_same_v<ValueType,
+                                            std::unique_ptr<Vector>>) {
+          remove = this->can_inline(value->id->value) ||
+                   this->renamed(value->id->value) != value->id->value;
         }
       },
       node->value);
@@ -212,25 +587,14 @@ std::unique_ptr<Wire> AssignInliner::visit(std::unique_ptr<Wire> node) {
 
 template <typename T>
 std::unique_ptr<T> AssignInliner::process_assign(std::unique_ptr<T> node) {
-  node->value = this->visit(std::move(node->value));
-  std::string key =
-      std::visit([](auto&& value) -> std::string { return value->toString(); },
-                 node->target);
-  bool remove = false;
-  std::visit(
-      [&](auto&& value) {
-        if (auto ptr = dynamic_cast<Identifier*>(value.get())) {
-          if (this->can_inline(key) && this->non_input_ports.count(key) == 0) {
-            remove = true;
-          } else if (this->inlined_outputs.count(ptr->toString())) {
-            remove = true;
-          };
-        }
-      },
-      node->target);
-  if (remove) {
+  // Checked first, the value of a removed assign may have been moved to its
+  // read already
+  auto id = std::get_if<std::unique_ptr<Identifier>>(&node->target);
+  if (id && this->removes_assign((*id)->value)) {
+    this->removed_assigns.push_back(std::move(node));
     return std::unique_ptr<T>{};
   }
+  node->value = this->visit(std::move(node->value));
   return node;
 }
 
@@ -274,11 +638,65 @@ AssignInliner::do_inline(
   return new_body;
 }
 
+void AssignInliner::reverse_inline_outputs() {
+  // "Reverse inline" output wires: an output driven by a wire that is never
+  // assigned (e.g. connected to a module instance output) takes the place of
+  // the wire
+  for (auto output : this->output_ports) {
+    std::optional<Symbol> driver;
+    auto rename = this->output_renames.find(output);
+    if (rename != this->output_renames.end()) {
+      driver = rename->second;
+      this->output_renames.erase(output);
+    } else {
+      auto it = this->assign_map.find(output);
+      if (it == this->assign_map.end()) continue;
+      auto value = strip_shared(it->second.value->get());
+      if (auto id = dyn_cast<Identifier>(value)) driver = id->value;
+    }
+    if (driver && this->macro_targets.count(output) == 0 &&
+        this->assign_count.count(*driver) == 0 &&
+        this->input_ports.count(*driver) == 0 &&
+        this->wire_blacklist.count(*driver) == 0) {
+      this->output_renames[*driver] = output;
+      this->assign_count[*driver]++;
+      this->inlined_outputs.insert(output);
+    }
+  }
+}
+
+void AssignInliner::clear_module_state() {
+  this->read_count.clear();
+  this->assign_count.clear();
+  this->assign_map.clear();
+  this->removed_assigns.clear();
+  this->read_sites.clear();
+  this->read_roots.clear();
+  this->inlinable.clear();
+  this->aliases.clear();
+  this->kept_drivers.clear();
+  this->driver_use_counts.clear();
+  this->non_input_ports.clear();
+  this->output_ports.clear();
+  this->input_ports.clear();
+  this->inlined_outputs.clear();
+  this->wire_blacklist.clear();
+  this->driver_checks.clear();
+  this->macro_targets.clear();
+  this->chain_ends.clear();
+  this->output_renames.clear();
+}
+
 std::unique_ptr<Module> AssignInliner::visit(std::unique_ptr<Module> node) {
-  AssignMapBuilder builder(this->assign_count, this->assign_map,
-                           this->non_input_ports, this->output_ports,
-                           this->input_ports);
-  node = builder.visit(std::move(node));
+  // Also cleared here in case inlining the previous module threw
+  this->clear_module_state();
+  this->wire_blacklist = this->blacklist;
+  AssignAnalyzer analyzer(this->assign_count, this->assign_map,
+                          this->read_count, this->read_sites,
+                          this->non_input_ports, this->output_ports,
+                          this->input_ports, this->driver_checks,
+                          this->macro_targets, this->read_roots);
+  analyzer.visit(*node);
   for (auto entry : assign_count) {
     if (entry.second > 1) {
       // Do not inline things assigned more than once, e.g. a reg inside
@@ -286,47 +704,82 @@ std::unique_ptr<Module> AssignInliner::visit(std::unique_ptr<Module> node) {
       this->wire_blacklist.insert(entry.first);
     }
   }
-
-  WireReadCounter counter(this->read_count);
-  node = counter.visit(std::move(node));
-
-  IndexBlacklister index_blacklist(this->wire_blacklist, this->assign_map);
-  node = index_blacklist.visit(std::move(node));
-
-  IfMacroBlacklister if_macro_blacklist(this->wire_blacklist, this->assign_map);
-  node = if_macro_blacklist.visit(std::move(node));
-
-  SliceBlacklister slice_blacklist(this->wire_blacklist, this->assign_map);
-  node = slice_blacklist.visit(std::move(node));
-
-  ModuleInstanceBlacklister module_instance_blacklister(this->wire_blacklist,
-                                                        this->assign_map);
-  node = module_instance_blacklister.visit(std::move(node));
+  // Nor things only driven when a macro is defined
+  for (auto key : this->macro_targets) this->wire_blacklist.insert(key);
+  for (auto entry : this->driver_checks) {
+    this->check_driver(entry.first, entry.second);
+  }
+  this->driver_checks.clear();
+  this->chain_ends.clear();
+  this->reverse_inline_outputs();
+  // Decided before any assign is rewritten in place
+  this->find_inlinable();
+  for (auto& entry : this->assign_map) {
+    if (this->can_inline(entry.first) && !this->removes_assign(entry.first) &&
+        this->replaced_reads(entry.first) > 0) {
+      this->kept_drivers[entry.first] = (*entry.second.value)->clone();
+    }
+  }
 
   std::vector<std::unique_ptr<AbstractPort>> new_ports;
   for (auto&& item : node->ports) {
     new_ports.push_back(this->visit(std::move(item)));
   }
   node->ports = std::move(new_ports);
-
   node->body = this->do_inline(std::move(node->body));
-  // Now "reverse inline" output wires
-  for (auto output : this->output_ports) {
-    if (!this->assign_map.count(output)) {
-      continue;
-    }
-    std::unique_ptr<Expression> value = this->assign_map[output]->clone();
-    this->assign_map.erase(output);
-    if (dynamic_cast<Identifier*>(value.get()) &&
-        this->assign_count[value->toString()] == 0 &&
-        this->input_ports.count(value->toString()) == 0 &&
-        this->wire_blacklist.count(value->toString()) == 0) {
-      this->assign_map[value->toString()] = make_id(output);
-      this->assign_count[value->toString()]++;
-      this->inlined_outputs.insert(output);
+
+  this->clear_module_state();
+  return node;
+}
+
+std::unique_ptr<AssignInliner> AssignInliner::makeWorker() const {
+  // A plain AssignInliner would skip the overrides of a subclass
+  if (typeid(*this) != typeid(AssignInliner)) return nullptr;
+  return std::make_unique<AssignInliner>();
+}
+
+std::unique_ptr<File> AssignInliner::visit(std::unique_ptr<File> node,
+                                           unsigned int num_threads) {
+  std::size_t num_modules = node->modules.size();
+  if (num_threads <= 1 || num_modules <= 1) return this->visit(std::move(node));
+  num_threads = std::min<std::size_t>(num_threads, num_modules);
+
+  // Every worker owns an inliner since the module state is not shared
+  std::vector<std::unique_ptr<AssignInliner>> inliners;
+  for (unsigned int i = 0; i < num_threads; i++) {
+    std::unique_ptr<AssignInliner> inliner = this->makeWorker();
+    if (!inliner) return this->visit(std::move(node));
+    inliner->blacklist = this->blacklist;
+    inliner->cost_model = this->cost_model;
+    inliners.push_back(std::move(inliner));
+  }
+
+  // Workers claim modules in order and inline each in place
+  std::exception_ptr error;
+  std::atomic<std::size_t> next{0};
+  std::mutex mutex;
+
+  // Names created by the workers must come from the caller's table
+  SymbolTable& table = SymbolTable::current();
+  auto worker = [&](AssignInliner* inliner) {
+    SymbolTable::Scope scope(table);
+    for (std::size_t i; (i = next++) < num_modules;) {
+      try {
+        node->modules[i] = inliner->visit(std::move(node->modules[i]));
+      } catch (...) {
+        next = num_modules;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) error = std::current_exception();
+      }
     }
+  };
+
+  std::vector<std::thread> threads;
+  for (auto& inliner : inliners) {
+    threads.emplace_back(worker, inliner.get());
   }
-  node->body = this->do_inline(std::move(node->body));
+  for (auto& thread : threads) thread.join();
+  if (error) std::rethrow_exception(error);
   return node;
 }
 
@@ -0,0 +1,164 @@
+#include "verilogAST/ast_context.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <mutex>
+#include <new>
+
+namespace verilogAST {
+
+namespace {
+
+thread_local ASTContext* current_context = nullptr;
+
+constexpr std::size_t alignment = alignof(std::max_align_t);
+
+// Chunks are made of whole granules, aligned to a granule, so every granule
+// is either owned by an arena or not at all
+constexpr int granule_bits = 12;
+constexpr std::size_t granule = std::size_t{1} << granule_bits;
+
+// Context owning each granule of the chunks of every live context, so
+// `operator delete` can tell arena nodes apart (and find their context)
+// without a header on every allocation. A radix
+// tree over the granule index, lookups only load atomics. Interior nodes are
+// created on demand under `granules_mutex` and never freed.
+constexpr int index_bits =
+    std::numeric_limits<std::uintptr_t>::digits - granule_bits;
+constexpr int level_bits = (index_bits + 3) / 4;
+constexpr std::size_t level_size = std::size_t{1} << level_bits;
+
+template <typename Child>
+struct RadixNode {
+  std::atomic<Child*> children[level_size];
+};
+struct Leaf {
+  std::atomic<ASTContext*> owner[level_size];
+};
+using Root = RadixNode<RadixNode<RadixNode<Leaf>>>;
+
+Root granules;
+std::mutex granules_mutex;
+// Heap nodes skip the lookup while no context has a chunk
+std::atomic<std::size_t> num_chunks{0};
+
+std::size_t level_index(std::uintptr_t index, int level) {
+  return (index >> (level * level_bits)) & (level_size - 1);
+}
+
+template <typename Child>
+Child* get_or_create(RadixNode<Child>& node, std::size_t i) {
+  Child* child = node.children[i].load(std::memory_order_relaxed);
+  if (!child) {
+    child = new Child();
+    node.children[i].store(child, std::memory_order_release);
+  }
+  return child;
+}
+
+void set_owner(const char* chunk, std::size_t size, ASTContext* owner) {
+  std::lock_guard<std::mutex> lock(granules_mutex);
+  auto first = reinterpret_cast<std::uintptr_t>(chunk) >> granule_bits;
+  for (auto index = first; index < first + size / granule; index++) {
+    auto level2 = get_or_create(granules, level_index(index, 3));
+    auto level1 = get_or_create(*level2, level_index(index, 2));
+    auto leaf = get_or_create(*level1, level_index(index, 1));
+    leaf->owner[level_index(index, 0)].store(owner,
+                                             std::memory_order_release);
+  }
+}
+
+// Context whose arena holds `ptr`, or nullptr for heap memory
+ASTContext* arena_of(const void* ptr) {
+  if (num_chunks.load(std::memory_order_acquire) == 0) return nullptr;
+  auto index = reinterpret_cast<std::uintptr_t>(ptr) >> granule_bits;
+  auto level2 = granules.children[level_index(index, 3)].load(
+      std::memory_order_acquire);
+  if (!level2) return nullptr;
+  auto level1 =
+      level2->children[level_index(index, 2)].load(std::memory_order_acquire);
+  if (!level1) return nullptr;
+  auto leaf =
+      level1->children[level_index(index, 1)].load(std::memory_order_acquire);
+  if (!leaf) return nullptr;
+  return leaf->owner[level_index(index, 0)].load(std::memory_order_acquire);
+}
+
+}  // namespace
+
+void* Node::operator new(std::size_t size) {
+  ASTContext* context = current_context;
+  if (!context) return ::operator new(size);
+  void* result = context->allocate(size);
+  context->live_nodes++;
+  return result;
+}
+
+void Node::operator delete(void* ptr) {
+  if (!ptr) return;
+  // Arena memory is released in bulk by the owning context
+  if (ASTContext* context = arena_of(ptr)) {
+    context->live_nodes--;
+  } else {
+    ::operator delete(ptr);
+  }
+}
+
+ASTContext::~ASTContext() {
+  std::size_t live_nodes = this->live_nodes.load();
+  if (live_nodes != 0) {
+    // Deleting them later would free memory inside the released chunks
+    std::fprintf(stderr,
+                 "verilogAST: ASTContext destroyed while %zu of its nodes "
+                 "are alive\n",
+                 live_nodes);
+    std::abort();
+  }
+  for (auto& chunk : this->chunks) {
+    set_owner(chunk.first, chunk.second, nullptr);
+    num_chunks--;
+    ::operator delete(chunk.first, std::align_val_t{granule});
+  }
+}
+
+void* ASTContext::allocate_chunk(std::size_t size) {
+  size = (size + granule - 1) & ~(granule - 1);
+  char* chunk =
+      static_cast<char*>(::operator new(size, std::align_val_t{granule}));
+  set_owner(chunk, size, this);
+  num_chunks++;
+  this->chunks.emplace_back(chunk, size);
+  return chunk;
+}
+
+void* ASTContext::allocate(std::size_t size) {
+  size = (size + alignment - 1) & ~(alignment - 1);
+  this->bytes_allocated += size;
+  if (size > this->remaining) {
+    if (size > this->chunk_size / 4) {
+      // Large allocations get their own chunk so the current one is not
+      // abandoned
+      return this->allocate_chunk(size);
+    }
+    this->next = static_cast<char*>(this->allocate_chunk(this->chunk_size));
+    this->remaining = this->chunk_size;
+  }
+  void* result = this->next;
+  this->next += size;
+  this->remaining -= size;
+  return result;
+}
+
+ASTContext* ASTContext::current() { return current_context; }
+
+ASTContext::Scope::Scope(ASTContext& context) : previous(current_context) {
+  current_context = &context;
+}
+
+ASTContext::Scope::~Scope() { current_context = this->previous; }
+
+}  // namespace verilogAST
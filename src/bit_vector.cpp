@@ -0,0 +1,192 @@
+#include "verilogAST/bit_vector.hpp"
+
+#include <algorithm>
+
+namespace verilogAST {
+
+namespace {
+
+int digit_value(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+unsigned int bits_per_digit(unsigned int base) {
+  switch (base) {
+    case 2:
+      return 1;
+    case 8:
+      return 3;
+    case 16:
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+}  // namespace
+
+BitVector::BitVector(unsigned int width, std::uint64_t value)
+    : width_(width), inline_word(value) {
+  if (width > 64) {
+    this->words.assign(this->numWords(), 0);
+    this->words[0] = value;
+    this->inline_word = 0;
+  }
+  this->clearUnusedBits();
+}
+
+void BitVector::clearUnusedBits() {
+  if (this->width_ == 0) {
+    this->inline_word = 0;
+    return;
+  }
+  unsigned int used = this->width_ % 64;
+  if (used) this->data()[this->numWords() - 1] &= (~0ULL) >> (64 - used);
+}
+
+void BitVector::setBit(unsigned int index, bool value) {
+  std::uint64_t mask = 1ULL << (index % 64);
+  if (value) {
+    this->data()[index / 64] |= mask;
+  } else {
+    this->data()[index / 64] &= ~mask;
+  }
+}
+
+std::optional<BitVector> BitVector::parse(std::string_view digits,
+                                          unsigned int base,
+                                          unsigned int width) {
+  BitVector result(width);
+  bool any_digit = false;
+  if (unsigned int shift = bits_per_digit(base)) {
+    // Least significant digit first
+    unsigned int position = 0;
+    for (auto it = digits.rbegin(); it != digits.rend(); ++it) {
+      if (*it == '_') continue;
+      int digit = digit_value(*it);
+      if (digit < 0 || static_cast<unsigned int>(digit) >= base) {
+        return std::nullopt;
+      }
+      any_digit = true;
+      for (unsigned int i = 0; i < shift && position + i < width; i++) {
+        if ((digit >> i) & 1) result.setBit(position + i, true);
+      }
+      position += shift;
+    }
+  } else if (base == 10) {
+    for (char c : digits) {
+      if (c == '_') continue;
+      int digit = digit_value(c);
+      if (digit < 0 || digit >= 10) return std::nullopt;
+      any_digit = true;
+      // result = result * 10 + digit, in 32 bit halves so the carry fits
+      std::uint64_t carry = digit;
+      std::uint64_t* data = result.data();
+      for (std::size_t i = 0; i < result.numWords(); i++) {
+        std::uint64_t low = (data[i] & 0xffffffffULL) * 10 + carry;
+        std::uint64_t high = (data[i] >> 32) * 10 + (low >> 32);
+        data[i] = (high << 32) | (low & 0xffffffffULL);
+        carry = high >> 32;
+      }
+      result.clearUnusedBits();
+    }
+  } else {
+    return std::nullopt;
+  }
+  if (!any_digit) return std::nullopt;
+  return result;
+}
+
+unsigned int BitVector::activeBits() const {
+  const std::uint64_t* data = this->data();
+  for (std::size_t i = this->numWords(); i > 0; i--) {
+    std::uint64_t word = data[i - 1];
+    if (word) {
+      unsigned int bits = 0;
+      while (word) {
+        bits++;
+        word >>= 1;
+      }
+      return (i - 1) * 64 + bits;
+    }
+  }
+  return 0;
+}
+
+void BitVector::resize(unsigned int width) {
+  std::size_t num_words = (width + 63) / 64;
+  if (width <= 64) {
+    if (!this->words.empty()) {
+      this->inline_word = this->words[0];
+      this->words.clear();
+    }
+  } else if (this->words.empty()) {
+    this->words.assign(num_words, 0);
+    this->words[0] = this->inline_word;
+    this->inline_word = 0;
+  } else {
+    this->words.resize(num_words, 0);
+  }
+  this->width_ = width;
+  this->clearUnusedBits();
+}
+
+std::string BitVector::toString(unsigned int base) const {
+  std::string result;
+  if (unsigned int shift = bits_per_digit(base)) {
+    unsigned int active = this->activeBits();
+    for (unsigned int position = 0; position < active; position += shift) {
+      unsigned int digit = 0;
+      for (unsigned int i = 0; i < shift && position + i < active; i++) {
+        digit |= this->getBit(position + i) << i;
+      }
+      result.push_back("0123456789abcdef"[digit]);
+    }
+  } else {
+    // Repeatedly divide by 10^9, in 32 bit halves so the remainder fits
+    const std::uint64_t divisor = 1000000000ULL;
+    std::vector<std::uint64_t> value(this->data(),
+                                     this->data() + this->numWords());
+    auto is_zero = [&] {
+      return std::all_of(value.begin(), value.end(),
+                         [](std::uint64_t word) { return word == 0; });
+    };
+    while (!is_zero()) {
+      std::uint64_t remainder = 0;
+      for (std::size_t i = value.size(); i > 0; i--) {
+        std::uint64_t high = (remainder << 32) | (value[i - 1] >> 32);
+        remainder = high % divisor;
+        std::uint64_t low = (remainder << 32) | (value[i - 1] & 0xffffffffULL);
+        remainder = low % divisor;
+        value[i - 1] = ((high / divisor) << 32) | (low / divisor);
+      }
+      for (int i = 0; i < 9; i++) {
+        result.push_back('0' + remainder % 10);
+        remainder /= 10;
+      }
+    }
+    while (!result.empty() && result.back() == '0') result.pop_back();
+  }
+  if (result.empty()) return "0";
+  std::reverse(result.begin(), result.end());
+  return result;
+}
+
+std::size_t BitVector::hash() const {
+  std::size_t seed = this->width_;
+  const std::uint64_t* data = this->data();
+  for (std::size_t i = 0; i < this->numWords(); i++) {
+    seed ^= data[i] + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+  }
+  return seed;
+}
+
+bool BitVector::operator==(const BitVector& rhs) const {
+  return this->width_ == rhs.width_ &&
+         std::equal(this->data(), this->data() + this->numWords(), rhs.data());
+}
+
+}  // namespace verilogAST
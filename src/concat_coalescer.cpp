@@ -1,23 +1,32 @@
 #include "verilogAST/concat_coalescer.hpp"
+#include <algorithm>
 #include <cassert>
+#include <limits>
 
 namespace verilogAST {
 
 namespace {
 
 struct Run {
-  std::string name;
+  Symbol name;
   int first;  // inclusive
   int last;   // inclusive
 };
 
 class RunOrExpr {
  public:
-  explicit RunOrExpr(const Expression* expr) : run_(), expr_(expr) {}
-  explicit RunOrExpr(std::string name, int first, int last)
-      : run_({name, first, last}), expr_(nullptr) {}
+  explicit RunOrExpr(std::size_t arg) : run_(), arg_(arg), is_run_(false) {}
+  explicit RunOrExpr(std::size_t arg, Symbol name, int first, int last,
+                     bool exact)
+      : run_({name, first, last}), arg_(arg), is_run_(true), exact_(exact) {}
 
-  bool isRun() const { return expr_ == nullptr; }
+  bool isRun() const { return is_run_; }
+
+  static std::unique_ptr<Expression> makeIndex(LiteralPool* pool, int index) {
+    if (pool) return pool->get(index);
+    return std::unique_ptr<Expression>(
+        new NumericLiteral(std::to_string(index)));
+  }
 
   // Tries to merge in @other into this run if it is contiguous. Returns true if
   // merged, falses otherwise.
@@ -29,63 +38,83 @@ class RunOrExpr {
     return true;
   }
 
-  // Returns the expression corresponding to this run. If this is not a run,
-  // then we return a clone of the contained expression. Otherwise, we return an
-  // Index expresssion if the run contains only one index, or a Slice if it
-  // contains > 1.
-  std::unique_ptr<Expression> generateExpression() const {
-    if (not isRun()) return expr_->clone();
-    auto first = std::unique_ptr<Expression>(
-        new NumericLiteral(std::to_string(run_.first)));
+  // Returns true if the Concat argument this was made from is the expression
+  // of this run as is, i.e. it is not a run or it is an Index printed the way
+  // generateExpression would.
+  bool reusesArg() const {
+    return not isRun() or (run_.first == run_.last and exact_);
+  }
+
+  // Returns the expression corresponding to this run. If it reuses its
+  // argument of @concat, then the argument is stolen if @owner is given (it is
+  // then @concat), and cloned otherwise. Otherwise, we return an Index
+  // expresssion if the run contains only one index, or a Slice if it contains
+  // > 1. Index constants are taken from @pool if it is given.
+  std::unique_ptr<Expression> generateExpression(const Concat* concat,
+                                                 Concat* owner,
+                                                 LiteralPool* pool) const {
+    if (reusesArg()) {
+      if (owner) return std::move(owner->args[arg_]);
+      return concat->args[arg_]->clone();
+    }
+    auto first = makeIndex(pool, run_.first);
     if (run_.first == run_.last) {
       return std::unique_ptr<Expression>(
           new Index(std::make_unique<Identifier>(run_.name), std::move(first)));
     }
     auto id = std::unique_ptr<Expression>(new Identifier(run_.name));
-    auto last = std::unique_ptr<Expression>(
-        new NumericLiteral(std::to_string(run_.last)));
+    auto last = makeIndex(pool, run_.last);
     return std::unique_ptr<Expression>(
         new Slice(std::move(id), std::move(first), std::move(last)));
   }
 
  private:
   Run run_;
-  const Expression* expr_ = nullptr;
+  // Position of the first Concat argument of this run
+  std::size_t arg_;
+  bool is_run_;
+  bool exact_ = false;
 };
 
 // Tries to extract a NumericLiteral (int) from @expr. Returns a pair of <true,
 // value> if successful; otherwise, returns <false, 0>.
 std::pair<bool, int> expr_to_int(const Expression* expr) {
-  auto ptr = dynamic_cast<const NumericLiteral*>(expr);
+  auto ptr = dyn_cast<NumericLiteral>(strip_shared(expr));
   if (not ptr) return std::make_pair(false, 0);
-  return std::make_pair(true, std::atoi(ptr->value.c_str()));
+  auto value = ptr->getUInt();
+  if (not value or *value > std::numeric_limits<int>::max()) {
+    return std::make_pair(false, 0);
+  }
+  return std::make_pair(true, static_cast<int>(*value));
 }
 
-// Consumes a Concat node argument @arg and tries to make a run out of it. If it
-// is of the form Index(Identifier name, NumericLiteral val) then we return
-// RunOrExpr(name, val, val); otherwise we return RunOrExpr(arg).
-RunOrExpr makeRunOrExpr(const Expression* arg) {
-  auto index = dynamic_cast<const Index*>(arg);
-  if (not index) return RunOrExpr(arg);
+// Consumes the Concat node argument @arg at position @pos and tries to make a
+// run out of it. If it is of the form Index(Identifier name, NumericLiteral
+// val) then we return RunOrExpr(pos, name, val, val, ...); otherwise we return
+// RunOrExpr(pos).
+RunOrExpr makeRunOrExpr(std::size_t pos, const Expression* arg) {
+  auto index = dyn_cast<Index>(strip_shared(arg));
+  if (not index) return RunOrExpr(pos);
   auto as_int = expr_to_int(index->index.get());
-  if (not as_int.first) return RunOrExpr(arg);
+  if (not as_int.first) return RunOrExpr(pos);
   if (not std::holds_alternative<std::unique_ptr<Identifier>>(index->value)) {
-    return RunOrExpr(arg);
+    return RunOrExpr(pos);
   }
   auto& id = std::get<std::unique_ptr<Identifier>>(index->value);
-  return RunOrExpr(id->value, as_int.second, as_int.second);
+  bool exact = index->index->toString() == std::to_string(as_int.second);
+  return RunOrExpr(pos, id->value, as_int.second, as_int.second, exact);
 }
 
-}  // namespace
-
-std::unique_ptr<Expression> ConcatCoalescer::visit(
-    std::unique_ptr<Expression> node) {
-  auto ptr = dynamic_cast<const Concat*>(node.get());
+// Returns the Concat @node with its runs of indices coalesced, or nullptr if
+// it is left as is. The arguments of a Concat owned by @node are stolen,
+// those of a shared one are cloned.
+std::unique_ptr<Expression> coalesce(Expression* node, LiteralPool* pool) {
+  auto ptr = dyn_cast<Concat>(strip_shared(node));
   // This pass only operates on non-empty Concat nodes.
-  if (not ptr or ptr->args.size() == 0) return node;
+  if (not ptr or ptr->args.size() == 0) return nullptr;
   std::vector<RunOrExpr> runs;
-  for (const auto& arg : ptr->args) {
-    auto run_or_expr = makeRunOrExpr(arg.get());
+  for (std::size_t i = 0; i < ptr->args.size(); i++) {
+    auto run_or_expr = makeRunOrExpr(i, ptr->args[i].get());
     // If this is the first run, then we append it. Otherwise, we try to merge
     // it into the previous run. If it cannot be merged, then we append it.
     if (runs.size() == 0 or not runs.back().tryMerge(run_or_expr)) {
@@ -93,14 +122,37 @@ std::unique_ptr<Expression> ConcatCoalescer::visit(
     }
   }
   assert(runs.size() > 0);
+  // A Concat of several runs each reusing its argument is left as is.
+  if (runs.size() > 1 and
+      std::all_of(runs.begin(), runs.end(),
+                  [](const RunOrExpr& run) { return run.reusesArg(); })) {
+    return nullptr;
+  }
+  auto owner = dyn_cast<Concat>(node);
   // If there is sonly one run, then we return that run as a standalone
   // expression; otherwise, we return a Concat node containing the runs.
-  if (runs.size() == 1) return runs.front().generateExpression();
+  if (runs.size() == 1) {
+    return runs.front().generateExpression(ptr, owner, pool);
+  }
   std::vector<std::unique_ptr<Expression>> args;
   for (const auto& run : runs) {
-    args.push_back(run.generateExpression());
+    args.push_back(run.generateExpression(ptr, owner, pool));
   }
   return std::make_unique<Concat>(std::move(args));
 }
 
+}  // namespace
+
+std::unique_ptr<Expression> ConcatCoalescer::visit(
+    std::unique_ptr<Expression> node) {
+  auto result = coalesce(node.get(), pool_);
+  if (not result) return node;
+  return result;
+}
+
+void ConcatCoalescerInPlace::visit(std::unique_ptr<Expression>& node) {
+  auto result = coalesce(node.get(), pool_);
+  if (result) this->replace(node, std::move(result));
+}
+
 }  // namespace verilogAST
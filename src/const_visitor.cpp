@@ -0,0 +1,283 @@
+#include "verilogAST/const_visitor.hpp"
+
+namespace verilogAST {
+
+void ConstVisitor::visit(const Expression &node) {
+  switch (node.getKind()) {
+    case NodeKind::NumericLiteral:
+      return this->visit(static_cast<const NumericLiteral &>(node));
+    case NodeKind::Identifier:
+      return this->visit(static_cast<const Identifier &>(node));
+    case NodeKind::Cast:
+      return this->visit(static_cast<const Cast &>(node));
+    case NodeKind::Attribute:
+      return this->visit(static_cast<const Attribute &>(node));
+    case NodeKind::String:
+      return this->visit(static_cast<const String &>(node));
+    case NodeKind::Index:
+      return this->visit(static_cast<const Index &>(node));
+    case NodeKind::Slice:
+      return this->visit(static_cast<const Slice &>(node));
+    case NodeKind::BinaryOp:
+      return this->visit(static_cast<const BinaryOp &>(node));
+    case NodeKind::UnaryOp:
+      return this->visit(static_cast<const UnaryOp &>(node));
+    case NodeKind::TernaryOp:
+      return this->visit(static_cast<const TernaryOp &>(node));
+    case NodeKind::Concat:
+      return this->visit(static_cast<const Concat &>(node));
+    case NodeKind::Replicate:
+      return this->visit(static_cast<const Replicate &>(node));
+    case NodeKind::CallExpr:
+      return this->visit(static_cast<const CallExpr &>(node));
+    case NodeKind::SharedExpr:
+      return this->visit(static_cast<const SharedExpr &>(node));
+    case NodeKind::Expression:
+      // Expression subclasses defined outside this library
+      return;
+    default:
+      break;
+  }
+  throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
+}
+
+void ConstVisitor::visit(const NumericLiteral &) {}
+
+void ConstVisitor::visit(const Identifier &) {}
+
+void ConstVisitor::visit(const Cast &node) { this->visit(*node.expr); }
+
+void ConstVisitor::visit(const Attribute &node) { this->visit(node.value); }
+
+void ConstVisitor::visit(const String &) {}
+
+void ConstVisitor::visit(const Index &node) {
+  this->visit(node.value);
+  this->visit(*node.index);
+}
+
+void ConstVisitor::visit(const Slice &node) {
+  this->visit(*node.expr);
+  this->visit(*node.high_index);
+  this->visit(*node.low_index);
+}
+
+void ConstVisitor::visit(const BinaryOp &node) {
+  this->visit(*node.left);
+  this->visit(*node.right);
+}
+
+void ConstVisitor::visit(const UnaryOp &node) { this->visit(*node.operand); }
+
+void ConstVisitor::visit(const TernaryOp &node) {
+  this->visit(*node.cond);
+  this->visit(*node.true_value);
+  this->visit(*node.false_value);
+}
+
+void ConstVisitor::visit(const Concat &node) {
+  for (auto &arg : node.args) this->visit(*arg);
+}
+
+void ConstVisitor::visit(const Replicate &node) {
+  this->visit(*node.num);
+  this->visit(*node.value);
+}
+
+void ConstVisitor::visit(const CallExpr &node) {
+  for (auto &arg : node.args) this->visit(*arg);
+}
+
+void ConstVisitor::visit(const SharedExpr &node) { this->visit(*node.value); }
+
+void ConstVisitor::visit(const NegEdge &node) { this->visit(*node.value); }
+
+void ConstVisitor::visit(const PosEdge &node) { this->visit(*node.value); }
+
+void ConstVisitor::visit(const Star &) {}
+
+void ConstVisitor::visit(const Vector &node) {
+  this->visit(*node.id);
+  this->visit(*node.msb);
+  this->visit(*node.lsb);
+  if (auto ptr = dyn_cast<NDVector>(&node)) {
+    for (auto &dim : ptr->outer_dims) {
+      this->visit(*dim.first);
+      this->visit(*dim.second);
+    }
+  }
+}
+
+void ConstVisitor::visit(const AbstractPort &node) {
+  switch (node.getKind()) {
+    case NodeKind::Port:
+      return this->visit(static_cast<const Port &>(node));
+    case NodeKind::StringPort:
+      return this->visit(static_cast<const StringPort &>(node));
+    default:
+      break;
+  }
+  throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
+}
+
+void ConstVisitor::visit(const Port &node) { this->visit(node.value); }
+
+void ConstVisitor::visit(const StringPort &) {}
+
+void ConstVisitor::visit(const StructuralStatement &node) {
+  switch (node.getKind()) {
+    case NodeKind::ModuleInstantiation:
+      return this->visit(static_cast<const ModuleInstantiation &>(node));
+    case NodeKind::ContinuousAssign:
+      return this->visit(static_cast<const ContinuousAssign &>(node));
+    case NodeKind::Always:
+      return this->visit(static_cast<const Always &>(node));
+    case NodeKind::SingleLineComment:
+      return this->visit(static_cast<const SingleLineComment &>(node));
+    case NodeKind::BlockComment:
+      return this->visit(static_cast<const BlockComment &>(node));
+    case NodeKind::InlineVerilog:
+      return this->visit(static_cast<const InlineVerilog &>(node));
+    case NodeKind::IfMacro:
+    case NodeKind::IfDef:
+    case NodeKind::IfNDef:
+      return this->visit(static_cast<const IfMacro &>(node));
+    case NodeKind::StructuralStatement:
+      // Statements defined outside this library
+      return;
+    default:
+      break;
+  }
+  throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
+}
+
+void ConstVisitor::visit(const Declaration &node) {
+  switch (node.getKind()) {
+    case NodeKind::Wire:
+      return this->visit(static_cast<const Wire &>(node));
+    case NodeKind::Reg:
+      return this->visit(static_cast<const Reg &>(node));
+    default:
+      break;
+  }
+  throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
+}
+
+void ConstVisitor::visit(const BehavioralStatement &node) {
+  switch (node.getKind()) {
+    case NodeKind::BlockingAssign:
+      return this->visit(static_cast<const BlockingAssign &>(node));
+    case NodeKind::NonBlockingAssign:
+      return this->visit(static_cast<const NonBlockingAssign &>(node));
+    case NodeKind::CallStmt:
+      return this->visit(static_cast<const CallStmt &>(node));
+    case NodeKind::SingleLineComment:
+      return this->visit(static_cast<const SingleLineComment &>(node));
+    case NodeKind::BlockComment:
+      return this->visit(static_cast<const BlockComment &>(node));
+    case NodeKind::If:
+      return this->visit(static_cast<const If &>(node));
+    case NodeKind::BehavioralStatement:
+      // Statements defined outside this library
+      return;
+    default:
+      break;
+  }
+  throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
+}
+
+void ConstVisitor::visit(const SingleLineComment &) {}
+
+void ConstVisitor::visit(const BlockComment &) {}
+
+void ConstVisitor::visit(const InlineVerilog &) {}
+
+void ConstVisitor::visit(const IfMacro &node) {
+  for (auto &item : node.true_body) this->visit(item);
+  for (auto &item : node.else_body) this->visit(item);
+}
+
+void ConstVisitor::visit(const ModuleInstantiation &node) {
+  for (auto &conn : *node.connections) this->visit(*conn.second);
+  for (auto &param : node.parameters) {
+    this->visit(param.first);
+    this->visit(*param.second);
+  }
+}
+
+void ConstVisitor::visit(const Wire &node) { this->visit(node.value); }
+
+void ConstVisitor::visit(const Reg &node) { this->visit(node.value); }
+
+void ConstVisitor::visit(const ContinuousAssign &node) {
+  this->visit(node.target);
+  this->visit(*node.value);
+}
+
+void ConstVisitor::visit(const BlockingAssign &node) {
+  this->visit(node.target);
+  this->visit(*node.value);
+}
+
+void ConstVisitor::visit(const NonBlockingAssign &node) {
+  this->visit(node.target);
+  this->visit(*node.value);
+}
+
+void ConstVisitor::visit(const CallStmt &node) {
+  for (auto &arg : node.args) this->visit(*arg);
+}
+
+void ConstVisitor::visit(const If &node) {
+  this->visit(*node.cond);
+  for (auto &item : node.true_body) this->visit(*item);
+  for (auto &item : node.else_ifs) {
+    this->visit(*item.first);
+    for (auto &inner_statement : item.second) this->visit(*inner_statement);
+  }
+  for (auto &item : node.else_body) this->visit(*item);
+}
+
+void ConstVisitor::visit(const Always &node) {
+  for (auto &item : node.sensitivity_list) this->visit(item);
+  for (auto &item : node.body) this->visit(*item);
+}
+
+void ConstVisitor::visit(const AbstractModule &node) {
+  switch (node.getKind()) {
+    case NodeKind::StringBodyModule:
+      return this->visit(static_cast<const StringBodyModule &>(node));
+    case NodeKind::Module:
+      return this->visit(static_cast<const Module &>(node));
+    case NodeKind::StringModule:
+      return this->visit(static_cast<const StringModule &>(node));
+    default:
+      break;
+  }
+  throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
+}
+
+void ConstVisitor::visit(const Module &node) {
+  for (auto &item : node.ports) this->visit(*item);
+  for (auto &param : node.parameters) {
+    this->visit(param.first);
+    this->visit(*param.second);
+  }
+  for (auto &item : node.body) this->visit(item);
+}
+
+void ConstVisitor::visit(const StringBodyModule &node) {
+  for (auto &item : node.ports) this->visit(*item);
+  for (auto &param : node.parameters) {
+    this->visit(param.first);
+    this->visit(*param.second);
+  }
+}
+
+void ConstVisitor::visit(const StringModule &) {}
+
+void ConstVisitor::visit(const File &node) {
+  for (auto &item : node.modules) this->visit(*item);
+}
+
+}  // namespace verilogAST
@@ -0,0 +1,447 @@
+#include "verilogAST/constant_folder.hpp"
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <limits>
+#include <optional>
+
+namespace verilogAST {
+
+namespace {
+
+// A numeric literal operand
+struct Constant {
+  std::uint64_t value;
+  unsigned int width;
+  bool is_signed;
+  Radix radix;
+};
+
+std::optional<Constant> get_constant(const Expression* expr) {
+  auto literal = dyn_cast<NumericLiteral>(strip_shared(expr));
+  if (not literal or not literal->getBits()) return std::nullopt;
+  const BitVector* bits = literal->getBits();
+  bool sized = literal->size != 32 || literal->always_codegen_size;
+  // The width of unsized literals that don't fit in 32 bits is implementation
+  // defined
+  if (bits->width() == 0 || bits->width() > 64 ||
+      (not sized && bits->width() != 32)) {
+    return std::nullopt;
+  }
+  // Unsized decimal literals are signed integers
+  bool is_signed =
+      literal->_signed || (not sized && literal->radix == Radix::DECIMAL);
+  return Constant{bits->toUInt64(), bits->width(), is_signed, literal->radix};
+}
+
+// Width and signedness of an expression
+struct ExprType {
+  unsigned int width;
+  bool is_signed;
+
+  bool operator==(const ExprType& other) const {
+    return this->width == other.width && this->is_signed == other.is_signed;
+  }
+};
+
+// Type of `expr` where it does not depend on declarations, i.e. for literals
+// and the operators whose result is always a single unsigned bit
+std::optional<ExprType> get_type(const Expression* expr) {
+  if (auto constant = get_constant(expr)) {
+    return ExprType{constant->width, constant->is_signed};
+  }
+  expr = strip_shared(expr);
+  if (auto binop = dyn_cast<BinaryOp>(expr)) {
+    switch (binop->op) {
+      case BinOp::LAND:
+      case BinOp::LOR:
+      case BinOp::EQ:
+      case BinOp::NEQ:
+      case BinOp::LT:
+      case BinOp::LTE:
+      case BinOp::GT:
+      case BinOp::GTE:
+        return ExprType{1, false};
+      default:
+        return std::nullopt;
+    }
+  }
+  if (auto unop = dyn_cast<UnaryOp>(expr)) {
+    switch (unop->op) {
+      case UnOp::PLUS:
+      case UnOp::MINUS:
+      case UnOp::INVERT:
+        return get_type(unop->operand.get());
+      default:
+        return ExprType{1, false};
+    }
+  }
+  return std::nullopt;
+}
+
+// Whether `x op c` has the type of `x`, where `op` extends both operands to
+// the wider of the two and is only signed if both are. Every expression is at
+// least one bit wide, so that holds for a one bit signed `c` even if the type
+// of `x` is unknown.
+bool keeps_type(const std::optional<ExprType>& x, const Constant& c) {
+  if (not x) return c.width == 1 && c.is_signed;
+  return c.width <= x->width && (c.is_signed || not x->is_signed);
+}
+
+std::uint64_t mask(unsigned int width) {
+  return width >= 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << width) - 1;
+}
+
+std::int64_t sign_extend(std::uint64_t value, unsigned int width) {
+  if (width < 64 && (value >> (width - 1)) & 1) value |= ~mask(width);
+  return static_cast<std::int64_t>(value);
+}
+
+std::unique_ptr<Expression> make_literal(std::uint64_t value,
+                                         unsigned int width, bool is_signed,
+                                         Radix radix) {
+  // Negative values read better in hex
+  if (is_signed && radix == Radix::DECIMAL && (value >> (width - 1)) & 1) {
+    radix = Radix::HEX;
+  }
+  if (width == 32 && radix == Radix::DECIMAL) {
+    // Unsized decimal literals are signed, so unsigned ones need the size
+    auto literal = std::make_unique<NumericLiteral>(BitVector(width, value));
+    literal->always_codegen_size = not is_signed;
+    return literal;
+  }
+  return std::make_unique<NumericLiteral>(BitVector(width, value), radix,
+                                          is_signed);
+}
+
+std::unique_ptr<Expression> make_bool(bool value) {
+  return std::make_unique<NumericLiteral>(BitVector(1, value), Radix::BINARY);
+}
+
+bool is_shift(BinOp::BinOp op) {
+  return op == BinOp::LSHIFT || op == BinOp::RSHIFT || op == BinOp::ALSHIFT ||
+         op == BinOp::ARSHIFT;
+}
+
+// Result of `op` on the zero extended operands, if it fits in `width` bits
+// (i.e. does not depend on the width the expression is evaluated at)
+std::optional<std::uint64_t> eval_unsigned(BinOp::BinOp op,
+                                           const Constant& lhs,
+                                           const Constant& rhs,
+                                           unsigned int width) {
+  std::uint64_t x = lhs.value, y = rhs.value, max = mask(width);
+  switch (op) {
+    case BinOp::ADD:
+      if (y > max - x) return std::nullopt;
+      return x + y;
+    case BinOp::SUB:
+      if (x < y) return std::nullopt;
+      return x - y;
+    case BinOp::MUL:
+      if (x != 0 && y > max / x) return std::nullopt;
+      return x * y;
+    case BinOp::DIV:
+      if (y == 0) return std::nullopt;
+      return x / y;
+    case BinOp::MOD:
+      if (y == 0) return std::nullopt;
+      return x % y;
+    case BinOp::AND:
+      return x & y;
+    case BinOp::OR:
+      return x | y;
+    case BinOp::XOR:
+      return x ^ y;
+    case BinOp::LSHIFT:
+    case BinOp::ALSHIFT:
+      if (x == 0) return 0;
+      if (y >= width || x > (max >> y)) return std::nullopt;
+      return x << y;
+    case BinOp::RSHIFT:
+    case BinOp::ARSHIFT:
+      return y >= 64 ? 0 : x >> y;
+    default:
+      return std::nullopt;
+  }
+}
+
+// Bits of the result of `op` on the sign extended operands, if the result
+// fits in `width` bits. The shift amount is always unsigned.
+std::optional<std::uint64_t> eval_signed(BinOp::BinOp op, const Constant& lhs,
+                                         const Constant& rhs,
+                                         unsigned int width) {
+  std::int64_t lo = width >= 64 ? std::numeric_limits<std::int64_t>::min()
+                                : -(std::int64_t(1) << (width - 1));
+  std::int64_t hi = width >= 64 ? std::numeric_limits<std::int64_t>::max()
+                                : (std::int64_t(1) << (width - 1)) - 1;
+  std::int64_t x = sign_extend(lhs.value, lhs.width);
+  std::int64_t y = sign_extend(rhs.value, rhs.width);
+  std::uint64_t shift = rhs.value;
+  std::int64_t result;
+  switch (op) {
+    case BinOp::ADD:
+      if ((y > 0 && x > hi - y) || (y < 0 && x < lo - y)) return std::nullopt;
+      result = x + y;
+      break;
+    case BinOp::SUB:
+      if ((y < 0 && x > hi + y) || (y > 0 && x < lo + y)) return std::nullopt;
+      result = x - y;
+      break;
+    case BinOp::MUL: {
+      std::uint64_t ux = x < 0 ? 0 - static_cast<std::uint64_t>(x) : x;
+      std::uint64_t uy = y < 0 ? 0 - static_cast<std::uint64_t>(y) : y;
+      bool negative = (x < 0) != (y < 0);
+      std::uint64_t limit = static_cast<std::uint64_t>(hi) + negative;
+      if (ux != 0 && uy > limit / ux) return std::nullopt;
+      std::uint64_t product = ux * uy;
+      return (negative ? 0 - product : product) & mask(width);
+    }
+    case BinOp::DIV:
+      if (y == 0 || (x == lo && y == -1)) return std::nullopt;
+      result = x / y;
+      break;
+    case BinOp::MOD:
+      if (y == 0 || (x == lo && y == -1)) return std::nullopt;
+      result = x % y;
+      break;
+    case BinOp::AND:
+      result = x & y;
+      break;
+    case BinOp::OR:
+      result = x | y;
+      break;
+    case BinOp::XOR:
+      result = x ^ y;
+      break;
+    case BinOp::LSHIFT:
+    case BinOp::ALSHIFT:
+      if (x == 0) return 0;
+      if (shift >= width || x > (hi >> shift) || x < (lo >> shift)) {
+        return std::nullopt;
+      }
+      return (static_cast<std::uint64_t>(x) << shift) & mask(width);
+    case BinOp::RSHIFT:
+      // The sign bits shifted in depend on the width
+      if (x < 0) return std::nullopt;
+      result = shift >= 64 ? 0 : x >> shift;
+      break;
+    case BinOp::ARSHIFT:
+      result = shift >= 64 ? (x < 0 ? -1 : 0) : x >> shift;
+      break;
+    default:
+      return std::nullopt;
+  }
+  return static_cast<std::uint64_t>(result) & mask(width);
+}
+
+// Comparison and logical operators, their operands are extended to the wider
+// of the two and the result is a single bit
+std::optional<bool> eval_bool(BinOp::BinOp op, const Constant& lhs,
+                              const Constant& rhs) {
+  switch (op) {
+    case BinOp::LAND:
+      return lhs.value != 0 && rhs.value != 0;
+    case BinOp::LOR:
+      return lhs.value != 0 || rhs.value != 0;
+    default:
+      break;
+  }
+  int order;
+  if (lhs.is_signed && rhs.is_signed) {
+    std::int64_t x = sign_extend(lhs.value, lhs.width);
+    std::int64_t y = sign_extend(rhs.value, rhs.width);
+    order = (x > y) - (x < y);
+  } else {
+    order = (lhs.value > rhs.value) - (lhs.value < rhs.value);
+  }
+  switch (op) {
+    case BinOp::EQ:
+      return order == 0;
+    case BinOp::NEQ:
+      return order != 0;
+    case BinOp::LT:
+      return order < 0;
+    case BinOp::LTE:
+      return order <= 0;
+    case BinOp::GT:
+      return order > 0;
+    case BinOp::GTE:
+      return order >= 0;
+    default:
+      return std::nullopt;
+  }
+}
+
+std::unique_ptr<Expression> fold_constants(BinOp::BinOp op,
+                                           const Constant& lhs,
+                                           const Constant& rhs) {
+  if (auto result = eval_bool(op, lhs, rhs)) return make_bool(*result);
+  // The left operand of a shift determines the width and signedness
+  bool shift = is_shift(op);
+  unsigned int width = shift ? lhs.width : std::max(lhs.width, rhs.width);
+  bool is_signed = shift ? lhs.is_signed : lhs.is_signed && rhs.is_signed;
+  // A signed expression is evaluated unsigned in an unsigned context, so both
+  // have to agree
+  auto result = eval_unsigned(op, lhs, rhs, width);
+  if (not result) return nullptr;
+  if (is_signed && eval_signed(op, lhs, rhs, width) != result) return nullptr;
+  return make_literal(*result, width, is_signed, lhs.radix);
+}
+
+}  // namespace
+
+std::unique_ptr<Expression> ConstantFolder::visit(
+    std::unique_ptr<Expression> node) {
+  // Operands are folded first, so nested constant expressions collapse in a
+  // single pass
+  node = Transformer::visit(std::move(node));
+  if (!node) return node;
+  switch (node->getKind()) {
+    case NodeKind::BinaryOp:
+      return this->fold(unique_cast<BinaryOp>(std::move(node)));
+    case NodeKind::UnaryOp:
+      return this->fold(unique_cast<UnaryOp>(std::move(node)));
+    case NodeKind::TernaryOp:
+      return this->fold(unique_cast<TernaryOp>(std::move(node)));
+    default:
+      return node;
+  }
+}
+
+std::unique_ptr<Expression> ConstantFolder::fold(
+    std::unique_ptr<BinaryOp> node) {
+  auto lhs = get_constant(node->left.get());
+  auto rhs = get_constant(node->right.get());
+  if (lhs && rhs) {
+    if (auto folded = fold_constants(node->op, *lhs, *rhs)) return folded;
+    return node;
+  }
+  if (not lhs && not rhs) return node;
+
+  // These hold whatever the width of the other operand
+  if (node->op == BinOp::LAND && ((lhs && lhs->value == 0) ||
+                                  (rhs && rhs->value == 0))) {
+    return make_bool(false);
+  }
+  if (node->op == BinOp::LOR && ((lhs && lhs->value != 0) ||
+                                 (rhs && rhs->value != 0))) {
+    return make_bool(true);
+  }
+  if (is_shift(node->op) && rhs && rhs->value == 0) {
+    return std::move(node->left);
+  }
+
+  if (not fold_identities_) return node;
+  const Constant& constant = lhs ? *lhs : *rhs;
+  std::unique_ptr<Expression>& literal = lhs ? node->left : node->right;
+  std::unique_ptr<Expression>& other = lhs ? node->right : node->left;
+  std::optional<ExprType> other_type = get_type(other.get());
+  if (constant.value == 0) {
+    switch (node->op) {
+      case BinOp::ADD:
+      case BinOp::XOR:
+      case BinOp::OR:
+        if (keeps_type(other_type, constant)) return std::move(other);
+        break;
+      case BinOp::SUB:
+        if (rhs && keeps_type(other_type, constant)) return std::move(other);
+        break;
+      case BinOp::AND:
+        // The result has the type of the literal if `x` is not wider and only
+        // signed if the literal is
+        if (other_type && other_type->width <= constant.width &&
+            (other_type->is_signed || not constant.is_signed)) {
+          return std::move(literal);
+        }
+        break;
+      default:
+        break;
+    }
+  } else if (constant.value == 1 && (node->op == BinOp::MUL ||
+                                     (node->op == BinOp::DIV && rhs))) {
+    // A one bit 1 is -1 once sign extended, so the type of `x` has to be known
+    // to tell whether it is
+    if (other_type && keeps_type(other_type, constant) &&
+        not(constant.width == 1 && constant.is_signed &&
+            other_type->is_signed)) {
+      return std::move(other);
+    }
+  }
+  return node;
+}
+
+std::unique_ptr<Expression> ConstantFolder::fold(
+    std::unique_ptr<UnaryOp> node) {
+  auto operand = get_constant(node->operand.get());
+  if (not operand) return node;
+  std::uint64_t value = operand->value;
+  bool all_ones = value == mask(operand->width);
+  bool parity = std::bitset<64>(value).count() & 1;
+  switch (node->op) {
+    case UnOp::NOT:
+      return make_bool(value == 0);
+    case UnOp::AND:
+      return make_bool(all_ones);
+    case UnOp::NAND:
+      return make_bool(not all_ones);
+    case UnOp::OR:
+      return make_bool(value != 0);
+    case UnOp::NOR:
+      return make_bool(value == 0);
+    case UnOp::XOR:
+      return make_bool(parity);
+    case UnOp::NXOR:
+    case UnOp::XNOR:
+      return make_bool(not parity);
+    case UnOp::PLUS:
+      return std::move(node->operand);
+    case UnOp::MINUS:
+      // The negation of anything else depends on the width it is evaluated at
+      if (value == 0) return std::move(node->operand);
+      return node;
+    case UnOp::INVERT:
+      // Same for the inverse, e.g. `~8'd0` is 16'hffff in a 16 bit context
+      return node;
+  }
+  return node;
+}
+
+std::unique_ptr<Expression> ConstantFolder::fold(
+    std::unique_ptr<TernaryOp> node) {
+  auto cond = get_constant(node->cond.get());
+  if (not cond) return node;
+  std::unique_ptr<Expression>& chosen =
+      cond->value != 0 ? node->true_value : node->false_value;
+  std::unique_ptr<Expression>& other =
+      cond->value != 0 ? node->false_value : node->true_value;
+  auto chosen_constant = get_constant(chosen.get());
+  auto other_constant = get_constant(other.get());
+  if (chosen_constant && other_constant) {
+    // The result has the width of the wider branch, and is only signed if
+    // both are
+    unsigned int width =
+        std::max(chosen_constant->width, other_constant->width);
+    bool is_signed = chosen_constant->is_signed && other_constant->is_signed;
+    std::uint64_t value = chosen_constant->value;
+    if (is_signed &&
+        (static_cast<std::uint64_t>(
+             sign_extend(value, chosen_constant->width)) &
+         mask(width)) != value) {
+      // Sign and zero extension differ, so the value depends on the context
+      return node;
+    }
+    return make_literal(value, width, is_signed, chosen_constant->radix);
+  }
+  // The result has the width of the wider branch, and is only signed if both
+  // are, so the chosen branch can only replace it if it has that type
+  auto chosen_type = get_type(chosen.get());
+  auto other_type = get_type(other.get());
+  if (fold_identities_ && chosen_type && other_type &&
+      chosen_type->width >= other_type->width &&
+      (other_type->is_signed || not chosen_type->is_signed)) {
+    return std::move(chosen);
+  }
+  return node;
+}
+
+}  // namespace verilogAST
@@ -0,0 +1,131 @@
+#include "verilogAST/file_writer.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace verilogAST {
+
+FileWriter::FileWriter(Sink& sink, bool background, std::size_t buffer_size)
+    : sink(&sink), buffer_size(buffer_size) {
+  this->start(background);
+}
+
+FileWriter::FileWriter(const std::string& path, bool background,
+                       std::size_t buffer_size)
+    : buffer_size(buffer_size) {
+  this->fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (this->fd < 0) {
+    throw std::runtime_error("vAST::FileWriter could not open " + path + ": " +
+                             std::strerror(errno));
+  }
+  // Output is already buffered here, so the FdSink writes straight through
+  this->owned_sink = std::make_unique<FdSink>(this->fd, 0);
+  this->sink = this->owned_sink.get();
+  this->start(background);
+}
+
+void FileWriter::start(bool background) {
+  this->buffer.reserve(this->buffer_size);
+  if (background) {
+    this->writer = std::thread([this]() { this->write_pending(); });
+  }
+}
+
+void FileWriter::write_pending() {
+  std::unique_lock<std::mutex> lock(this->mutex);
+  while (true) {
+    this->cv.wait(lock,
+                  [this]() { return this->has_pending || this->stopping; });
+    if (!this->has_pending) return;
+    lock.unlock();
+    std::exception_ptr write_error;
+    try {
+      *this->sink << this->pending;
+    } catch (...) {
+      write_error = std::current_exception();
+    }
+    lock.lock();
+    this->pending.clear();
+    this->has_pending = false;
+    this->cv.notify_all();
+    if (write_error) {
+      this->error = write_error;
+      return;
+    }
+  }
+}
+
+void FileWriter::submit() {
+  if (!this->writer.joinable()) {
+    *this->sink << this->buffer;
+    this->buffer.clear();
+    return;
+  }
+  std::unique_lock<std::mutex> lock(this->mutex);
+  this->cv.wait(lock, [this]() { return !this->has_pending || this->error; });
+  if (this->error) std::rethrow_exception(this->error);
+  this->pending.swap(this->buffer);
+  this->has_pending = true;
+  this->cv.notify_all();
+}
+
+void FileWriter::append(std::unique_ptr<AbstractModule> module) {
+  if (this->closed) throw std::runtime_error("vAST::FileWriter is closed");
+  {
+    StringSink module_sink(this->buffer);
+    module_sink.setOptions(this->sink->getOptions());
+    if (!this->first) module_sink << '\n';
+    this->first = false;
+    module->emit(module_sink);
+  }
+  module.reset();
+  if (this->buffer.size() >= this->buffer_size) this->submit();
+}
+
+void FileWriter::close() {
+  if (this->closed) return;
+  this->closed = true;
+  std::exception_ptr close_error;
+  try {
+    if (!this->buffer.empty()) this->submit();
+  } catch (...) {
+    close_error = std::current_exception();
+  }
+  if (this->writer.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->stopping = true;
+    }
+    this->cv.notify_all();
+    this->writer.join();
+    if (!close_error) close_error = this->error;
+  }
+  try {
+    if (!close_error) this->sink->flush();
+  } catch (...) {
+    close_error = std::current_exception();
+  }
+  if (this->fd >= 0) {
+    this->owned_sink.reset();
+    if (::close(this->fd) != 0 && !close_error) {
+      close_error = std::make_exception_ptr(std::runtime_error(
+          std::string("vAST::FileWriter close failed: ") +
+          std::strerror(errno)));
+    }
+    this->fd = -1;
+  }
+  if (close_error) std::rethrow_exception(close_error);
+}
+
+FileWriter::~FileWriter() {
+  try {
+    this->close();
+  } catch (...) {
+    // Destructors must not throw, callers that care should close() explicitly
+  }
+}
+
+}  // namespace verilogAST
@@ -0,0 +1,53 @@
+#include "verilogAST/hash_cons.hpp"
+
+namespace verilogAST {
+
+std::unique_ptr<Expression> StaticExprInterner::visit(
+    std::unique_ptr<Expression> node) {
+  if (isa<SharedExpr>(node)) {
+    return this->visit(unique_cast<SharedExpr>(std::move(node)));
+  }
+  // Children first, so the node is hashed and compared against references
+  node = StaticTransformer::visit(std::move(node));
+  auto it = this->table.find(node.get());
+  if (it == this->table.end()) {
+    std::shared_ptr<const Expression> shared = std::move(node);
+    it = this->table.emplace(shared.get(), shared).first;
+  }
+  return std::make_unique<SharedExpr>(it->second);
+}
+
+std::unique_ptr<SharedExpr> ExprInterner::intern(
+    std::unique_ptr<Expression> node) {
+  return unique_cast<SharedExpr>(this->visit(std::move(node)));
+}
+
+std::size_t LiteralPool::KeyHash::operator()(const Key& key) const {
+  std::size_t seed = std::hash<std::string>{}(std::get<0>(key));
+  seed ^= std::get<1>(key) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+  seed ^= (std::get<2>(key) | std::get<3>(key) << 1 | std::get<4>(key) << 3) +
+          0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+  return seed;
+}
+
+std::unique_ptr<SharedExpr> LiteralPool::get(std::string value,
+                                             unsigned int size, bool _signed,
+                                             Radix radix,
+                                             bool always_codegen_size) {
+  Key key(std::move(value), size, _signed, radix, always_codegen_size);
+  std::lock_guard<std::mutex> lock(this->mutex);
+  auto it = this->literals.find(key);
+  if (it == this->literals.end()) {
+    auto literal = std::make_shared<const NumericLiteral>(
+        std::get<0>(key), size, _signed, radix, always_codegen_size);
+    it = this->literals.emplace(std::move(key), std::move(literal)).first;
+  }
+  return std::make_unique<SharedExpr>(it->second);
+}
+
+std::size_t LiteralPool::size() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->literals.size();
+}
+
+}  // namespace verilogAST
@@ -0,0 +1,252 @@
+#include "verilogAST/incremental_assign_inliner.hpp"
+#include <type_traits>
+#include <unordered_map>
+#include "verilogAST/const_visitor.hpp"
+
+namespace verilogAST {
+
+namespace {
+
+// Records the signals mentioned by a statement
+class SignalCollector : public ConstVisitor {
+  const SymbolSet &output_ports;
+  SymbolSet seen;
+  // Set while visiting the signal an assign drives, but not the index
+  // expressions selecting part of it
+  bool in_target = false;
+
+  template <typename T>
+  void process_assign(const T &node) {
+    this->in_target = true;
+    this->visit(node.target);
+    this->in_target = false;
+    auto target = std::get_if<std::unique_ptr<Identifier>>(&node.target);
+    if (target && this->output_ports.count((*target)->value)) {
+      auto driver = dyn_cast<Identifier>(strip_shared(node.value.get()));
+      if (driver) {
+        this->output_drivers.push_back(driver->value);
+      }
+    }
+    this->visit(*node.value);
+  }
+
+ public:
+  std::vector<Symbol> signals;
+  std::vector<Symbol> targets;
+  std::vector<Symbol> output_drivers;
+
+  explicit SignalCollector(const SymbolSet &output_ports)
+      : output_ports(output_ports){};
+
+  using ConstVisitor::visit;
+  void visit(const Identifier &node) override {
+    if (this->seen.insert(node.value)) this->signals.push_back(node.value);
+    if (this->in_target) this->targets.push_back(node.value);
+  }
+  void visit(const Index &node) override {
+    this->visit(node.value);
+    bool target = this->in_target;
+    this->in_target = false;
+    this->visit(*node.index);
+    this->in_target = target;
+  }
+  void visit(const Slice &node) override {
+    this->visit(*node.expr);
+    bool target = this->in_target;
+    this->in_target = false;
+    this->visit(*node.high_index);
+    this->visit(*node.low_index);
+    this->in_target = target;
+  }
+  void visit(const ContinuousAssign &node) override {
+    this->process_assign(node);
+  }
+  void visit(const BlockingAssign &node) override {
+    this->process_assign(node);
+  }
+};
+
+const void *statement_ptr(
+    const IncrementalAssignInliner::Statement &statement) {
+  return std::visit([](auto &&value) -> const void * { return value.get(); },
+                    statement);
+}
+
+}  // namespace
+
+IncrementalAssignInliner::IncrementalAssignInliner(
+    std::unique_ptr<Module> module,
+    const std::set<std::string> &wire_blacklist)
+    : module(std::move(module)), inliner(wire_blacklist) {
+  for (auto &abstract_port : this->module->ports) {
+    auto port = dyn_cast<Port>(abstract_port.get());
+    if (!port) continue;
+    Symbol name = std::visit(
+        [](auto &&value) -> Symbol {
+          using ValueType = std::decay_t<decltype(value)>;
+          if constexpr (std::is_same_v<ValueType,
+                                       std::unique_ptr<Identifier>>) {
+            return value->value;
+          } else {
+            return value->id->value;
+          }
+        },
+        port->value);
+    if (port->direction == Direction::OUTPUT) this->output_ports.insert(name);
+    if (port->direction == Direction::INPUT) this->input_ports.insert(name);
+  }
+  for (auto &statement : this->module->body) {
+    this->entries.push_back(std::make_unique<Entry>());
+    this->index(*this->entries.back(), statement);
+    this->pending.insert(this->entries.back().get());
+  }
+}
+
+bool IncrementalAssignInliner::couples(Symbol signal) const {
+  auto assigns = this->assign_count.find(signal);
+  if (assigns != this->assign_count.end() && assigns->second > 0) return true;
+  // Inputs are never renamed after the output they drive
+  auto drivers = this->output_driver_count.find(signal);
+  if (drivers != this->output_driver_count.end() && drivers->second > 0 &&
+      !this->input_ports.count(signal)) {
+    return true;
+  }
+  return this->output_ports.count(signal);
+}
+
+void IncrementalAssignInliner::index(Entry &entry,
+                                     const Statement &statement) {
+  SignalCollector collector(this->output_ports);
+  collector.visit(statement);
+  entry.signals = std::move(collector.signals);
+  entry.targets = std::move(collector.targets);
+  entry.output_drivers = std::move(collector.output_drivers);
+  for (auto signal : entry.signals) this->mentions[signal].insert(&entry);
+  for (auto signal : entry.targets) this->assign_count[signal]++;
+  for (auto signal : entry.output_drivers) this->output_driver_count[signal]++;
+}
+
+void IncrementalAssignInliner::unindex(Entry &entry) {
+  for (auto signal : entry.signals) {
+    auto it = this->mentions.find(signal);
+    it->second.erase(&entry);
+    if (it->second.empty()) this->mentions.erase(signal);
+  }
+  for (auto signal : entry.targets) {
+    if (--this->assign_count[signal] == 0) this->assign_count.erase(signal);
+  }
+  for (auto signal : entry.output_drivers) {
+    if (--this->output_driver_count[signal] == 0) {
+      this->output_driver_count.erase(signal);
+    }
+  }
+  entry.signals.clear();
+  entry.targets.clear();
+  entry.output_drivers.clear();
+}
+
+void IncrementalAssignInliner::seed(const Entry &entry) {
+  for (auto signal : entry.signals) {
+    if (this->couples(signal)) this->seeds.push_back(signal);
+  }
+}
+
+void IncrementalAssignInliner::insert(std::size_t index, Statement statement) {
+  auto entry = std::make_unique<Entry>();
+  this->index(*entry, statement);
+  this->seed(*entry);
+  this->pending.insert(entry.get());
+  this->module->body.insert(this->module->body.begin() + index,
+                            std::move(statement));
+  this->entries.insert(this->entries.begin() + index, std::move(entry));
+}
+
+void IncrementalAssignInliner::erase(std::size_t index) {
+  Entry &entry = *this->entries[index];
+  // Seeded before unindexing, the statements coupled by the signals the
+  // erased statement assigns depend on it
+  this->seed(entry);
+  this->unindex(entry);
+  this->pending.erase(&entry);
+  this->module->body.erase(this->module->body.begin() + index);
+  this->entries.erase(this->entries.begin() + index);
+}
+
+void IncrementalAssignInliner::replace(std::size_t index,
+                                       Statement statement) {
+  this->erase(index);
+  this->insert(index, std::move(statement));
+}
+
+std::size_t IncrementalAssignInliner::update() {
+  // Walks the coupling signals from the edits
+  SymbolSet visited;
+  std::vector<Symbol> stack;
+  auto add_signal = [&](Symbol signal) {
+    if (visited.insert(signal)) stack.push_back(signal);
+  };
+  auto add_entry = [&](Entry *entry) {
+    if (entry->in_cone) return;
+    entry->in_cone = true;
+    for (auto signal : entry->signals) {
+      if (this->couples(signal)) add_signal(signal);
+    }
+  };
+  for (auto entry : this->pending) add_entry(entry);
+  for (auto signal : this->seeds) add_signal(signal);
+  this->pending.clear();
+  this->seeds.clear();
+  while (!stack.empty()) {
+    Symbol signal = stack.back();
+    stack.pop_back();
+    auto it = this->mentions.find(signal);
+    if (it == this->mentions.end()) continue;
+    for (auto entry : it->second) add_entry(entry);
+  }
+
+  // Inlines the cone as a module of its own, with the ports and parameters
+  // of the edited module
+  auto &body = this->module->body;
+  std::vector<Statement> cone_body;
+  std::vector<std::size_t> positions;
+  std::unordered_map<const void *, std::size_t> position_of;
+  for (std::size_t i = 0; i < body.size(); i++) {
+    if (!this->entries[i]->in_cone) continue;
+    positions.push_back(i);
+    position_of[statement_ptr(body[i])] = i;
+    cone_body.push_back(std::move(body[i]));
+  }
+  if (cone_body.empty()) return 0;
+  auto cone = std::make_unique<Module>(
+      this->module->name, std::move(this->module->ports),
+      std::move(cone_body), std::move(this->module->parameters));
+  cone = this->inliner.visit(std::move(cone));
+  this->module->ports = std::move(cone->ports);
+  this->module->parameters = std::move(cone->parameters);
+  // Statements are rewritten in place, or removed
+  for (auto &statement : cone->body) {
+    body[position_of.at(statement_ptr(statement))] = std::move(statement);
+  }
+
+  for (auto i : positions) {
+    Entry &entry = *this->entries[i];
+    this->unindex(entry);
+    entry.in_cone = false;
+    if (statement_ptr(body[i])) this->index(entry, body[i]);
+  }
+  // Drops the removed statements
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < body.size(); i++) {
+    if (!statement_ptr(body[i])) continue;
+    if (kept != i) {
+      body[kept] = std::move(body[i]);
+      this->entries[kept] = std::move(this->entries[i]);
+    }
+    kept++;
+  }
+  body.resize(kept);
+  this->entries.resize(kept);
+  return positions.size();
+}
+
+}  // namespace verilogAST
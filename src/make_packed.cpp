@@ -3,19 +3,27 @@
 
 namespace verilogAST {
 
+namespace {
+
+// The dimensions are moved out of the NDVector it replaces
+std::unique_ptr<Vector> pack(NDVector& vector) {
+  return std::make_unique<PackedNDVector>(
+      std::move(vector.id), std::move(vector.msb), std::move(vector.lsb),
+      std::move(vector.outer_dims));
+}
+
+}  // namespace
+
 std::unique_ptr<Vector> MakePacked::visit(std::unique_ptr<Vector> vector) {
-  auto ptr = dynamic_cast<const NDVector*>(vector.get());
+  auto ptr = dyn_cast<NDVector>(vector.get());
   if (not ptr) return vector;
-  std::vector<
-      std::pair<std::unique_ptr<Expression>, std::unique_ptr<Expression>>>
-      outer_dims;
-  for (const auto& dim : ptr->outer_dims) {
-    outer_dims.push_back(
-        std::make_pair(dim.first->clone(), dim.second->clone()));
-  }
-  return std::make_unique<PackedNDVector>(ptr->id->clone(), ptr->msb->clone(),
-                                          ptr->lsb->clone(),
-                                          std::move(outer_dims));
+  return pack(*ptr);
+}
+
+void MakePackedInPlace::visit(std::unique_ptr<Vector>& vector) {
+  auto ptr = dyn_cast<NDVector>(vector.get());
+  if (not ptr) return;
+  this->replace(vector, pack(*ptr));
 }
 
 }  // namespace verilogAST
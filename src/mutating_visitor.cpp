@@ -0,0 +1,355 @@
+#include "verilogAST/mutating_visitor.hpp"
+
+namespace verilogAST {
+
+template <typename F>
+void MutatingVisitor::visit_children(Expression &node, F visit_fn) {
+  bool outer = this->modified;
+  this->modified = false;
+  visit_fn();
+  if (this->modified) node.invalidateHash();
+  this->modified = outer || this->modified;
+}
+
+void MutatingVisitor::visit_shared(std::unique_ptr<Expression> &node) {
+  std::shared_ptr<const Expression> value =
+      static_cast<SharedExpr *>(node.get())->value;
+  if (this->memoize_shared) {
+    auto it = this->shared_results.find(value.get());
+    if (it != this->shared_results.end()) {
+      if (it->second.second != value) {
+        this->replace(node, std::make_unique<SharedExpr>(it->second.second));
+      }
+      return;
+    }
+  }
+  std::unique_ptr<Expression> copy = value->clone();
+  bool outer = this->modified;
+  this->modified = false;
+  this->visit(copy);
+  bool changed = this->modified;
+  this->modified = outer || changed;
+  if (!this->memoize_shared) {
+    // Unchanged, the shared reference is kept
+    if (changed) node = std::move(copy);
+    return;
+  }
+  std::shared_ptr<const Expression> result = value;
+  if (changed) {
+    if (auto shared = dyn_cast<SharedExpr>(copy.get())) {
+      result = shared->value;
+    } else {
+      result = std::move(copy);
+    }
+  }
+  this->shared_results.emplace(value.get(), std::make_pair(value, result));
+  if (changed) node = std::make_unique<SharedExpr>(std::move(result));
+}
+
+void MutatingVisitor::visit(std::unique_ptr<Expression> &node) {
+  if (!node) return;
+  switch (node->getKind()) {
+    case NodeKind::NumericLiteral:
+      return this->visit(*static_cast<NumericLiteral *>(node.get()));
+    case NodeKind::Identifier:
+      return this->visit(*static_cast<Identifier *>(node.get()));
+    case NodeKind::Cast:
+      return this->visit(*static_cast<Cast *>(node.get()));
+    case NodeKind::Attribute:
+      return this->visit(*static_cast<Attribute *>(node.get()));
+    case NodeKind::String:
+      return this->visit(*static_cast<String *>(node.get()));
+    case NodeKind::Index:
+      return this->visit(*static_cast<Index *>(node.get()));
+    case NodeKind::Slice:
+      return this->visit(*static_cast<Slice *>(node.get()));
+    case NodeKind::BinaryOp:
+      return this->visit(*static_cast<BinaryOp *>(node.get()));
+    case NodeKind::UnaryOp:
+      return this->visit(*static_cast<UnaryOp *>(node.get()));
+    case NodeKind::TernaryOp:
+      return this->visit(*static_cast<TernaryOp *>(node.get()));
+    case NodeKind::Concat:
+      return this->visit(*static_cast<Concat *>(node.get()));
+    case NodeKind::Replicate:
+      return this->visit(*static_cast<Replicate *>(node.get()));
+    case NodeKind::CallExpr:
+      return this->visit(*static_cast<CallExpr *>(node.get()));
+    case NodeKind::SharedExpr:
+      return this->visit_shared(node);
+    case NodeKind::Expression:
+      // Expression subclasses defined outside this library
+      return;
+    default:
+      break;
+  }
+  throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
+}
+
+void MutatingVisitor::visit(NumericLiteral &) {}
+
+void MutatingVisitor::visit(Identifier &) {}
+
+void MutatingVisitor::visit(Cast &node) {
+  this->visit_children(node, [&]() { this->visit(node.expr); });
+}
+
+void MutatingVisitor::visit(Attribute &node) {
+  this->visit_children(node, [&]() { this->visit(node.value); });
+}
+
+void MutatingVisitor::visit(String &) {}
+
+void MutatingVisitor::visit(Index &node) {
+  this->visit_children(node, [&]() {
+    this->visit(node.value);
+    this->visit(node.index);
+  });
+}
+
+void MutatingVisitor::visit(Slice &node) {
+  this->visit_children(node, [&]() {
+    this->visit(node.expr);
+    this->visit(node.high_index);
+    this->visit(node.low_index);
+  });
+}
+
+void MutatingVisitor::visit(BinaryOp &node) {
+  this->visit_children(node, [&]() {
+    this->visit(node.left);
+    this->visit(node.right);
+  });
+}
+
+void MutatingVisitor::visit(UnaryOp &node) {
+  this->visit_children(node, [&]() { this->visit(node.operand); });
+}
+
+void MutatingVisitor::visit(TernaryOp &node) {
+  this->visit_children(node, [&]() {
+    this->visit(node.cond);
+    this->visit(node.true_value);
+    this->visit(node.false_value);
+  });
+}
+
+void MutatingVisitor::visit(Concat &node) {
+  this->visit_children(node, [&]() {
+    for (auto &arg : node.args) this->visit(arg);
+  });
+}
+
+void MutatingVisitor::visit(Replicate &node) {
+  this->visit_children(node, [&]() {
+    this->visit(node.num);
+    this->visit(node.value);
+  });
+}
+
+void MutatingVisitor::visit(CallExpr &node) {
+  this->visit_children(node, [&]() {
+    for (auto &arg : node.args) this->visit(arg);
+  });
+}
+
+void MutatingVisitor::visit(NegEdge &node) { this->visit(*node.value); }
+
+void MutatingVisitor::visit(PosEdge &node) { this->visit(*node.value); }
+
+void MutatingVisitor::visit(Star &) {}
+
+void MutatingVisitor::visit(std::unique_ptr<Vector> &node) {
+  this->visit(*node);
+}
+
+void MutatingVisitor::visit(Vector &node) {
+  this->visit(*node.id);
+  this->visit(node.msb);
+  this->visit(node.lsb);
+  if (auto ptr = dyn_cast<NDVector>(&node)) {
+    for (auto &dim : ptr->outer_dims) {
+      this->visit(dim.first);
+      this->visit(dim.second);
+    }
+  }
+}
+
+void MutatingVisitor::visit(std::unique_ptr<AbstractPort> &node) {
+  if (!node) return;
+  switch (node->getKind()) {
+    case NodeKind::Port:
+      return this->visit(*static_cast<Port *>(node.get()));
+    case NodeKind::StringPort:
+      return this->visit(*static_cast<StringPort *>(node.get()));
+    default:
+      break;
+  }
+  throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
+}
+
+void MutatingVisitor::visit(Port &node) { this->visit(node.value); }
+
+void MutatingVisitor::visit(StringPort &) {}
+
+void MutatingVisitor::visit(std::unique_ptr<StructuralStatement> &node) {
+  if (!node) return;
+  switch (node->getKind()) {
+    case NodeKind::ModuleInstantiation:
+      return this->visit(*static_cast<ModuleInstantiation *>(node.get()));
+    case NodeKind::ContinuousAssign:
+      return this->visit(*static_cast<ContinuousAssign *>(node.get()));
+    case NodeKind::Always:
+      return this->visit(*static_cast<Always *>(node.get()));
+    case NodeKind::SingleLineComment:
+      return this->visit(*static_cast<SingleLineComment *>(node.get()));
+    case NodeKind::BlockComment:
+      return this->visit(*static_cast<BlockComment *>(node.get()));
+    case NodeKind::InlineVerilog:
+      return this->visit(*static_cast<InlineVerilog *>(node.get()));
+    case NodeKind::IfMacro:
+    case NodeKind::IfDef:
+    case NodeKind::IfNDef:
+      return this->visit(*static_cast<IfMacro *>(node.get()));
+    case NodeKind::StructuralStatement:
+      // Statements defined outside this library
+      return;
+    default:
+      break;
+  }
+  throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
+}
+
+void MutatingVisitor::visit(std::unique_ptr<Declaration> &node) {
+  if (!node) return;
+  switch (node->getKind()) {
+    case NodeKind::Wire:
+      return this->visit(*static_cast<Wire *>(node.get()));
+    case NodeKind::Reg:
+      return this->visit(*static_cast<Reg *>(node.get()));
+    default:
+      break;
+  }
+  throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
+}
+
+void MutatingVisitor::visit(std::unique_ptr<BehavioralStatement> &node) {
+  if (!node) return;
+  switch (node->getKind()) {
+    case NodeKind::BlockingAssign:
+      return this->visit(*static_cast<BlockingAssign *>(node.get()));
+    case NodeKind::NonBlockingAssign:
+      return this->visit(*static_cast<NonBlockingAssign *>(node.get()));
+    case NodeKind::CallStmt:
+      return this->visit(*static_cast<CallStmt *>(node.get()));
+    case NodeKind::SingleLineComment:
+      return this->visit(*static_cast<SingleLineComment *>(node.get()));
+    case NodeKind::BlockComment:
+      return this->visit(*static_cast<BlockComment *>(node.get()));
+    case NodeKind::If:
+      return this->visit(*static_cast<If *>(node.get()));
+    case NodeKind::BehavioralStatement:
+      // Statements defined outside this library
+      return;
+    default:
+      break;
+  }
+  throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
+}
+
+void MutatingVisitor::visit(SingleLineComment &) {}
+
+void MutatingVisitor::visit(BlockComment &) {}
+
+void MutatingVisitor::visit(InlineVerilog &) {}
+
+void MutatingVisitor::visit(IfMacro &node) {
+  for (auto &item : node.true_body) this->visit(item);
+  for (auto &item : node.else_body) this->visit(item);
+}
+
+void MutatingVisitor::visit(ModuleInstantiation &node) {
+  for (auto &conn : *node.connections) this->visit(conn.second);
+  for (auto &param : node.parameters) {
+    this->visit(param.first);
+    this->visit(param.second);
+  }
+}
+
+void MutatingVisitor::visit(Wire &node) { this->visit(node.value); }
+
+void MutatingVisitor::visit(Reg &node) { this->visit(node.value); }
+
+void MutatingVisitor::visit(ContinuousAssign &node) {
+  this->visit(node.target);
+  this->visit(node.value);
+}
+
+void MutatingVisitor::visit(BlockingAssign &node) {
+  this->visit(node.target);
+  this->visit(node.value);
+}
+
+void MutatingVisitor::visit(NonBlockingAssign &node) {
+  this->visit(node.target);
+  this->visit(node.value);
+}
+
+void MutatingVisitor::visit(CallStmt &node) {
+  for (auto &arg : node.args) this->visit(arg);
+}
+
+void MutatingVisitor::visit(If &node) {
+  this->visit(node.cond);
+  for (auto &item : node.true_body) this->visit(item);
+  for (auto &item : node.else_ifs) {
+    this->visit(item.first);
+    for (auto &inner_statement : item.second) this->visit(inner_statement);
+  }
+  for (auto &item : node.else_body) this->visit(item);
+}
+
+void MutatingVisitor::visit(Always &node) {
+  for (auto &item : node.sensitivity_list) this->visit(item);
+  for (auto &item : node.body) this->visit(item);
+}
+
+void MutatingVisitor::visit(std::unique_ptr<AbstractModule> &node) {
+  if (!node) return;
+  switch (node->getKind()) {
+    case NodeKind::StringBodyModule:
+      return this->visit(*static_cast<StringBodyModule *>(node.get()));
+    case NodeKind::Module:
+      return this->visit(*static_cast<Module *>(node.get()));
+    case NodeKind::StringModule:
+      return this->visit(*static_cast<StringModule *>(node.get()));
+    default:
+      break;
+  }
+  throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
+}
+
+void MutatingVisitor::visit(Module &node) {
+  for (auto &item : node.ports) this->visit(item);
+  for (auto &param : node.parameters) {
+    this->visit(param.first);
+    this->visit(param.second);
+  }
+  for (auto &item : node.body) this->visit(item);
+}
+
+void MutatingVisitor::visit(StringBodyModule &node) {
+  for (auto &item : node.ports) this->visit(item);
+  for (auto &param : node.parameters) {
+    this->visit(param.first);
+    this->visit(param.second);
+  }
+}
+
+void MutatingVisitor::visit(StringModule &) {}
+
+void MutatingVisitor::visit(File &node) {
+  for (auto &item : node.modules) this->visit(item);
+}
+
+}  // namespace verilogAST
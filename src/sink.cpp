@@ -0,0 +1,74 @@
+#include "verilogAST/sink.hpp"
+
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+namespace verilogAST {
+
+void Sink::write_indented(const char* data, std::size_t size) {
+  static const char spaces[] = "                                ";
+  const char* end = data + size;
+  while (data < end) {
+    if (this->at_line_start) {
+      std::size_t width = 4 * this->indent_level;
+      while (width > 0) {
+        std::size_t chunk = std::min(width, sizeof(spaces) - 1);
+        this->put(spaces, chunk);
+        width -= chunk;
+      }
+      this->at_line_start = false;
+    }
+    auto newline =
+        static_cast<const char*>(std::memchr(data, '\n', end - data));
+    const char* stop = newline ? newline + 1 : end;
+    this->put(data, stop - data);
+    this->at_line_start = newline != nullptr;
+    data = stop;
+  }
+}
+
+void FdSink::drain(const char* data, std::size_t size) {
+  while (size > 0) {
+    ssize_t written = ::write(this->fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      throw std::runtime_error(std::string("vAST::FdSink write failed: ") +
+                               std::strerror(errno));
+    }
+    data += written;
+    size -= written;
+  }
+}
+
+void FdSink::put(const char* data, std::size_t size) {
+  if (this->used + size > this->buffer.size()) {
+    this->flush();
+    if (size >= this->buffer.size()) {
+      // Too large to buffer, write through
+      this->drain(data, size);
+      return;
+    }
+  }
+  std::memcpy(this->buffer.data() + this->used, data, size);
+  this->used += size;
+}
+
+void FdSink::flush() {
+  std::size_t size = this->used;
+  // Reset first so a failed write does not get retried from the destructor
+  this->used = 0;
+  this->drain(this->buffer.data(), size);
+}
+
+FdSink::~FdSink() {
+  try {
+    this->flush();
+  } catch (const std::runtime_error&) {
+    // Destructors must not throw, callers that care should flush() explicitly
+  }
+}
+
+}  // namespace verilogAST
@@ -0,0 +1,73 @@
+#include "verilogAST/symbol.hpp"
+#include "verilogAST.hpp"
+
+#include <mutex>
+#include <stdexcept>
+
+namespace verilogAST {
+
+namespace {
+
+thread_local SymbolTable* current_table = nullptr;
+
+}  // namespace
+
+Symbol::Symbol() {
+  static const Entry* empty = SymbolTable::global().intern("").entry;
+  this->entry = empty;
+}
+
+Symbol::Symbol(std::string_view str)
+    : entry(str.empty() ? Symbol().entry
+                        : SymbolTable::current().intern(str).entry) {}
+
+Symbol SymbolTable::intern(std::string_view str) {
+  {
+    std::shared_lock<std::shared_mutex> lock(this->mutex);
+    auto it = this->index.find(str);
+    if (it != this->index.end()) return Symbol(it->second);
+  }
+  bool needs_escape = Identifier::needsEscape(str);
+  std::unique_lock<std::shared_mutex> lock(this->mutex);
+  // Another thread may have inserted it in the meantime
+  auto it = this->index.find(str);
+  if (it != this->index.end()) return Symbol(it->second);
+  this->entries.push_back(
+      Symbol::Entry{std::string(str),
+                    static_cast<std::uint32_t>(this->entries.size()),
+                    needs_escape});
+  const Symbol::Entry* entry = &this->entries.back();
+  this->index.emplace(entry->str, entry);
+  return Symbol(entry);
+}
+
+Symbol SymbolTable::lookup(std::uint32_t id) const {
+  std::shared_lock<std::shared_mutex> lock(this->mutex);
+  if (id >= this->entries.size()) {
+    throw std::out_of_range("Unknown symbol id " + std::to_string(id));
+  }
+  return Symbol(&this->entries[id]);
+}
+
+std::size_t SymbolTable::size() const {
+  std::shared_lock<std::shared_mutex> lock(this->mutex);
+  return this->entries.size();
+}
+
+SymbolTable& SymbolTable::global() {
+  // Never destroyed, so symbols stay valid during static destruction
+  static SymbolTable* table = new SymbolTable();
+  return *table;
+}
+
+SymbolTable& SymbolTable::current() {
+  return current_table ? *current_table : SymbolTable::global();
+}
+
+SymbolTable::Scope::Scope(SymbolTable& table) : previous(current_table) {
+  current_table = &table;
+}
+
+SymbolTable::Scope::~Scope() { current_table = this->previous; }
+
+}  // namespace verilogAST
@@ -5,57 +5,41 @@ namespace verilogAST {
 
 std::unique_ptr<Expression> Transformer::visit(
     std::unique_ptr<Expression> node) {
-  if (auto ptr = dynamic_cast<NumericLiteral*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<NumericLiteral>(ptr));
-  }
-  if (auto ptr = dynamic_cast<Identifier*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<Identifier>(ptr));
-  }
-  if (auto ptr = dynamic_cast<Cast*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<Cast>(ptr));
-  }
-  if (auto ptr = dynamic_cast<Attribute*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<Attribute>(ptr));
-  }
-  if (auto ptr = dynamic_cast<String*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<String>(ptr));
-  }
-  if (auto ptr = dynamic_cast<Index*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<Index>(ptr));
-  }
-  if (auto ptr = dynamic_cast<Slice*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<Slice>(ptr));
-  }
-  if (auto ptr = dynamic_cast<BinaryOp*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<BinaryOp>(ptr));
-  }
-  if (auto ptr = dynamic_cast<UnaryOp*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<UnaryOp>(ptr));
-  }
-  if (auto ptr = dynamic_cast<TernaryOp*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<TernaryOp>(ptr));
-  }
-  if (auto ptr = dynamic_cast<Concat*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<Concat>(ptr));
-  }
-  if (auto ptr = dynamic_cast<Replicate*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<Replicate>(ptr));
-  }
-  if (auto ptr = dynamic_cast<CallExpr*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<CallExpr>(ptr));
+  if (!node) return node;
+  switch (node->getKind()) {
+    case NodeKind::NumericLiteral:
+      return this->visit(unique_cast<NumericLiteral>(std::move(node)));
+    case NodeKind::Identifier:
+      return this->visit(unique_cast<Identifier>(std::move(node)));
+    case NodeKind::Cast:
+      return this->visit(unique_cast<Cast>(std::move(node)));
+    case NodeKind::Attribute:
+      return this->visit(unique_cast<Attribute>(std::move(node)));
+    case NodeKind::String:
+      return this->visit(unique_cast<String>(std::move(node)));
+    case NodeKind::Index:
+      return this->visit(unique_cast<Index>(std::move(node)));
+    case NodeKind::Slice:
+      return this->visit(unique_cast<Slice>(std::move(node)));
+    case NodeKind::BinaryOp:
+      return this->visit(unique_cast<BinaryOp>(std::move(node)));
+    case NodeKind::UnaryOp:
+      return this->visit(unique_cast<UnaryOp>(std::move(node)));
+    case NodeKind::TernaryOp:
+      return this->visit(unique_cast<TernaryOp>(std::move(node)));
+    case NodeKind::Concat:
+      return this->visit(unique_cast<Concat>(std::move(node)));
+    case NodeKind::Replicate:
+      return this->visit(unique_cast<Replicate>(std::move(node)));
+    case NodeKind::CallExpr:
+      return this->visit(unique_cast<CallExpr>(std::move(node)));
+    case NodeKind::SharedExpr:
+      return this->visit(unique_cast<SharedExpr>(std::move(node)));
+    case NodeKind::Expression:
+      // Expression subclasses defined outside this library
+      return node;
+    default:
+      break;
   }
   throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
   return node;                              // LCOV_EXCL_LINE
@@ -73,11 +57,13 @@ std::unique_ptr<Identifier> Transformer::visit(
 
 std::unique_ptr<Cast> Transformer::visit(std::unique_ptr<Cast> node) {
   node->expr = this->visit(std::move(node->expr));
+  node->invalidateHash();
   return node;
 }
 
 std::unique_ptr<Attribute> Transformer::visit(std::unique_ptr<Attribute> node) {
   node->value = this->visit(std::move(node->value));
+  node->invalidateHash();
   return node;
 }
 
@@ -88,6 +74,7 @@ std::unique_ptr<String> Transformer::visit(std::unique_ptr<String> node) {
 std::unique_ptr<Index> Transformer::visit(std::unique_ptr<Index> node) {
   node->value = this->visit(std::move(node->value));
   node->index = this->visit(std::move(node->index));
+  node->invalidateHash();
   return node;
 }
 
@@ -95,17 +82,20 @@ std::unique_ptr<Slice> Transformer::visit(std::unique_ptr<Slice> node) {
   node->expr = this->visit(std::move(node->expr));
   node->high_index = this->visit(std::move(node->high_index));
   node->low_index = this->visit(std::move(node->low_index));
+  node->invalidateHash();
   return node;
 }
 
 std::unique_ptr<BinaryOp> Transformer::visit(std::unique_ptr<BinaryOp> node) {
   node->left = this->visit(std::move(node->left));
   node->right = this->visit(std::move(node->right));
+  node->invalidateHash();
   return node;
 }
 
 std::unique_ptr<UnaryOp> Transformer::visit(std::unique_ptr<UnaryOp> node) {
   node->operand = this->visit(std::move(node->operand));
+  node->invalidateHash();
   return node;
 }
 
@@ -113,6 +103,7 @@ std::unique_ptr<TernaryOp> Transformer::visit(std::unique_ptr<TernaryOp> node) {
   node->cond = this->visit(std::move(node->cond));
   node->true_value = this->visit(std::move(node->true_value));
   node->false_value = this->visit(std::move(node->false_value));
+  node->invalidateHash();
   return node;
 }
 
@@ -122,12 +113,14 @@ std::unique_ptr<Concat> Transformer::visit(std::unique_ptr<Concat> node) {
     new_args.push_back(this->visit(std::move(expr)));
   }
   node->args = std::move(new_args);
+  node->invalidateHash();
   return node;
 }
 
 std::unique_ptr<Replicate> Transformer::visit(std::unique_ptr<Replicate> node) {
   node->num = this->visit(std::move(node->num));
   node->value = this->visit(std::move(node->value));
+  node->invalidateHash();
   return node;
 }
 
@@ -147,25 +140,48 @@ std::unique_ptr<CallExpr> Transformer::visit(std::unique_ptr<CallExpr> node) {
     new_args.push_back(this->visit(std::move(expr)));
   }
   node->args = std::move(new_args);
+  node->invalidateHash();
   return node;
 }
 
+std::unique_ptr<Expression> Transformer::visit(
+    std::unique_ptr<SharedExpr> node) {
+  if (this->memoize_shared) {
+    auto it = this->shared_results.find(node->value.get());
+    if (it != this->shared_results.end()) {
+      if (it->second.second == node->value) return node;
+      return std::make_unique<SharedExpr>(it->second.second);
+    }
+  }
+  std::unique_ptr<Expression> result = this->visit(node->materialize());
+  // Children left unchanged are still references to the same expressions, so
+  // this only compares the top level
+  bool unchanged = result->structurallyEqual(*node->value);
+  if (!this->memoize_shared) {
+    if (unchanged) return node;
+    return result;
+  }
+  std::shared_ptr<const Expression> shared;
+  if (unchanged) {
+    shared = node->value;
+  } else if (auto ptr = dyn_cast<SharedExpr>(result.get())) {
+    shared = ptr->value;
+  } else {
+    shared = std::move(result);
+  }
+  this->shared_results.emplace(node->value.get(),
+                               std::make_pair(node->value, shared));
+  if (unchanged) return node;
+  return std::make_unique<SharedExpr>(std::move(shared));
+}
+
 std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Vector>>
 Transformer::visit(
     std::variant<std::unique_ptr<Identifier>, std::unique_ptr<Vector>> node) {
   return std::visit(
       [&](auto&& value) -> std::variant<std::unique_ptr<Identifier>,
                                         std::unique_ptr<Vector>> {
-        if (auto ptr = dynamic_cast<Identifier*>(value.get())) {
-          value.release();
-          return this->visit(std::unique_ptr<Identifier>(ptr));
-        }
-        if (auto ptr = dynamic_cast<Vector*>(value.get())) {
-          value.release();
-          return this->visit(std::unique_ptr<Vector>(ptr));
-        }
-        throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
-        return std::move(value);                  // LCOV_EXCL_LINE
+        return this->visit(std::move(value));
       },
       node);
 }
@@ -174,7 +190,7 @@ std::unique_ptr<Vector> Transformer::visit(std::unique_ptr<Vector> node) {
   node->id = this->visit(std::move(node->id));
   node->msb = this->visit(std::move(node->msb));
   node->lsb = this->visit(std::move(node->lsb));
-  if (auto ptr = dynamic_cast<NDVector*>(node.get())) {
+  if (auto ptr = dyn_cast<NDVector>(node.get())) {
     std::vector<
         std::pair<std::unique_ptr<Expression>, std::unique_ptr<Expression>>>
         new_outer_dims;
@@ -292,13 +308,14 @@ std::unique_ptr<ContinuousAssign> Transformer::visit(
 
 std::unique_ptr<Declaration> Transformer::visit(
     std::unique_ptr<Declaration> node) {
-  if (auto ptr = dynamic_cast<Wire*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<Wire>(ptr));
-  }
-  if (auto ptr = dynamic_cast<Reg*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<Reg>(ptr));
+  if (!node) return node;
+  switch (node->getKind()) {
+    case NodeKind::Wire:
+      return this->visit(unique_cast<Wire>(std::move(node)));
+    case NodeKind::Reg:
+      return this->visit(unique_cast<Reg>(std::move(node)));
+    default:
+      break;
   }
   throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
   return node;                              // LCOV_EXCL_LINE
@@ -306,29 +323,25 @@ std::unique_ptr<Declaration> Transformer::visit(
 
 std::unique_ptr<BehavioralStatement> Transformer::visit(
     std::unique_ptr<BehavioralStatement> node) {
-  if (auto ptr = dynamic_cast<BlockingAssign*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<BlockingAssign>(ptr));
-  }
-  if (auto ptr = dynamic_cast<NonBlockingAssign*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<NonBlockingAssign>(ptr));
-  }
-  if (auto ptr = dynamic_cast<CallStmt*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<CallStmt>(ptr));
-  }
-  if (auto ptr = dynamic_cast<SingleLineComment*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<SingleLineComment>(ptr));
-  }
-  if (auto ptr = dynamic_cast<BlockComment*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<BlockComment>(ptr));
-  }
-  if (auto ptr = dynamic_cast<If*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<If>(ptr));
+  if (!node) return node;
+  switch (node->getKind()) {
+    case NodeKind::BlockingAssign:
+      return this->visit(unique_cast<BlockingAssign>(std::move(node)));
+    case NodeKind::NonBlockingAssign:
+      return this->visit(unique_cast<NonBlockingAssign>(std::move(node)));
+    case NodeKind::CallStmt:
+      return this->visit(unique_cast<CallStmt>(std::move(node)));
+    case NodeKind::SingleLineComment:
+      return this->visit(unique_cast<SingleLineComment>(std::move(node)));
+    case NodeKind::BlockComment:
+      return this->visit(unique_cast<BlockComment>(std::move(node)));
+    case NodeKind::If:
+      return this->visit(unique_cast<If>(std::move(node)));
+    case NodeKind::BehavioralStatement:
+      // Statements defined outside this library
+      return node;
+    default:
+      break;
   }
   throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
   return node;                              // LCOV_EXCL_LINE
@@ -380,13 +393,14 @@ std::unique_ptr<Always> Transformer::visit(std::unique_ptr<Always> node) {
 
 std::unique_ptr<AbstractPort> Transformer::visit(
     std::unique_ptr<AbstractPort> node) {
-  if (auto ptr = dynamic_cast<Port*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<Port>(ptr));
-  }
-  if (auto ptr = dynamic_cast<StringPort*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<StringPort>(ptr));
+  if (!node) return node;
+  switch (node->getKind()) {
+    case NodeKind::Port:
+      return this->visit(unique_cast<Port>(std::move(node)));
+    case NodeKind::StringPort:
+      return this->visit(unique_cast<StringPort>(std::move(node)));
+    default:
+      break;
   }
   throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
   return node;                              // LCOV_EXCL_LINE
@@ -394,33 +408,29 @@ std::unique_ptr<AbstractPort> Transformer::visit(
 
 std::unique_ptr<StructuralStatement> Transformer::visit(
     std::unique_ptr<StructuralStatement> node) {
-  if (auto ptr = dynamic_cast<ModuleInstantiation*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<ModuleInstantiation>(ptr));
-  }
-  if (auto ptr = dynamic_cast<ContinuousAssign*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<ContinuousAssign>(ptr));
-  }
-  if (auto ptr = dynamic_cast<Always*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<Always>(ptr));
-  }
-  if (auto ptr = dynamic_cast<SingleLineComment*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<SingleLineComment>(ptr));
-  }
-  if (auto ptr = dynamic_cast<BlockComment*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<BlockComment>(ptr));
-  }
-  if (auto ptr = dynamic_cast<InlineVerilog*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<InlineVerilog>(ptr));
-  }
-  if (auto ptr = dynamic_cast<IfMacro*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<IfMacro>(ptr));
+  if (!node) return node;
+  switch (node->getKind()) {
+    case NodeKind::ModuleInstantiation:
+      return this->visit(unique_cast<ModuleInstantiation>(std::move(node)));
+    case NodeKind::ContinuousAssign:
+      return this->visit(unique_cast<ContinuousAssign>(std::move(node)));
+    case NodeKind::Always:
+      return this->visit(unique_cast<Always>(std::move(node)));
+    case NodeKind::SingleLineComment:
+      return this->visit(unique_cast<SingleLineComment>(std::move(node)));
+    case NodeKind::BlockComment:
+      return this->visit(unique_cast<BlockComment>(std::move(node)));
+    case NodeKind::InlineVerilog:
+      return this->visit(unique_cast<InlineVerilog>(std::move(node)));
+    case NodeKind::IfMacro:
+    case NodeKind::IfDef:
+    case NodeKind::IfNDef:
+      return this->visit(unique_cast<IfMacro>(std::move(node)));
+    case NodeKind::StructuralStatement:
+      // Statements defined outside this library
+      return node;
+    default:
+      break;
   }
   throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
   return node;                              // LCOV_EXCL_LINE
@@ -467,17 +477,16 @@ std::unique_ptr<StringModule> Transformer::visit(
 
 std::unique_ptr<AbstractModule> Transformer::visit(
     std::unique_ptr<AbstractModule> node) {
-  if (auto ptr = dynamic_cast<StringBodyModule*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<StringBodyModule>(ptr));
-  }
-  if (auto ptr = dynamic_cast<Module*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<Module>(ptr));
-  }
-  if (auto ptr = dynamic_cast<StringModule*>(node.get())) {
-    node.release();
-    return this->visit(std::unique_ptr<StringModule>(ptr));
+  if (!node) return node;
+  switch (node->getKind()) {
+    case NodeKind::StringBodyModule:
+      return this->visit(unique_cast<StringBodyModule>(std::move(node)));
+    case NodeKind::Module:
+      return this->visit(unique_cast<Module>(std::move(node)));
+    case NodeKind::StringModule:
+      return this->visit(unique_cast<StringModule>(std::move(node)));
+    default:
+      break;
   }
   throw std::runtime_error("Unreachable");  // LCOV_EXCL_LINE
   return node;                              // LCOV_EXCL_LINE
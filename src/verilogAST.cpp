@@ -1,46 +1,106 @@
 #include "verilogAST.hpp"
 
-#include <regex>
-#include <sstream>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <string_view>
+#include <type_traits>
 #include <unordered_set>
 
 template <typename... Ts>
-std::string variant_to_string(std::variant<Ts...> &value) {
-  return std::visit(
-      [](auto &&value) -> std::string { return value->toString(); }, value);
+void emit_variant(verilogAST::Sink &sink, const std::variant<Ts...> &value) {
+  std::visit([&](auto &&value) { value->emit(sink); }, value);
 }
 
-// Helper function to join a vector of strings with a specified separator ala
-// Python's ",".join(...)
-std::string join(std::vector<std::string> vec, std::string separator) {
-  std::string result;
-  for (size_t i = 0; i < vec.size(); i++) {
-    if (i > 0) result += separator;
-    result += vec[i];
+// Helper function to emit a container with a specified separator between
+// elements ala Python's ",".join(...)
+template <typename Container, typename Fn>
+void emit_joined(verilogAST::Sink &sink, const Container &container,
+                 std::string_view separator, Fn emit_element) {
+  bool first = true;
+  for (auto &element : container) {
+    if (!first) sink << separator;
+    first = false;
+    emit_element(element);
   }
-  return result;
 }
 
 namespace verilogAST {
 
-std::string expr_to_string_with_parens(std::unique_ptr<Expression> &expr) {
+std::string Node::toString() const {
+  std::string result;
+  StringSink sink(result);
+  this->emit(sink);
+  return result;
+}
+
+void emit_expr_with_parens(Sink &sink,
+                           const std::unique_ptr<Expression> &expr) {
   // FIXME: For now we just do naive precedence logic
-  std::string expr_str = expr->toString();
-  if (dynamic_cast<Identifier *>(expr.get())) {
-  } else if (dynamic_cast<NumericLiteral *>(expr.get())) {
-  } else if (dynamic_cast<Index *>(expr.get())) {
-  } else if (dynamic_cast<Slice *>(expr.get())) {
-  } else if (dynamic_cast<Attribute *>(expr.get())) {
-  } else {
-    expr_str = "(" + expr_str + ")";
+  switch (strip_shared(expr.get())->getKind()) {
+    case NodeKind::Identifier:
+    case NodeKind::NumericLiteral:
+    case NodeKind::Index:
+    case NodeKind::Slice:
+    case NodeKind::Attribute:
+      expr->emit(sink);
+      break;
+    default:
+      sink << '(';
+      expr->emit(sink);
+      sink << ')';
   }
-  return expr_str;
 }
 
-std::string NumericLiteral::toString() {
-  std::string signed_str = _signed ? "s" : "";
+namespace {
+
+unsigned int radix_base(Radix radix) {
+  switch (radix) {
+    case BINARY:
+      return 2;
+    case OCTAL:
+      return 8;
+    case HEX:
+      return 16;
+    case DECIMAL:
+      return 10;
+  }
+  return 10;  // LCOV_EXCL_LINE
+}
+
+}  // namespace
+
+NumericLiteral::NumericLiteral(BitVector bits, Radix radix, bool _signed)
+    : Expression(NodeKind::NumericLiteral),
+      bits(std::move(bits)),
+      value(this->bits->toString(radix_base(radix))),
+      size(this->bits->width()),
+      _signed(_signed),
+      radix(radix) {}
 
-  std::string radix_str;
+void NumericLiteral::emit(Sink &sink) const {
+  bool emit_size = size != 32 || always_codegen_size;
+  Radix radix = this->radix;
+  std::string digits;
+  if (sink.getOptions().shortest_literals && this->bits &&
+      (emit_size || radix != DECIMAL)) {
+    // Unsized decimal literals are signed integers, so those are never
+    // re-encoded
+    digits = this->bits->toString(radix_base(radix));
+    for (Radix candidate : {HEX, DECIMAL, OCTAL, BINARY}) {
+      std::string encoded = this->bits->toString(radix_base(candidate));
+      if (encoded.size() < digits.size()) {
+        radix = candidate;
+        digits = std::move(encoded);
+      }
+    }
+  }
+  std::string_view radix_str;
   switch (radix) {
     case BINARY:
       radix_str = "b";
@@ -55,122 +115,246 @@ std::string NumericLiteral::toString() {
       radix_str = "";
       break;
   }
-  std::string size_str = std::to_string(size);
-  if (size_str == "32" && !always_codegen_size) {
-    size_str = "";
-  }
-  if (size_str != "" && radix_str == "") {
-    // verilator needs decimal explicitly
+  if ((emit_size || radix != this->radix) && radix_str.empty()) {
+    // verilator needs decimal explicitly, and a based literal must stay based
     radix_str = "d";
   }
 
-  std::string separator = "";
-  if (size_str + signed_str + radix_str != "") {
-    separator = "'";
-  }
-  return size_str + separator + signed_str + radix_str + value;
-}
-
-Identifier::Identifier(std::string value) {
-  static std::unordered_set<std::string> sKeywords{
-      // clang-format off
-      "accept_on",     "dist",          "local",                "randomize",       "task",
-      "alias",         "do",            "localparam",           "randsequence",    "this",
-      "always",        "edge",          "logic",                "rcmos",           "time",
-      "always_comb",   "else",          "longint",              "real",            "timeprecision",
-      "always_ff",     "end",           "macromodule",          "realtime",        "timeunit",
-      "always_latch",  "enum",          "matches",              "ref",             "tran",
-      "and",           "event",         "modport",              "reg",             "tranif0",
-      "assert",        "eventually",    "module",               "reject_on",       "tranif1",
-      "assign",        "expect",        "nand",                 "release",         "tri",
-      "assume",        "export",        "negedge",              "repeat",          "tri0",
-      "automatic",     "extends",       "nettype",              "restrict",        "tri1",
-      "begin",         "extern",        "new",                  "return",          "triand",
-      "bind",          "final",         "nexttime",             "rnmos",           "trior",
-      "bins",          "first_match",   "nmos",                 "rpmos",           "trireg",
-      "binsof",        "for",           "nor",                  "rtran",           "type",
-      "bit",           "force",         "noshowcancelled",      "rtranif0",        "type_option",
-      "break",         "foreach",       "not",                  "rtranif1",        "typedef",
-      "buf",           "forever",       "notif0",               "s_always",        "union",
-      "bufif0",        "fork",          "notif1",               "s_eventually",    "unique",
-      "bufif1",        "function",      "null",                 "s_nexttime",      "unique0",
-      "byte",          "generate",      "option",               "scalared",        "unsigned",
-      "case",          "genvar",        "or",                   "sequence",        "untyped",
-      "casex",         "global",        "output",               "shortint",        "use",
-      "casez",         "if",            "package",              "shortreal",       "uwire",
-      "cell",          "iff",           "packed",               "showcancelled",   "var",
-      "chandle",       "ifnone",        "parameter",            "signed",          "vectored",
-      "checker",       "ignore_bins",   "pmos",                 "soft",            "virtual",
-      "class",         "illegal_bins",  "posedge",              "solve",           "void",
-      "clocking",      "implements",    "primitive",            "specify",         "wait",
-      "cmos",          "import",        "priority",             "specparam",       "wait_order",
-      "config",        "initial",       "program",              "static",          "wand",
-      "const",         "inout",         "property",             "std",             "weak",
-      "constraint",    "input",         "property_expr",        "string",          "weak0",
-      "context",       "instance",      "protected",            "strong",          "weak1",
-      "continue",      "int",           "pull0",                "strong0",         "while",
-      "cover",         "integer",       "pull1",                "strong1",         "wildcard",
-      "covergroup",    "interconnect",  "pulldown",             "struct",          "wire",
-      "coverpoint",    "interface",     "pullup",               "super",           "with",
-      "cross",         "intersect",     "pulsestyle_ondetect",  "supply0",         "wor",
-      "deassign",      "join",          "pulsestyle_onevent",   "supply1",         "xnor",
-      "default",       "join_any",      "pure",                 "sync_accept_on",  "xor",
-      "defparam",      "join_none",     "rand",                 "sync_reject_on",
-      "design",        "let",           "randc",                "table",
-      "disable",       "liblist",       "randcase",             "tagged",
-      // clang-format on
-  };
-  static std::regex sSimpleIdentifierRE{"^[a-zA-Z$_][a-zA-Z$_0-9]*$"};
-  if (sKeywords.count(value) || !std::regex_match(value, sSimpleIdentifierRE)) {
-    value = "\\" + value + " ";
+  if (emit_size) sink << size;
+  if (emit_size || _signed || !radix_str.empty()) sink << '\'';
+  if (_signed) sink << 's';
+  sink << radix_str;
+  if (digits.empty()) {
+    sink << value;
+  } else {
+    sink << digits;
   }
-  this->value = value;
 }
 
-std::string Identifier::toString() { return this->value; }
+void NumericLiteral::setValue(std::string value) {
+  this->value = std::move(value);
+  this->reparse();
+}
+
+void NumericLiteral::setSize(unsigned int size) {
+  this->size = size;
+  this->reparse();
+}
 
-std::string Cast::toString() {
-  return std::to_string(this->width) + "'(" + this->expr->toString() + ")";
+void NumericLiteral::setRadix(Radix radix) {
+  if (this->bits) this->value = this->bits->toString(radix_base(radix));
+  this->radix = radix;
 }
 
-std::string Attribute::toString() {
-  return variant_to_string(this->value) + "." + this->attr;
+void NumericLiteral::reparse() {
+  bool is_sized = this->size != 32 || this->always_codegen_size;
+  // Every digit is at most 4 bits, so this holds the whole value
+  unsigned int width =
+      std::max<std::size_t>(this->size, 4 * this->value.size());
+  this->bits = BitVector::parse(this->value, radix_base(this->radix), width);
+  if (!this->bits) return;
+  // Sized literals are truncated, unsized ones are at least 32 bits wide
+  this->bits->resize(is_sized ? this->size
+                              : std::max(32u, this->bits->activeBits()));
 }
 
-std::string String::toString() { return "\"" + value + "\""; }
+namespace {
+
+// SystemVerilog keywords (IEEE 1800-2017 Annex B), these are escaped when used
+// as identifiers
+constexpr std::string_view sKeywords[] = {
+    // clang-format off
+    "accept_on",     "dist",          "local",                "randomize",       "task",
+    "alias",         "do",            "localparam",           "randsequence",    "this",
+    "always",        "edge",          "logic",                "rcmos",           "time",
+    "always_comb",   "else",          "longint",              "real",            "timeprecision",
+    "always_ff",     "end",           "macromodule",          "realtime",        "timeunit",
+    "always_latch",  "enum",          "matches",              "ref",             "tran",
+    "and",           "event",         "modport",              "reg",             "tranif0",
+    "assert",        "eventually",    "module",               "reject_on",       "tranif1",
+    "assign",        "expect",        "nand",                 "release",         "tri",
+    "assume",        "export",        "negedge",              "repeat",          "tri0",
+    "automatic",     "extends",       "nettype",              "restrict",        "tri1",
+    "begin",         "extern",        "new",                  "return",          "triand",
+    "bind",          "final",         "nexttime",             "rnmos",           "trior",
+    "bins",          "first_match",   "nmos",                 "rpmos",           "trireg",
+    "binsof",        "for",           "nor",                  "rtran",           "type",
+    "bit",           "force",         "noshowcancelled",      "rtranif0",        "type_option",
+    "break",         "foreach",       "not",                  "rtranif1",        "typedef",
+    "buf",           "forever",       "notif0",               "s_always",        "union",
+    "bufif0",        "fork",          "notif1",               "s_eventually",    "unique",
+    "bufif1",        "function",      "null",                 "s_nexttime",      "unique0",
+    "byte",          "generate",      "option",               "scalared",        "unsigned",
+    "case",          "genvar",        "or",                   "sequence",        "untyped",
+    "casex",         "global",        "output",               "shortint",        "use",
+    "casez",         "if",            "package",              "shortreal",       "uwire",
+    "cell",          "iff",           "packed",               "showcancelled",   "var",
+    "chandle",       "ifnone",        "parameter",            "signed",          "vectored",
+    "checker",       "ignore_bins",   "pmos",                 "soft",            "virtual",
+    "class",         "illegal_bins",  "posedge",              "solve",           "void",
+    "clocking",      "implements",    "primitive",            "specify",         "wait",
+    "cmos",          "import",        "priority",             "specparam",       "wait_order",
+    "config",        "initial",       "program",              "static",          "wand",
+    "const",         "inout",         "property",             "std",             "weak",
+    "constraint",    "input",         "property_expr",        "string",          "weak0",
+    "context",       "instance",      "protected",            "strong",          "weak1",
+    "continue",      "int",           "pull0",                "strong0",         "while",
+    "cover",         "integer",       "pull1",                "strong1",         "wildcard",
+    "covergroup",    "interconnect",  "pulldown",             "struct",          "wire",
+    "coverpoint",    "interface",     "pullup",               "super",           "with",
+    "cross",         "intersect",     "pulsestyle_ondetect",  "supply0",         "wor",
+    "deassign",      "join",          "pulsestyle_onevent",   "supply1",         "xnor",
+    "default",       "join_any",      "pure",                 "sync_accept_on",  "xor",
+    "defparam",      "join_none",     "rand",                 "sync_reject_on",
+    "design",        "let",           "randc",                "table",
+    "disable",       "liblist",       "randcase",             "tagged",
+    // clang-format on
+};
+
+constexpr std::size_t kMaxKeywordLength = [] {
+  std::size_t length = 0;
+  for (auto keyword : sKeywords) length = std::max(length, keyword.size());
+  return length;
+}();
 
-std::string Index::toString() {
-  return variant_to_string(value) + '[' + index->toString() + ']';
+constexpr std::uint32_t keyword_hash(std::string_view str) {
+  // FNV-1a
+  std::uint32_t hash = 2166136261u;
+  for (char c : str) hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+  return hash;
 }
 
-std::string Slice::toString() {
-  std::string expr_str = expr_to_string_with_parens(expr);
-  return expr_str + '[' + high_index->toString() + ':' + low_index->toString() +
-         ']';
+// Open addressing table of the keywords, built at compile time
+constexpr std::size_t kKeywordTableSize = 512;
+static_assert(std::size(sKeywords) * 2 <= kKeywordTableSize,
+              "keyword table too full");
+
+constexpr std::array<std::string_view, kKeywordTableSize> make_keyword_table() {
+  std::array<std::string_view, kKeywordTableSize> table{};
+  for (auto keyword : sKeywords) {
+    std::size_t i = keyword_hash(keyword) & (kKeywordTableSize - 1);
+    while (!table[i].empty()) i = (i + 1) & (kKeywordTableSize - 1);
+    table[i] = keyword;
+  }
+  return table;
 }
 
-std::string Vector::toString() {
-  return "[" + msb->toString() + ':' + lsb->toString() + "] " + id->toString();
+constexpr auto sKeywordTable = make_keyword_table();
+
+bool is_keyword(std::string_view name) {
+  if (name.size() > kMaxKeywordLength) return false;
+  std::size_t i = keyword_hash(name) & (kKeywordTableSize - 1);
+  while (!sKeywordTable[i].empty()) {
+    if (sKeywordTable[i] == name) return true;
+    i = (i + 1) & (kKeywordTableSize - 1);
+  }
+  return false;
 }
 
-std::string NDVector::toString() {
-  std::string s = Vector::toString() + " ";
-  for (auto &dim : outer_dims) {
-    s += "[" + dim.first->toString() + ":" + dim.second->toString() + "]";
+// Character classes of simple identifiers, [a-zA-Z$_][a-zA-Z$_0-9]*
+enum : std::uint8_t { kIdentifierStart = 1, kIdentifierPart = 2 };
+
+constexpr std::array<std::uint8_t, 256> make_char_classes() {
+  std::array<std::uint8_t, 256> classes{};
+  for (int c = 0; c < 256; c++) {
+    bool start = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                 c == '_' || c == '$';
+    bool digit = c >= '0' && c <= '9';
+    if (start) classes[c] |= kIdentifierStart;
+    if (start || digit) classes[c] |= kIdentifierPart;
   }
-  return s;
+  return classes;
 }
 
-std::string PackedNDVector::toString() {
-  std::string s = "";
+constexpr auto sCharClasses = make_char_classes();
+
+}  // namespace
+
+bool Identifier::needsEscape(std::string_view name) {
+  if (name.empty() ||
+      !(sCharClasses[static_cast<unsigned char>(name[0])] & kIdentifierStart)) {
+    return true;
+  }
+  for (char c : name.substr(1)) {
+    if (!(sCharClasses[static_cast<unsigned char>(c)] & kIdentifierPart)) {
+      return true;
+    }
+  }
+  return is_keyword(name);
+}
+
+void Identifier::emit(Sink &sink) const {
+  if (this->value.needsEscape()) {
+    sink << '\\' << this->value.str() << ' ';
+  } else {
+    sink << this->value.str();
+  }
+}
+
+void Cast::emit(Sink &sink) const {
+  sink << this->width << "'(";
+  this->expr->emit(sink);
+  sink << ')';
+}
+
+void Attribute::emit(Sink &sink) const {
+  emit_variant(sink, this->value);
+  sink << '.' << this->attr;
+}
+
+void String::emit(Sink &sink) const { sink << '"' << value << '"'; }
+
+void Index::emit(Sink &sink) const {
+  emit_variant(sink, value);
+  sink << '[';
+  index->emit(sink);
+  sink << ']';
+}
+
+void Slice::emit(Sink &sink) const {
+  emit_expr_with_parens(sink, expr);
+  sink << '[';
+  high_index->emit(sink);
+  sink << ':';
+  low_index->emit(sink);
+  sink << ']';
+}
+
+void Vector::emit(Sink &sink) const {
+  sink << '[';
+  msb->emit(sink);
+  sink << ':';
+  lsb->emit(sink);
+  sink << "] ";
+  id->emit(sink);
+}
+
+void emit_outer_dims(
+    Sink &sink,
+    const std::vector<std::pair<std::unique_ptr<Expression>,
+                          std::unique_ptr<Expression>>> &outer_dims) {
   for (auto &dim : outer_dims) {
-    s += "[" + dim.first->toString() + ":" + dim.second->toString() + "]";
+    sink << '[';
+    dim.first->emit(sink);
+    sink << ':';
+    dim.second->emit(sink);
+    sink << ']';
   }
-  return (s + Vector::toString());
 }
 
-std::string BinaryOp::toString() {
-  std::string op_str;
+void NDVector::emit(Sink &sink) const {
+  Vector::emit(sink);
+  sink << ' ';
+  emit_outer_dims(sink, outer_dims);
+}
+
+void PackedNDVector::emit(Sink &sink) const {
+  emit_outer_dims(sink, outer_dims);
+  Vector::emit(sink);
+}
+
+void BinaryOp::emit(Sink &sink) const {
+  std::string_view op_str;
   switch (op) {
     case BinOp::LSHIFT:
       op_str = "<<";
@@ -236,13 +420,13 @@ std::string BinaryOp::toString() {
       op_str = ">=";
       break;
   }
-  std::string lstr = expr_to_string_with_parens(left);
-  std::string rstr = expr_to_string_with_parens(right);
-  return lstr + ' ' + op_str + ' ' + rstr;
+  emit_expr_with_parens(sink, left);
+  sink << ' ' << op_str << ' ';
+  emit_expr_with_parens(sink, right);
 }
 
-std::string UnaryOp::toString() {
-  std::string op_str;
+void UnaryOp::emit(Sink &sink) const {
+  std::string_view op_str;
   switch (op) {
     case UnOp::NOT:
       op_str = "!";
@@ -278,241 +462,337 @@ std::string UnaryOp::toString() {
       op_str = "-";
       break;
   }
-  std::string operand_str = expr_to_string_with_parens(operand);
-  return op_str + ' ' + operand_str;
+  sink << op_str << ' ';
+  emit_expr_with_parens(sink, operand);
 }
 
-std::string TernaryOp::toString() {
-  return cond->toString() + " ? " + true_value->toString() + " : " +
-         false_value->toString();
+void TernaryOp::emit(Sink &sink) const {
+  cond->emit(sink);
+  sink << " ? ";
+  true_value->emit(sink);
+  sink << " : ";
+  false_value->emit(sink);
 }
 
-std::string Concat::toString() {
-  std::vector<std::string> arg_strs;
-  for (auto &arg : args) {
-    arg_strs.push_back(arg->toString());
-  }
-  std::string prefix = "";
+void Concat::emit(Sink &sink) const {
   if (this->unpacked) {
-    prefix = "'";
+    sink << '\'';
   }
-  return prefix + "{" + join(arg_strs, ",") + "}";
+  sink << '{';
+  emit_joined(sink, args, ",", [&](auto &arg) { arg->emit(sink); });
+  sink << '}';
 }
 
-std::string Replicate::toString() {
+void Replicate::emit(Sink &sink) const {
   // TODO: Insert parens using precedence logic
-  return "{(" + num->toString() + "){" + value->toString() + "}" + "}";
+  sink << "{(";
+  num->emit(sink);
+  sink << "){";
+  value->emit(sink);
+  sink << "}}";
 }
 
-std::string NegEdge::toString() { return "negedge " + value->toString(); }
+void NegEdge::emit(Sink &sink) const {
+  sink << "negedge ";
+  value->emit(sink);
+}
 
-std::string PosEdge::toString() { return "posedge " + value->toString(); }
+void PosEdge::emit(Sink &sink) const {
+  sink << "posedge ";
+  value->emit(sink);
+}
 
-std::string Call::toString() {
-  std::vector<std::string> arg_strs;
-  for (auto &arg : args) {
-    arg_strs.push_back(arg->toString());
-  }
-  return func + "(" + join(arg_strs, ", ") + ")";
+void Call::emit(Sink &sink) const {
+  sink << func << '(';
+  emit_joined(sink, args, ", ", [&](auto &arg) { arg->emit(sink); });
+  sink << ')';
 }
 
-std::string Port::toString() {
-  std::string value_str =
-      variant_to_string<std::unique_ptr<Identifier>, std::unique_ptr<Vector>>(
-          value);
-  std::string direction_str;
+void Port::emit(Sink &sink) const {
   switch (direction) {
     case INPUT:
-      direction_str = "input";
+      sink << "input ";
       break;
     case OUTPUT:
-      direction_str = "output";
+      sink << "output ";
       break;
     case INOUT:
-      direction_str = "inout";
+      sink << "inout ";
       break;
   }
 
-  std::string data_type_str;
   switch (data_type) {
     case WIRE:
-      data_type_str = "";
       break;
     case REG:
-      data_type_str = "reg ";
+      sink << "reg ";
       break;
   }
-  return direction_str + " " + data_type_str + value_str;
+  emit_variant(sink, value);
 }
 
-std::string Module::emitModuleHeader() {
-  std::string module_header_str = "module " + name;
+void Module::emitModuleHeader(Sink &sink) const {
+  sink << "module " << name;
 
   // emit parameter string
   if (!parameters.empty()) {
-    module_header_str += " #(\n    ";
-    std::vector<std::string> param_strs;
-    for (auto &it : parameters) {
-      param_strs.push_back("parameter " + variant_to_string(it.first) + " = " +
-                           it.second->toString());
-    }
-    module_header_str += join(param_strs, ",\n    ");
-    module_header_str += "\n)";
+    sink << " #(\n    ";
+    emit_joined(sink, parameters, ",\n    ", [&](auto &it) {
+      sink << "parameter ";
+      emit_variant(sink, it.first);
+      sink << " = ";
+      it.second->emit(sink);
+    });
+    sink << "\n)";
   }
 
   // emit port string
-  module_header_str += " (\n    ";
-  std::vector<std::string> ports_strs;
-  for (auto &it : ports) ports_strs.push_back(it->toString());
-  module_header_str += join(ports_strs, ",\n    ");
-  module_header_str += "\n);\n";
-  return module_header_str;
+  sink << " (\n    ";
+  emit_joined(sink, ports, ",\n    ", [&](auto &it) { it->emit(sink); });
+  sink << "\n);\n";
 }
 
-std::string Module::toString() {
-  std::string module_str = "";
-  module_str += emitModuleHeader();
+std::string Module::emitModuleHeader() const {
+  std::string result;
+  StringSink sink(result);
+  this->emitModuleHeader(sink);
+  return result;
+}
+
+void Module::emit(Sink &sink) const {
+  emitModuleHeader(sink);
 
   // emit body
   for (auto &statement : body) {
-    module_str += variant_to_string<std::unique_ptr<StructuralStatement>,
-                                    std::unique_ptr<Declaration>>(statement) +
-                  "\n";
+    emit_variant(sink, statement);
+    sink << '\n';
   }
 
-  module_str += "endmodule\n";
-  return module_str;
+  sink << "endmodule\n";
 }
 
-std::string StringBodyModule::toString() {
-  std::string module_str = "";
-  module_str += emitModuleHeader();
-  module_str += body;
-  module_str += "\nendmodule\n";
-  return module_str;
+void StringBodyModule::emit(Sink &sink) const {
+  emitModuleHeader(sink);
+  sink << body;
+  sink << "\nendmodule\n";
 }
 
-std::string ModuleInstantiation::toString() {
-  std::string module_inst_str = "";
-  module_inst_str += module_name;
+void ModuleInstantiation::emit(Sink &sink) const {
+  sink << module_name;
   if (!parameters.empty()) {
-    module_inst_str += " #(\n    ";
-    std::vector<std::string> param_strs;
-    for (auto &it : parameters) {
-      param_strs.push_back("." + variant_to_string(it.first) + "(" +
-                           it.second->toString() + ")");
-    }
-    module_inst_str += join(param_strs, ",\n    ");
-    module_inst_str += "\n)";
-  }
-  module_inst_str += " " + instance_name + " (\n    ";
-  if (!connections->empty()) {
-    std::vector<std::string> param_strs;
-    for (auto &it : *connections) {
-      param_strs.push_back("." + it.first + "(" + it.second->toString() + ")");
-    }
-    module_inst_str += join(param_strs, ",\n    ");
+    sink << " #(\n    ";
+    emit_joined(sink, parameters, ",\n    ", [&](auto &it) {
+      sink << '.';
+      emit_variant(sink, it.first);
+      sink << '(';
+      it.second->emit(sink);
+      sink << ')';
+    });
+    sink << "\n)";
   }
-  module_inst_str += "\n);";
-  return module_inst_str;
+  sink << ' ' << instance_name << " (\n    ";
+  emit_joined(sink, *connections, ",\n    ", [&](auto &it) {
+    sink << '.' << it.first << '(';
+    it.second->emit(sink);
+    sink << ')';
+  });
+  sink << "\n);";
 }
 
-std::string IfMacro::toString() {
-  std::string s = this->getMacroString();
-  s += this->condition_str + "\n";
+void IfMacro::emit(Sink &sink) const {
+  sink << this->getMacroString();
+  sink << this->condition_str << '\n';
   for (auto &statement : this->true_body) {
-    s += variant_to_string(statement) + "\n";
+    emit_variant(sink, statement);
+    sink << '\n';
   }
   if (this->else_body.size() > 0) {
-    s += "`else\n";
+    sink << "`else\n";
     for (auto &statement : this->else_body) {
-      s += variant_to_string(statement) + "\n";
+      emit_variant(sink, statement);
+      sink << '\n';
     }
   }
-  return s + "`endif";
+  sink << "`endif";
 }
 
-std::string Declaration::toString() {
-  return decl + " " + variant_to_string(value) + ";";
+void Declaration::emit(Sink &sink) const {
+  sink << decl << ' ';
+  emit_variant(sink, value);
+  sink << ';';
 }
 
-std::string Assign::toString() {
-  return prefix + variant_to_string(target) + " " + symbol + " " +
-         value->toString() + ";";
+void Assign::emit(Sink &sink) const {
+  sink << prefix;
+  emit_variant(sink, target);
+  sink << ' ' << symbol << ' ';
+  value->emit(sink);
+  sink << ';';
 }
 
-std::string Always::toString() {
-  std::string always_str = "";
-  always_str += "always @(";
+void Always::emit(Sink &sink) const {
+  sink << "always @(";
 
   // emit sensitivity string
-  std::vector<std::string> sensitivity_strs;
-  for (auto &it : sensitivity_list) {
-    sensitivity_strs.push_back(variant_to_string(it));
-  }
-  always_str += join(sensitivity_strs, ", ");
-  always_str += ") begin\n";
+  emit_joined(sink, sensitivity_list, ", ",
+              [&](auto &it) { emit_variant(sink, it); });
+  sink << ") begin\n";
 
   // emit body
   for (auto &statement : body) {
-    always_str += statement->toString() + "\n";
+    statement->emit(sink);
+    sink << '\n';
   }
 
-  always_str += "end\n";
-  return always_str;
+  sink << "end\n";
 }
 
-std::string add_tab(std::string block) {
-  // Indents each line by four spaces, adds an extra newline at the end
-  std::istringstream block_stream(block);
-  std::string new_block;
-  while (!block_stream.eof()) {
-    std::string line;
-    std::getline(block_stream, line);
-    new_block += "    " + line + "\n";
+void emit_indented_body(
+    Sink &sink, const std::vector<std::unique_ptr<BehavioralStatement>> &body) {
+  sink.indent();
+  for (auto &statement : body) {
+    statement->emit(sink);
+    sink << '\n';
   }
-  return new_block;
+  sink.dedent();
 }
 
-std::string If::toString() {
-  std::string if_str = "";
-  if_str += "if (";
-  if_str += this->cond->toString();
-  if_str += ") begin\n";
+void If::emit(Sink &sink) const {
+  sink << "if (";
+  this->cond->emit(sink);
+  sink << ") begin\n";
+  emit_indented_body(sink, this->true_body);
+  sink << "end";
 
-  for (auto &statement : this->true_body) {
-    if_str += add_tab(statement->toString());
+  for (auto &entry : this->else_ifs) {
+    sink << " else if (";
+    entry.first->emit(sink);
+    sink << ") begin\n";
+    emit_indented_body(sink, entry.second);
+    sink << "end";
   }
 
-  if_str += "end";
+  if (this->else_body.size()) {
+    sink << " else begin\n";
+    emit_indented_body(sink, this->else_body);
+    sink << "end";
+  }
+}
 
-  for (auto &entry : this->else_ifs) {
-    if_str += " else if (" + entry.first->toString() + ") begin\n";
-    for (auto &statement : entry.second) {
-      if_str += add_tab(statement->toString());
+void File::emit(Sink &sink) const {
+  emit_joined(sink, modules, "\n", [&](auto &module) { module->emit(sink); });
+}
+
+void File::emit(Sink &sink, unsigned int num_threads) const {
+  std::size_t num_modules = this->modules.size();
+  if (num_threads <= 1 || num_modules <= 1) return this->emit(sink);
+  num_threads = std::min<std::size_t>(num_threads, num_modules);
+
+  // Workers claim modules in order and render each into its own buffer, the
+  // calling thread writes the buffers to `sink` as soon as the next one in
+  // order is ready and releases it. Workers wait while `max_pending` modules
+  // are rendered or in progress ahead of the sink, so a slow sink does not
+  // make them buffer the whole file.
+  std::size_t max_pending = 2 * num_threads;
+  std::vector<std::string> buffers(num_modules);
+  std::vector<bool> ready(num_modules, false);
+  std::exception_ptr error;
+  std::atomic<std::size_t> next{0};
+  std::size_t written = 0;
+  bool stopped = false;
+  std::mutex mutex;
+  std::condition_variable cv;
+
+  auto worker = [&]() {
+    for (std::size_t i; (i = next++) < num_modules;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]() { return i < written + max_pending || stopped; });
+        if (stopped) break;
+      }
+      std::string buffer;
+      std::exception_ptr module_error;
+      try {
+        StringSink module_sink(buffer);
+        module_sink.setOptions(sink.getOptions());
+        this->modules[i]->emit(module_sink);
+      } catch (...) {
+        module_error = std::current_exception();
+        next = num_modules;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (module_error && !error) error = module_error;
+        buffers[i] = std::move(buffer);
+        ready[i] = true;
+      }
+      cv.notify_all();
     }
-    if_str += "end";
-  }
+  };
 
-  if (this->else_body.size()) {
-    if_str += " else begin\n";
-    for (auto &statement : else_body) {
-      if_str += add_tab(statement->toString());
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < num_threads; i++) threads.emplace_back(worker);
+  auto join = [&]() {
+    for (auto &thread : threads) thread.join();
+  };
+  auto stop = [&]() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopped = true;
     }
-    if_str += "end";
+    cv.notify_all();
+  };
+
+  try {
+    for (std::size_t i = 0; i < num_modules; i++) {
+      std::string buffer;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]() { return ready[i] || error; });
+        if (error) break;
+        buffer.swap(buffers[i]);
+      }
+      if (i > 0) sink << '\n';
+      sink << buffer;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        written = i + 1;
+      }
+      cv.notify_all();
+    }
+  } catch (...) {
+    // Failed to write to sink, stop the workers before propagating
+    next = num_modules;
+    stop();
+    join();
+    throw;
   }
-  return if_str;
+  stop();
+  join();
+  if (error) std::rethrow_exception(error);
 }
 
-std::string File::toString() {
-  std::string file_str = "";
-
-  std::vector<std::string> file_strs;
-  for (auto &module : modules) {
-    file_strs.push_back(module->toString());
+void File::emitAndRelease(Sink &sink) {
+  std::size_t i = 0;
+  try {
+    for (; i < this->modules.size(); i++) {
+      if (i > 0) sink << '\n';
+      this->modules[i]->emit(sink);
+      this->modules[i].reset();
+    }
+  } catch (...) {
+    // Drop the modules already freed, the file stays usable
+    this->modules.erase(this->modules.begin(), this->modules.begin() + i);
+    throw;
   }
+  this->modules.clear();
+}
 
-  return join(file_strs, "\n");
+std::string File::toString(unsigned int num_threads) const {
+  std::string result;
+  StringSink sink(result);
+  this->emit(sink, num_threads);
+  return result;
 }
 
 std::unique_ptr<Identifier> make_id(std::string name) {
@@ -542,12 +822,579 @@ std::unique_ptr<Vector> make_vector(std::unique_ptr<Identifier> id,
                                   std::move(lsb));
 }
 
-std::string SingleLineComment::toString() {
-  std::string result = "";
+void SingleLineComment::emit(Sink &sink) const {
   if (this->statement) {
-    result += this->statement->toString() + "  ";
+    this->statement->emit(sink);
+    sink << "  ";
+  }
+  sink << "// " << value;
+}
+
+// Structural hashing and equality
+
+namespace {
+
+std::size_t hash_combine(std::size_t seed, std::size_t value) {
+  return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+std::size_t hash_value(const std::string &value);
+std::size_t hash_value(Symbol value);
+template <typename T>
+std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>, std::size_t>
+hash_value(T value);
+template <typename T>
+std::size_t hash_value(const std::unique_ptr<T> &node);
+template <typename... Ts>
+std::size_t hash_value(const std::variant<Ts...> &value);
+template <typename T, typename U>
+std::size_t hash_value(const std::pair<T, U> &value);
+template <typename T>
+std::size_t hash_value(const std::vector<T> &values);
+std::size_t hash_value(const Connections &connections);
+
+std::size_t hash_value(const std::string &value) {
+  return std::hash<std::string>{}(value);
+}
+
+std::size_t hash_value(Symbol value) { return std::hash<Symbol>{}(value); }
+
+template <typename T>
+std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>, std::size_t>
+hash_value(T value) {
+  return static_cast<std::size_t>(value);
+}
+
+template <typename T>
+std::size_t hash_value(const std::unique_ptr<T> &node) {
+  return node ? node->hash() : 0;
+}
+
+template <typename... Ts>
+std::size_t hash_value(const std::variant<Ts...> &value) {
+  return hash_combine(
+      value.index(),
+      std::visit([](const auto &node) { return hash_value(node); }, value));
+}
+
+template <typename T, typename U>
+std::size_t hash_value(const std::pair<T, U> &value) {
+  return hash_combine(hash_value(value.first), hash_value(value.second));
+}
+
+template <typename T>
+std::size_t hash_value(const std::vector<T> &values) {
+  std::size_t seed = values.size();
+  for (const auto &value : values) seed = hash_combine(seed, hash_value(value));
+  return seed;
+}
+
+std::size_t hash_value(const Connections &connections) {
+  std::size_t seed = 0;
+  for (const auto &connection : connections) {
+    seed = hash_combine(seed, hash_value(connection));
+  }
+  return seed;
+}
+
+template <typename... Ts>
+std::size_t hash_fields(NodeKind kind, const Ts &... fields) {
+  std::size_t seed = static_cast<std::size_t>(kind);
+  ((seed = hash_combine(seed, hash_value(fields))), ...);
+  return seed;
+}
+
+bool equal_value(const std::string &lhs, const std::string &rhs);
+template <typename T>
+std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>, bool>
+equal_value(T lhs, T rhs);
+template <typename T>
+bool equal_value(const std::unique_ptr<T> &lhs, const std::unique_ptr<T> &rhs);
+bool equal_value(const std::unique_ptr<Star> &lhs,
+                 const std::unique_ptr<Star> &rhs);
+template <typename... Ts>
+bool equal_value(const std::variant<Ts...> &lhs,
+                 const std::variant<Ts...> &rhs);
+template <typename T, typename U>
+bool equal_value(const std::pair<T, U> &lhs, const std::pair<T, U> &rhs);
+template <typename T>
+bool equal_value(const std::vector<T> &lhs, const std::vector<T> &rhs);
+bool equal_value(const Connections &lhs, const Connections &rhs);
+
+bool equal_value(const std::string &lhs, const std::string &rhs) {
+  return lhs == rhs;
+}
+
+template <typename T>
+std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>, bool>
+equal_value(T lhs, T rhs) {
+  return lhs == rhs;
+}
+
+template <typename T>
+bool equal_value(const std::unique_ptr<T> &lhs,
+                 const std::unique_ptr<T> &rhs) {
+  if (!lhs || !rhs) return lhs == rhs;
+  return lhs->structurallyEqual(*rhs);
+}
+
+// Star has no fields (and its Node base is private)
+bool equal_value(const std::unique_ptr<Star> &lhs,
+                 const std::unique_ptr<Star> &rhs) {
+  return static_cast<bool>(lhs) == static_cast<bool>(rhs);
+}
+
+template <typename... Ts>
+bool equal_value(const std::variant<Ts...> &lhs,
+                 const std::variant<Ts...> &rhs) {
+  if (lhs.index() != rhs.index()) return false;
+  return std::visit(
+      [&](const auto &node) {
+        using T = std::decay_t<decltype(node)>;
+        return equal_value(node, std::get<T>(rhs));
+      },
+      lhs);
+}
+
+template <typename T, typename U>
+bool equal_value(const std::pair<T, U> &lhs, const std::pair<T, U> &rhs) {
+  return equal_value(lhs.first, rhs.first) &&
+         equal_value(lhs.second, rhs.second);
+}
+
+template <typename T>
+bool equal_value(const std::vector<T> &lhs, const std::vector<T> &rhs) {
+  if (lhs.size() != rhs.size()) return false;
+  for (std::size_t i = 0; i < lhs.size(); i++) {
+    if (!equal_value(lhs[i], rhs[i])) return false;
+  }
+  return true;
+}
+
+bool equal_value(const Connections &lhs, const Connections &rhs) {
+  auto lhs_it = lhs.begin(), rhs_it = rhs.begin();
+  for (; lhs_it != lhs.end() && rhs_it != rhs.end(); ++lhs_it, ++rhs_it) {
+    if (!equal_value(*lhs_it, *rhs_it)) return false;
+  }
+  return lhs_it == lhs.end() && rhs_it == rhs.end();
+}
+
+}  // namespace
+
+std::size_t Node::hash() const {
+  return hash_fields(this->getKind(), this->toString());
+}
+
+bool Node::structurallyEqual(const Node &other) const {
+  return this->getKind() == other.getKind() &&
+         this->toString() == other.toString();
+}
+
+std::size_t Expression::hash_impl() const { return Node::hash(); }
+
+bool Expression::equal_impl(const Expression &other) const {
+  return this->toString() == other.toString();
+}
+
+std::size_t Expression::hash() const {
+  std::size_t hash = this->cached_hash.load(std::memory_order_relaxed);
+  if (hash == 0) {
+    hash = this->hash_impl();
+    // 0 marks the cache as empty
+    if (hash == 0) hash = 1;
+    this->cached_hash.store(hash, std::memory_order_relaxed);
   }
-  return result + "// " + value;
+  return hash;
+}
+
+bool Expression::structurallyEqual(const Node &other) const {
+  if (!isa<Expression>(&other)) return false;
+  // Shared expressions compare as the expression they refer to
+  const Expression *lhs = strip_shared(this);
+  const Expression *rhs = strip_shared(static_cast<const Expression *>(&other));
+  if (lhs == rhs) return true;
+  if (lhs->getKind() != rhs->getKind()) return false;
+  std::size_t lhs_hash = lhs->cached_hash.load(std::memory_order_relaxed);
+  std::size_t rhs_hash = rhs->cached_hash.load(std::memory_order_relaxed);
+  if (lhs_hash && rhs_hash && lhs_hash != rhs_hash) return false;
+  return lhs->equal_impl(*rhs);
+}
+
+// Literals with a value compare by it, so e.g. `8'd7` equals `8'd07`. Only
+// literals with x/z digits compare by their digits.
+std::size_t NumericLiteral::hash_impl() const {
+  return hash_combine(
+      hash_fields(this->getKind(), this->size, this->_signed, this->radix,
+                  this->always_codegen_size),
+      this->bits ? this->bits->hash() : hash_value(this->value));
+}
+
+bool NumericLiteral::equal_impl(const Expression &other) const {
+  auto &rhs = static_cast<const NumericLiteral &>(other);
+  return this->size == rhs.size && this->_signed == rhs._signed &&
+         this->radix == rhs.radix &&
+         this->always_codegen_size == rhs.always_codegen_size &&
+         (this->bits || rhs.bits ? this->bits == rhs.bits
+                                 : this->value == rhs.value);
+}
+
+std::size_t Cast::hash_impl() const {
+  return hash_fields(this->getKind(), this->width, this->expr);
+}
+
+bool Cast::equal_impl(const Expression &other) const {
+  auto &rhs = static_cast<const Cast &>(other);
+  return this->width == rhs.width && equal_value(this->expr, rhs.expr);
+}
+
+std::size_t Identifier::hash_impl() const {
+  return hash_fields(this->getKind(), this->value);
+}
+
+bool Identifier::equal_impl(const Expression &other) const {
+  return this->value == static_cast<const Identifier &>(other).value;
+}
+
+std::size_t Attribute::hash_impl() const {
+  return hash_fields(this->getKind(), this->value, this->attr);
+}
+
+bool Attribute::equal_impl(const Expression &other) const {
+  auto &rhs = static_cast<const Attribute &>(other);
+  return this->attr == rhs.attr && equal_value(this->value, rhs.value);
+}
+
+std::size_t String::hash_impl() const {
+  return hash_fields(this->getKind(), this->value);
+}
+
+bool String::equal_impl(const Expression &other) const {
+  return this->value == static_cast<const String &>(other).value;
+}
+
+std::size_t Slice::hash_impl() const {
+  return hash_fields(this->getKind(), this->expr, this->high_index,
+                     this->low_index);
+}
+
+bool Slice::equal_impl(const Expression &other) const {
+  auto &rhs = static_cast<const Slice &>(other);
+  return equal_value(this->expr, rhs.expr) &&
+         equal_value(this->high_index, rhs.high_index) &&
+         equal_value(this->low_index, rhs.low_index);
+}
+
+std::size_t Index::hash_impl() const {
+  return hash_fields(this->getKind(), this->value, this->index);
+}
+
+bool Index::equal_impl(const Expression &other) const {
+  auto &rhs = static_cast<const Index &>(other);
+  return equal_value(this->value, rhs.value) &&
+         equal_value(this->index, rhs.index);
+}
+
+std::size_t BinaryOp::hash_impl() const {
+  return hash_fields(this->getKind(), this->left, this->op, this->right);
+}
+
+bool BinaryOp::equal_impl(const Expression &other) const {
+  auto &rhs = static_cast<const BinaryOp &>(other);
+  return this->op == rhs.op && equal_value(this->left, rhs.left) &&
+         equal_value(this->right, rhs.right);
+}
+
+std::size_t UnaryOp::hash_impl() const {
+  return hash_fields(this->getKind(), this->operand, this->op);
+}
+
+bool UnaryOp::equal_impl(const Expression &other) const {
+  auto &rhs = static_cast<const UnaryOp &>(other);
+  return this->op == rhs.op && equal_value(this->operand, rhs.operand);
+}
+
+std::size_t TernaryOp::hash_impl() const {
+  return hash_fields(this->getKind(), this->cond, this->true_value,
+                     this->false_value);
+}
+
+bool TernaryOp::equal_impl(const Expression &other) const {
+  auto &rhs = static_cast<const TernaryOp &>(other);
+  return equal_value(this->cond, rhs.cond) &&
+         equal_value(this->true_value, rhs.true_value) &&
+         equal_value(this->false_value, rhs.false_value);
+}
+
+std::size_t Concat::hash_impl() const {
+  return hash_fields(this->getKind(), this->args, this->unpacked);
+}
+
+bool Concat::equal_impl(const Expression &other) const {
+  auto &rhs = static_cast<const Concat &>(other);
+  return this->unpacked == rhs.unpacked && equal_value(this->args, rhs.args);
+}
+
+std::size_t Replicate::hash_impl() const {
+  return hash_fields(this->getKind(), this->num, this->value);
+}
+
+bool Replicate::equal_impl(const Expression &other) const {
+  auto &rhs = static_cast<const Replicate &>(other);
+  return equal_value(this->num, rhs.num) &&
+         equal_value(this->value, rhs.value);
+}
+
+std::size_t CallExpr::hash_impl() const {
+  return hash_fields(this->getKind(), this->func, this->args);
+}
+
+bool CallExpr::equal_impl(const Expression &other) const {
+  auto &rhs = static_cast<const CallExpr &>(other);
+  return this->func == rhs.func && equal_value(this->args, rhs.args);
+}
+
+bool SharedExpr::equal_impl(const Expression &other) const {
+  return this->value->structurallyEqual(
+      *static_cast<const SharedExpr &>(other).value);
+}
+
+std::size_t NegEdge::hash() const {
+  return hash_fields(this->getKind(), this->value);
+}
+
+bool NegEdge::structurallyEqual(const Node &other) const {
+  return this->getKind() == other.getKind() &&
+         equal_value(this->value, static_cast<const NegEdge &>(other).value);
+}
+
+std::size_t PosEdge::hash() const {
+  return hash_fields(this->getKind(), this->value);
+}
+
+bool PosEdge::structurallyEqual(const Node &other) const {
+  return this->getKind() == other.getKind() &&
+         equal_value(this->value, static_cast<const PosEdge &>(other).value);
+}
+
+std::size_t Star::hash() const { return hash_fields(this->getKind()); }
+
+bool Star::structurallyEqual(const Node &other) const {
+  return this->getKind() == other.getKind();
+}
+
+std::size_t Vector::hash() const {
+  return hash_fields(this->getKind(), this->id, this->msb, this->lsb);
+}
+
+bool Vector::structurallyEqual(const Node &other) const {
+  if (this->getKind() != other.getKind()) return false;
+  auto &rhs = static_cast<const Vector &>(other);
+  return equal_value(this->id, rhs.id) && equal_value(this->msb, rhs.msb) &&
+         equal_value(this->lsb, rhs.lsb);
+}
+
+std::size_t NDVector::hash() const {
+  return hash_combine(Vector::hash(), hash_value(this->outer_dims));
+}
+
+bool NDVector::structurallyEqual(const Node &other) const {
+  return Vector::structurallyEqual(other) &&
+         equal_value(this->outer_dims,
+                     static_cast<const NDVector &>(other).outer_dims);
+}
+
+std::size_t Port::hash() const {
+  return hash_fields(this->getKind(), this->value, this->direction,
+                     this->data_type);
+}
+
+bool Port::structurallyEqual(const Node &other) const {
+  if (this->getKind() != other.getKind()) return false;
+  auto &rhs = static_cast<const Port &>(other);
+  return this->direction == rhs.direction &&
+         this->data_type == rhs.data_type &&
+         equal_value(this->value, rhs.value);
+}
+
+std::size_t StringPort::hash() const {
+  return hash_fields(this->getKind(), this->value);
+}
+
+bool StringPort::structurallyEqual(const Node &other) const {
+  return this->getKind() == other.getKind() &&
+         this->value == static_cast<const StringPort &>(other).value;
+}
+
+// The comments and assigns have two Node bases, so `other` (which may be
+// either of them) is converted with dyn_cast (see `needs_dynamic_cast`)
+
+std::size_t SingleLineComment::hash() const {
+  return hash_fields(NodeKind::SingleLineComment, this->value, this->statement);
+}
+
+bool SingleLineComment::structurallyEqual(const Node &other) const {
+  if (other.getKind() != NodeKind::SingleLineComment) return false;
+  auto rhs = dyn_cast<SingleLineComment>(&other);
+  return rhs && this->value == rhs->value &&
+         equal_value(this->statement, rhs->statement);
+}
+
+std::size_t BlockComment::hash() const {
+  return hash_fields(NodeKind::BlockComment, this->value);
+}
+
+bool BlockComment::structurallyEqual(const Node &other) const {
+  if (other.getKind() != NodeKind::BlockComment) return false;
+  auto rhs = dyn_cast<BlockComment>(&other);
+  return rhs && this->value == rhs->value;
+}
+
+std::size_t Assign::hash() const {
+  return hash_fields(this->getKind(), this->target, this->value, this->prefix,
+                     this->symbol);
+}
+
+bool Assign::structurallyEqual(const Node &other) const {
+  if (this->getKind() != other.getKind()) return false;
+  auto rhs = dyn_cast<Assign>(&other);
+  return rhs && this->prefix == rhs->prefix && this->symbol == rhs->symbol &&
+         equal_value(this->target, rhs->target) &&
+         equal_value(this->value, rhs->value);
+}
+
+std::size_t InlineVerilog::hash() const {
+  return hash_fields(this->getKind(), this->value);
+}
+
+bool InlineVerilog::structurallyEqual(const Node &other) const {
+  return this->getKind() == other.getKind() &&
+         this->value == static_cast<const InlineVerilog &>(other).value;
+}
+
+std::size_t ModuleInstantiation::hash() const {
+  std::size_t seed = hash_fields(this->getKind(), this->module_name,
+                                 this->parameters, this->instance_name);
+  if (this->connections) {
+    seed = hash_combine(seed, hash_value(*this->connections));
+  }
+  return seed;
+}
+
+bool ModuleInstantiation::structurallyEqual(const Node &other) const {
+  if (this->getKind() != other.getKind()) return false;
+  auto &rhs = static_cast<const ModuleInstantiation &>(other);
+  if (this->module_name != rhs.module_name ||
+      this->instance_name != rhs.instance_name ||
+      !equal_value(this->parameters, rhs.parameters)) {
+    return false;
+  }
+  if (!this->connections || !rhs.connections) {
+    return this->connections == rhs.connections;
+  }
+  return equal_value(*this->connections, *rhs.connections);
+}
+
+std::size_t Declaration::hash() const {
+  return hash_fields(this->getKind(), this->decl, this->value);
+}
+
+bool Declaration::structurallyEqual(const Node &other) const {
+  if (this->getKind() != other.getKind()) return false;
+  auto &rhs = static_cast<const Declaration &>(other);
+  return this->decl == rhs.decl && equal_value(this->value, rhs.value);
+}
+
+std::size_t IfMacro::hash() const {
+  return hash_fields(this->getKind(), this->condition_str, this->true_body,
+                     this->else_body);
+}
+
+bool IfMacro::structurallyEqual(const Node &other) const {
+  if (this->getKind() != other.getKind()) return false;
+  auto &rhs = static_cast<const IfMacro &>(other);
+  return this->condition_str == rhs.condition_str &&
+         equal_value(this->true_body, rhs.true_body) &&
+         equal_value(this->else_body, rhs.else_body);
+}
+
+std::size_t CallStmt::hash() const {
+  return hash_fields(this->getKind(), this->func, this->args);
+}
+
+bool CallStmt::structurallyEqual(const Node &other) const {
+  if (this->getKind() != other.getKind()) return false;
+  auto &rhs = static_cast<const CallStmt &>(other);
+  return this->func == rhs.func && equal_value(this->args, rhs.args);
+}
+
+std::size_t Always::hash() const {
+  return hash_fields(this->getKind(), this->sensitivity_list, this->body);
+}
+
+bool Always::structurallyEqual(const Node &other) const {
+  if (this->getKind() != other.getKind()) return false;
+  auto &rhs = static_cast<const Always &>(other);
+  return equal_value(this->sensitivity_list, rhs.sensitivity_list) &&
+         equal_value(this->body, rhs.body);
+}
+
+std::size_t If::hash() const {
+  return hash_fields(this->getKind(), this->cond, this->true_body,
+                     this->else_ifs, this->else_body);
+}
+
+bool If::structurallyEqual(const Node &other) const {
+  if (this->getKind() != other.getKind()) return false;
+  auto &rhs = static_cast<const If &>(other);
+  return equal_value(this->cond, rhs.cond) &&
+         equal_value(this->true_body, rhs.true_body) &&
+         equal_value(this->else_ifs, rhs.else_ifs) &&
+         equal_value(this->else_body, rhs.else_body);
+}
+
+std::size_t Module::hash() const {
+  return hash_fields(this->getKind(), this->name, this->ports, this->body,
+                     this->parameters);
+}
+
+bool Module::structurallyEqual(const Node &other) const {
+  if (this->getKind() != other.getKind()) return false;
+  auto &rhs = static_cast<const Module &>(other);
+  return this->name == rhs.name && equal_value(this->ports, rhs.ports) &&
+         equal_value(this->body, rhs.body) &&
+         equal_value(this->parameters, rhs.parameters);
+}
+
+std::size_t StringBodyModule::hash() const {
+  return hash_fields(this->getKind(), this->name, this->ports, this->body,
+                     this->parameters);
+}
+
+bool StringBodyModule::structurallyEqual(const Node &other) const {
+  if (this->getKind() != other.getKind()) return false;
+  auto &rhs = static_cast<const StringBodyModule &>(other);
+  return this->name == rhs.name && this->body == rhs.body &&
+         equal_value(this->ports, rhs.ports) &&
+         equal_value(this->parameters, rhs.parameters);
+}
+
+std::size_t StringModule::hash() const {
+  return hash_fields(this->getKind(), this->definition);
+}
+
+bool StringModule::structurallyEqual(const Node &other) const {
+  if (this->getKind() != other.getKind()) return false;
+  return this->definition ==
+         static_cast<const StringModule &>(other).definition;
+}
+
+std::size_t File::hash() const {
+  return hash_fields(this->getKind(), this->modules);
+}
+
+bool File::structurallyEqual(const Node &other) const {
+  return this->getKind() == other.getKind() &&
+         equal_value(this->modules, static_cast<const File &>(other).modules);
 }
 
 }  // namespace verilogAST
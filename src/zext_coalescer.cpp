@@ -8,23 +8,13 @@ namespace {
 using ConcatArg = std::unique_ptr<Expression>;
 using ConcatArgs = std::vector<ConcatArg>;
 
-std::pair<bool, int> num_zeros(Expression* const expr) {
-  auto ptr = dynamic_cast<const NumericLiteral*>(expr);
+std::pair<bool, int> num_zeros(const Expression* expr) {
+  auto ptr = dyn_cast<NumericLiteral>(strip_shared(expr));
   if (not ptr) return {false, 0};
-  switch (ptr->radix) {
-    // TODO(rsetaluri): This is conservative in that it will only perform the
-    // logic for decimal zero's. This should be expanded to support binary, hex,
-    // etc. zero's as well.
-    case DECIMAL: {
-      auto value = std::atoi(ptr->value.c_str());
-      if (value == 0) return {true, ptr->size};
-      return {false, 0};
-      break;
-    }
-    default: {
-      return {false, 0};
-    }
-  }
+  // Zeros in any radix and of any width (but not x/z digits)
+  auto bits = ptr->getBits();
+  if (not bits or not bits->isZero()) return {false, 0};
+  return {true, ptr->size};
 }
 
 std::pair<int, ConcatArgs::const_iterator> processArguments(
@@ -39,26 +29,47 @@ std::pair<int, ConcatArgs::const_iterator> processArguments(
   return {zeros, it};
 }
 
-}  // namespace
-
-std::unique_ptr<Expression> ZextCoalescer::visit(
-    std::unique_ptr<Expression> node) {
-  auto ptr = dynamic_cast<const Concat*>(node.get());
+// Returns the Concat @node with its leading zeros coalesced into one literal
+// (or elided), or nullptr if it is left as is. The arguments of a Concat owned
+// by @node are stolen, those of a shared one are cloned.
+std::unique_ptr<Expression> coalesce(Expression* node, bool elide,
+                                     LiteralPool* pool) {
+  auto ptr = dyn_cast<Concat>(strip_shared(node));
   // This pass only operates on non-empty Concat nodes.
-  if (not ptr or ptr->args.size() == 0) return node;
+  if (not ptr or ptr->args.size() == 0) return nullptr;
   auto res = processArguments(ptr->args);
   if (res.first == 0) {
     assert(res.second == ptr->args.begin());
-    return node;
+    return nullptr;
   }
   ConcatArgs args;
-  if (not elide_) {
-    args.emplace_back(new NumericLiteral("0", res.first));
+  if (not elide) {
+    if (pool) {
+      args.push_back(pool->get("0", res.first));
+    } else {
+      args.emplace_back(new NumericLiteral("0", res.first));
+    }
   }
-  for (auto it = res.second; it != ptr->args.end(); it++) {
-    args.push_back((*it)->clone());
+  auto owner = dyn_cast<Concat>(node);
+  auto first = res.second - ptr->args.begin();
+  for (auto i = first; i < static_cast<long>(ptr->args.size()); i++) {
+    args.push_back(owner ? std::move(owner->args[i]) : ptr->args[i]->clone());
   }
   return std::make_unique<Concat>(std::move(args));
 }
 
+}  // namespace
+
+std::unique_ptr<Expression> ZextCoalescer::visit(
+    std::unique_ptr<Expression> node) {
+  auto result = coalesce(node.get(), elide_, pool_);
+  if (not result) return node;
+  return result;
+}
+
+void ZextCoalescerInPlace::visit(std::unique_ptr<Expression>& node) {
+  auto result = coalesce(node.get(), elide_, pool_);
+  if (result) this->replace(node, std::move(result));
+}
+
 }  // namespace verilogAST
@@ -1,4 +1,5 @@
 #include "verilogAST/assign_inliner.hpp"
+#include <atomic>
 #include "common.cpp"
 #include "gtest/gtest.h"
 
@@ -1245,6 +1246,536 @@ TEST(InlineAssignTests, TestNoInlineNumToIndexSlice) {
   EXPECT_EQ(transformer.visit(std::move(module))->toString(), expected_str);
 }
 
+TEST(InlineAssignTests, TestMoveSingleUseDriver) {
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("a"), vAST::INPUT,
+                                               vAST::WIRE));
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("b"), vAST::INPUT,
+                                               vAST::WIRE));
+  for (auto name : {"o0", "o1", "o2"}) {
+    ports.push_back(std::make_unique<vAST::Port>(vAST::make_id(name),
+                                                 vAST::OUTPUT, vAST::WIRE));
+  }
+
+  std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                           std::unique_ptr<vAST::Declaration>>>
+      body;
+
+  for (auto name : {"x", "y", "z"}) {
+    body.push_back(std::make_unique<vAST::Wire>(vAST::make_id(name)));
+  }
+
+  // x is read once, its driver is moved into o0
+  std::unique_ptr<vAST::Expression> x_driver = vAST::make_binop(
+      vAST::make_id("a"), vAST::BinOp::ADD, vAST::make_id("b"));
+  const vAST::Expression *x_driver_ptr = x_driver.get();
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("x"), std::move(x_driver)));
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("o0"),
+      vAST::make_binop(vAST::make_id("x"), vAST::BinOp::SUB,
+                       vAST::make_id("a"))));
+
+  // y is read once, but through z which is read twice, so its driver is
+  // copied
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("y"), vAST::make_binop(vAST::make_id("a"),
+                                           vAST::BinOp::MUL,
+                                           vAST::make_id("b"))));
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(vAST::make_id("z"),
+                                                          vAST::make_id("y")));
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(vAST::make_id("o1"),
+                                                          vAST::make_id("z")));
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(vAST::make_id("o2"),
+                                                          vAST::make_id("z")));
+
+  std::unique_ptr<vAST::AbstractModule> module = std::make_unique<vAST::Module>(
+      "test_module", std::move(ports), std::move(body));
+
+  std::string expected_str =
+      "module test_module (\n"
+      "    input a,\n"
+      "    input b,\n"
+      "    output o0,\n"
+      "    output o1,\n"
+      "    output o2\n"
+      ");\n"
+      "assign o0 = (a + b) - a;\n"
+      "assign o1 = a * b;\n"
+      "assign o2 = a * b;\n"
+      "endmodule\n";
+
+  vAST::AssignInliner transformer;
+  module = transformer.visit(std::move(module));
+  EXPECT_EQ(module->toString(), expected_str);
+
+  auto &o0 = std::get<std::unique_ptr<vAST::StructuralStatement>>(
+      static_cast<vAST::Module *>(module.get())->body[0]);
+  auto o0_value = static_cast<vAST::ContinuousAssign *>(o0.get())->value.get();
+  EXPECT_EQ(static_cast<vAST::BinaryOp *>(o0_value)->left.get(), x_driver_ptr);
+}
+
+TEST(InlineAssignTests, TestLongAliasChain) {
+  // w0 = w1, w1 = w2, ..., with every wire also used in an index, so the
+  // driver of the last one is checked from every link of the chain
+  const int n = 2000;
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("a"), vAST::INPUT,
+                                               vAST::WIRE));
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("b"), vAST::INPUT,
+                                               vAST::WIRE));
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("o"),
+                                               vAST::OUTPUT, vAST::WIRE));
+
+  std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                           std::unique_ptr<vAST::Declaration>>>
+      body;
+  std::vector<std::unique_ptr<vAST::Expression>> bits;
+  for (int i = 0; i < n; i++) {
+    std::string name = "w" + std::to_string(i);
+    body.push_back(std::make_unique<vAST::Wire>(vAST::make_id(name)));
+    std::unique_ptr<vAST::Expression> driver;
+    if (i + 1 < n) {
+      driver = vAST::make_id("w" + std::to_string(i + 1));
+    } else {
+      driver = vAST::make_binop(vAST::make_id("a"), vAST::BinOp::ADD,
+                                vAST::make_id("b"));
+    }
+    body.push_back(std::make_unique<vAST::ContinuousAssign>(
+        vAST::make_id(name), std::move(driver)));
+    bits.push_back(std::make_unique<vAST::Index>(vAST::make_id(name),
+                                                 vAST::make_num("0")));
+  }
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("o"), std::make_unique<vAST::Concat>(std::move(bits))));
+
+  std::unique_ptr<vAST::AbstractModule> module = std::make_unique<vAST::Module>(
+      "test_module", std::move(ports), std::move(body));
+
+  // Only the end of the chain is kept, a + b cannot be indexed
+  std::string last = "w" + std::to_string(n - 1);
+  std::string concat;
+  for (int i = 0; i < n; i++) concat += (i ? "," : "") + last + "[0]";
+  std::string expected_str =
+      "module test_module (\n"
+      "    input a,\n"
+      "    input b,\n"
+      "    output o\n"
+      ");\n"
+      "wire " + last + ";\n"
+      "assign " + last + " = a + b;\n"
+      "assign o = {" + concat + "};\n"
+      "endmodule\n";
+
+  vAST::AssignInliner transformer;
+  EXPECT_EQ(transformer.visit(std::move(module))->toString(), expected_str);
+}
+
+TEST(InlineAssignTests, TestCostModel) {
+  // x = a * b; y = x + a; z = y + b; o = z - a
+  auto make_module = []() {
+    std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+    ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("a"),
+                                                 vAST::INPUT, vAST::WIRE));
+    ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("b"),
+                                                 vAST::INPUT, vAST::WIRE));
+    ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("o"),
+                                                 vAST::OUTPUT, vAST::WIRE));
+
+    std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                             std::unique_ptr<vAST::Declaration>>>
+        body;
+    for (auto name : {"x", "y", "z"}) {
+      body.push_back(std::make_unique<vAST::Wire>(vAST::make_id(name)));
+    }
+    body.push_back(std::make_unique<vAST::ContinuousAssign>(
+        vAST::make_id("x"), vAST::make_binop(vAST::make_id("a"),
+                                             vAST::BinOp::MUL,
+                                             vAST::make_id("b"))));
+    body.push_back(std::make_unique<vAST::ContinuousAssign>(
+        vAST::make_id("y"), vAST::make_binop(vAST::make_id("x"),
+                                             vAST::BinOp::ADD,
+                                             vAST::make_id("a"))));
+    body.push_back(std::make_unique<vAST::ContinuousAssign>(
+        vAST::make_id("z"), vAST::make_binop(vAST::make_id("y"),
+                                             vAST::BinOp::ADD,
+                                             vAST::make_id("b"))));
+    body.push_back(std::make_unique<vAST::ContinuousAssign>(
+        vAST::make_id("o"), vAST::make_binop(vAST::make_id("z"),
+                                             vAST::BinOp::SUB,
+                                             vAST::make_id("a"))));
+    return std::unique_ptr<vAST::AbstractModule>(std::make_unique<vAST::Module>(
+        "test_module", std::move(ports), std::move(body)));
+  };
+  std::string header =
+      "module test_module (\n"
+      "    input a,\n"
+      "    input b,\n"
+      "    output o\n"
+      ");\n";
+
+  vAST::AssignInliner unlimited;
+  EXPECT_EQ(unlimited.visit(make_module())->toString(),
+            header + "assign o = (((a * b) + a) + b) - a;\nendmodule\n");
+
+  // The multiplication weighs 4, so the inlined expression costs 12
+  vAST::InlineCostModel cost_model;
+  cost_model.max_cost = 10;
+  vAST::AssignInliner cost_limited;
+  cost_limited.setCostModel(cost_model);
+  EXPECT_EQ(cost_limited.visit(make_module())->toString(),
+            header +
+                "wire z;\n"
+                "assign z = ((a * b) + a) + b;\n"
+                "assign o = z - a;\n"
+                "endmodule\n");
+
+  cost_model = vAST::InlineCostModel();
+  cost_model.max_depth = 3;
+  vAST::AssignInliner depth_limited;
+  depth_limited.setCostModel(cost_model);
+  EXPECT_EQ(depth_limited.visit(make_module())->toString(),
+            header +
+                "wire y;\n"
+                "assign y = (a * b) + a;\n"
+                "assign o = (y + b) - a;\n"
+                "endmodule\n");
+}
+
+TEST(InlineAssignTests, TestCostModelNonBlocking) {
+  // x = a * b; y = a - b; always @(posedge clk) r <= x + y
+  auto make_module = []() {
+    std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+    for (auto name : {"clk", "a", "b"}) {
+      ports.push_back(std::make_unique<vAST::Port>(vAST::make_id(name),
+                                                   vAST::INPUT, vAST::WIRE));
+    }
+    ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("r"),
+                                                 vAST::OUTPUT, vAST::REG));
+
+    std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                             std::unique_ptr<vAST::Declaration>>>
+        body;
+    for (auto name : {"x", "y"}) {
+      body.push_back(std::make_unique<vAST::Wire>(vAST::make_id(name)));
+    }
+    body.push_back(std::make_unique<vAST::ContinuousAssign>(
+        vAST::make_id("x"), vAST::make_binop(vAST::make_id("a"),
+                                             vAST::BinOp::MUL,
+                                             vAST::make_id("b"))));
+    body.push_back(std::make_unique<vAST::ContinuousAssign>(
+        vAST::make_id("y"), vAST::make_binop(vAST::make_id("a"),
+                                             vAST::BinOp::SUB,
+                                             vAST::make_id("b"))));
+
+    std::vector<std::unique_ptr<vAST::BehavioralStatement>> always_body;
+    always_body.push_back(std::make_unique<vAST::NonBlockingAssign>(
+        vAST::make_id("r"), vAST::make_binop(vAST::make_id("x"),
+                                             vAST::BinOp::ADD,
+                                             vAST::make_id("y"))));
+    std::vector<std::variant<
+        std::unique_ptr<vAST::Identifier>, std::unique_ptr<vAST::PosEdge>,
+        std::unique_ptr<vAST::NegEdge>, std::unique_ptr<vAST::Star>>>
+        sensitivity_list;
+    sensitivity_list.push_back(
+        std::make_unique<vAST::PosEdge>(vAST::make_id("clk")));
+    body.push_back(std::make_unique<vAST::Always>(std::move(sensitivity_list),
+                                                  std::move(always_body)));
+    return std::unique_ptr<vAST::AbstractModule>(std::make_unique<vAST::Module>(
+        "test_module", std::move(ports), std::move(body)));
+  };
+  std::string header =
+      "module test_module (\n"
+      "    input clk,\n"
+      "    input a,\n"
+      "    input b,\n"
+      "    output reg r\n"
+      ");\n";
+
+  vAST::AssignInliner unlimited;
+  EXPECT_EQ(unlimited.visit(make_module())->toString(),
+            header +
+                "always @(posedge clk) begin\n"
+                "r <= (a * b) + (a - b);\n"
+                "end\n\n"
+                "endmodule\n");
+
+  // Each driver fits the budget alone, together they cost 10
+  vAST::InlineCostModel cost_model;
+  cost_model.max_cost = 8;
+  vAST::AssignInliner cost_limited;
+  cost_limited.setCostModel(cost_model);
+  EXPECT_EQ(cost_limited.visit(make_module())->toString(),
+            header +
+                "wire x;\n"
+                "assign x = a * b;\n"
+                "always @(posedge clk) begin\n"
+                "r <= x + (a - b);\n"
+                "end\n\n"
+                "endmodule\n");
+}
+
+// Module with output `o` reading wire x `num_reads` times
+std::unique_ptr<vAST::AbstractModule> make_read_module(std::string name,
+                                                       int num_reads) {
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("a"), vAST::INPUT,
+                                               vAST::WIRE));
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("o"),
+                                               vAST::OUTPUT, vAST::WIRE));
+
+  std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                           std::unique_ptr<vAST::Declaration>>>
+      body;
+  body.push_back(std::make_unique<vAST::Wire>(vAST::make_id("x")));
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("x"),
+      std::make_unique<vAST::UnaryOp>(vAST::make_id("a"), vAST::UnOp::INVERT)));
+  std::vector<std::unique_ptr<vAST::Expression>> reads;
+  for (int i = 0; i < num_reads; i++) reads.push_back(vAST::make_id("x"));
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("o"), std::make_unique<vAST::Concat>(std::move(reads))));
+  return std::make_unique<vAST::Module>(name, std::move(ports),
+                                        std::move(body));
+}
+
+TEST(InlineAssignTests, TestFileModuleState) {
+  // x is read twice in m0 and once in m1, so it is only inlined in m1
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  modules.push_back(make_read_module("m0", 2));
+  modules.push_back(make_read_module("m1", 1));
+  auto file = std::make_unique<vAST::File>(modules);
+
+  std::string expected_str =
+      "module m0 (\n"
+      "    input a,\n"
+      "    output o\n"
+      ");\n"
+      "wire x;\n"
+      "assign x = ~ a;\n"
+      "assign o = {x,x};\n"
+      "endmodule\n"
+      "\n"
+      "module m1 (\n"
+      "    input a,\n"
+      "    output o\n"
+      ");\n"
+      "assign o = {~ a};\n"
+      "endmodule\n";
+
+  vAST::AssignInliner transformer;
+  EXPECT_EQ(transformer.visit(std::move(file))->toString(), expected_str);
+}
+
+TEST(InlineAssignTests, TestFileParallel) {
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  std::vector<std::unique_ptr<vAST::AbstractModule>> parallel_modules;
+  for (int i = 0; i < 16; i++) {
+    modules.push_back(make_read_module("m" + std::to_string(i), 1 + i % 2));
+    parallel_modules.push_back(
+        make_read_module("m" + std::to_string(i), 1 + i % 2));
+  }
+  auto file = std::make_unique<vAST::File>(modules);
+  auto parallel_file = std::make_unique<vAST::File>(parallel_modules);
+
+  vAST::AssignInliner transformer;
+  std::string expected_str = transformer.visit(std::move(file))->toString();
+  EXPECT_EQ(transformer.visit(std::move(parallel_file), 4)->toString(),
+            expected_str);
+
+  // The workers intern names in the caller's table
+  vAST::SymbolTable table;
+  vAST::SymbolTable::Scope scope(table);
+  std::vector<std::unique_ptr<vAST::AbstractModule>> scoped_modules;
+  for (int i = 0; i < 16; i++) {
+    scoped_modules.push_back(
+        make_read_module("m" + std::to_string(i), 1 + i % 2));
+  }
+  auto scoped_file = std::make_unique<vAST::File>(scoped_modules);
+  EXPECT_EQ(transformer.visit(std::move(scoped_file), 4)->toString(),
+            expected_str);
+}
+
+// Counts the modules it inlines, in parallel as well
+class CountingInliner : public vAST::AssignInliner {
+  std::atomic<int> &count;
+
+ public:
+  explicit CountingInliner(std::atomic<int> &count) : count(count){};
+
+  using vAST::AssignInliner::visit;
+  std::unique_ptr<vAST::Module> visit(
+      std::unique_ptr<vAST::Module> node) override {
+    this->count++;
+    return vAST::AssignInliner::visit(std::move(node));
+  }
+  std::unique_ptr<vAST::AssignInliner> makeWorker() const override {
+    return std::make_unique<CountingInliner>(this->count);
+  }
+};
+
+TEST(InlineAssignTests, TestFileParallelSubclass) {
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  for (int i = 0; i < 16; i++) {
+    modules.push_back(make_read_module("m" + std::to_string(i), 1 + i % 2));
+  }
+  auto file = std::make_unique<vAST::File>(modules);
+  std::atomic<int> count{0};
+  CountingInliner transformer(count);
+  transformer.visit(std::move(file), 4);
+  EXPECT_EQ(count, 16);
+}
+
+// Never inlines x, and does not override makeWorker
+class KeepXInliner : public vAST::AssignInliner {
+ public:
+  using vAST::AssignInliner::visit;
+  std::unique_ptr<vAST::Module> visit(
+      std::unique_ptr<vAST::Module> node) override {
+    vAST::AssignInliner inliner(std::set<std::string>{"x"});
+    return inliner.visit(std::move(node));
+  }
+};
+
+TEST(InlineAssignTests, TestFileParallelSubclassNoWorker) {
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  std::vector<std::unique_ptr<vAST::AbstractModule>> parallel_modules;
+  for (int i = 0; i < 16; i++) {
+    modules.push_back(make_read_module("m" + std::to_string(i), 1));
+    parallel_modules.push_back(make_read_module("m" + std::to_string(i), 1));
+  }
+  auto file = std::make_unique<vAST::File>(modules);
+  auto parallel_file = std::make_unique<vAST::File>(parallel_modules);
+
+  // The overrides are kept in parallel mode, the modules are inlined serially
+  KeepXInliner transformer;
+  std::string expected_str = transformer.visit(std::move(file))->toString();
+  EXPECT_NE(expected_str.find("wire x;"), std::string::npos);
+  EXPECT_EQ(transformer.visit(std::move(parallel_file), 4)->toString(),
+            expected_str);
+}
+
+TEST(InlineAssignTests, TestEscapedNameMatchingIndex) {
+  // The escaped identifier `\x[0] ` is not the index `x[0]`
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("x[0]"),
+                                               vAST::INPUT, vAST::WIRE));
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("a"), vAST::INPUT,
+                                               vAST::WIRE));
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("o"),
+                                               vAST::OUTPUT, vAST::WIRE));
+
+  std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                           std::unique_ptr<vAST::Declaration>>>
+      body;
+  body.push_back(std::make_unique<vAST::Wire>(std::make_unique<vAST::Vector>(
+      vAST::make_id("x"), vAST::make_num("1"), vAST::make_num("0"))));
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      std::make_unique<vAST::Index>(vAST::make_id("x"), vAST::make_num("0")),
+      vAST::make_id("a")));
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("o"), vAST::make_id("x[0]")));
+
+  std::unique_ptr<vAST::AbstractModule> module = std::make_unique<vAST::Module>(
+      "test_module", std::move(ports), std::move(body));
+
+  std::string expected_str =
+      "module test_module (\n"
+      "    input \\x[0] ,\n"
+      "    input a,\n"
+      "    output o\n"
+      ");\n"
+      "wire [1:0] x;\n"
+      "assign x[0] = a;\n"
+      "assign o = \\x[0] ;\n"
+      "endmodule\n";
+
+  vAST::AssignInliner transformer;
+  EXPECT_EQ(transformer.visit(std::move(module))->toString(), expected_str);
+}
+
+TEST(InlineAssignTests, TestIndexTargetNotInterned) {
+  vAST::SymbolTable table;
+  vAST::SymbolTable::Scope scope(table);
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("a"), vAST::INPUT,
+                                               vAST::WIRE));
+  ports.push_back(std::make_unique<vAST::Port>(
+      std::make_unique<vAST::Vector>(vAST::make_id("o"), vAST::make_num("1"),
+                                     vAST::make_num("0")),
+      vAST::OUTPUT, vAST::WIRE));
+
+  std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                           std::unique_ptr<vAST::Declaration>>>
+      body;
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      std::make_unique<vAST::Index>(vAST::make_id("o"), vAST::make_num("0")),
+      vAST::make_id("a")));
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      std::make_unique<vAST::Slice>(vAST::make_id("o"), vAST::make_num("1"),
+                                    vAST::make_num("1")),
+      vAST::make_id("a")));
+
+  std::unique_ptr<vAST::AbstractModule> module = std::make_unique<vAST::Module>(
+      "test_module", std::move(ports), std::move(body));
+  std::size_t num_symbols = table.size();
+
+  vAST::AssignInliner transformer;
+  module = transformer.visit(std::move(module));
+  EXPECT_EQ(table.size(), num_symbols);
+  EXPECT_EQ(module->toString(),
+            "module test_module (\n"
+            "    input a,\n"
+            "    output [1:0] o\n"
+            ");\n"
+            "assign o[0] = a;\n"
+            "assign o[1:1] = a;\n"
+            "endmodule\n");
+}
+
+TEST(InlineAssignTests, TestNoInlineIfDefDriver) {
+  // `w` is only driven when FOO is defined
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("a"), vAST::INPUT,
+                                               vAST::WIRE));
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("o"),
+                                               vAST::OUTPUT, vAST::WIRE));
+
+  std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                           std::unique_ptr<vAST::Declaration>>>
+      if_def_body;
+  if_def_body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("w"), vAST::make_id("a")));
+
+  std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                           std::unique_ptr<vAST::Declaration>>>
+      body;
+  body.push_back(std::make_unique<vAST::Wire>(vAST::make_id("w")));
+  body.push_back(
+      std::make_unique<vAST::IfDef>("FOO", std::move(if_def_body)));
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("o"), vAST::make_id("w")));
+
+  std::unique_ptr<vAST::AbstractModule> module = std::make_unique<vAST::Module>(
+      "test_module", std::move(ports), std::move(body));
+
+  std::string expected_str =
+      "module test_module (\n"
+      "    input a,\n"
+      "    output o\n"
+      ");\n"
+      "wire w;\n"
+      "`ifdef FOO\n"
+      "assign w = a;\n"
+      "`endif\n"
+      "assign o = w;\n"
+      "endmodule\n";
+  EXPECT_EQ(module->toString(), expected_str);
+
+  vAST::AssignInliner transformer;
+  EXPECT_EQ(transformer.visit(std::move(module))->toString(), expected_str);
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -0,0 +1,122 @@
+#include "verilogAST/ast_context.hpp"
+#include "common.cpp"
+#include "gtest/gtest.h"
+#include "verilogAST/hash_cons.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+TEST(ASTContextTests, TestScope) {
+  vAST::ASTContext context;
+  std::string expected = vAST::Module("test_module", make_simple_ports(),
+                                      make_simple_body(), make_simple_params())
+                             .toString();
+  EXPECT_EQ(context.bytesAllocated(), 0u);
+  EXPECT_EQ(vAST::ASTContext::current(), nullptr);
+  {
+    vAST::ASTContext::Scope scope(context);
+    EXPECT_EQ(vAST::ASTContext::current(), &context);
+    auto module = std::make_unique<vAST::Module>(
+        "test_module", make_simple_ports(), make_simple_body(),
+        make_simple_params());
+    EXPECT_EQ(module->toString(), expected);
+    std::size_t allocated = context.bytesAllocated();
+    EXPECT_GT(allocated, 0u);
+
+    // Clones are placed in the current context as well
+    auto expr = vAST::make_binop(vAST::make_id("a"), vAST::BinOp::ADD,
+                                 vAST::make_num("1"));
+    auto clone = expr->clone();
+    EXPECT_EQ(clone->toString(), "a + 1");
+    EXPECT_GT(context.bytesAllocated(), allocated);
+
+    // Nested scopes restore the previous context
+    vAST::ASTContext inner;
+    {
+      vAST::ASTContext::Scope inner_scope(inner);
+      EXPECT_EQ(vAST::ASTContext::current(), &inner);
+      auto id = vAST::make_id("x");
+      EXPECT_GT(inner.bytesAllocated(), 0u);
+    }
+    EXPECT_EQ(vAST::ASTContext::current(), &context);
+  }
+  EXPECT_EQ(vAST::ASTContext::current(), nullptr);
+}
+
+TEST(ASTContextTests, TestMake) {
+  // Small chunks so nodes span several chunks and large allocations get their
+  // own chunk
+  vAST::ASTContext context(64);
+  std::vector<std::unique_ptr<vAST::Expression>> args;
+  for (int i = 0; i < 100; i++) {
+    args.push_back(context.make<vAST::Identifier>("x" + std::to_string(i)));
+  }
+  auto concat = context.make<vAST::Concat>(std::move(args));
+  EXPECT_EQ(vAST::ASTContext::current(), nullptr);
+  EXPECT_EQ(concat->args.size(), 100u);
+  EXPECT_EQ(concat->args[99]->toString(), "x99");
+
+  // Heap and arena nodes can be mixed in one tree
+  auto heap_id = vAST::make_id("y");
+  concat->args.push_back(std::move(heap_id));
+  concat->args.erase(concat->args.begin());
+  EXPECT_EQ(concat->args.back()->toString(), "y");
+
+  auto star = context.make<vAST::Star>();
+  EXPECT_EQ(star->toString(), "*");
+}
+
+TEST(ASTContextTests, TestHeapNodes) {
+  // Heap nodes are freed whether or not a context is alive
+  auto before = vAST::make_id("a");
+  std::unique_ptr<vAST::Expression> after;
+  {
+    vAST::ASTContext context(64);
+    auto arena_id = context.make<vAST::Identifier>("b");
+    auto heap_id = vAST::make_id("c");
+    after = vAST::make_id("d");
+    EXPECT_GT(context.bytesAllocated(), 0u);
+    heap_id.reset();
+    before.reset();
+    arena_id.reset();
+  }
+  EXPECT_EQ(after->toString(), "d");
+  after.reset();
+}
+
+TEST(ASTContextTests, TestLiveNodes) {
+  vAST::ASTContext context;
+  std::unique_ptr<vAST::Expression> expr;
+  {
+    vAST::ASTContext::Scope scope(context);
+    expr = vAST::make_binop(vAST::make_id("a"), vAST::BinOp::ADD,
+                            vAST::make_id("b"));
+  }
+  EXPECT_EQ(context.liveNodes(), 3u);
+  // Heap nodes are not counted
+  auto heap_id = vAST::make_id("c");
+  EXPECT_EQ(context.liveNodes(), 3u);
+  expr.reset();
+  EXPECT_EQ(context.liveNodes(), 0u);
+}
+
+TEST(ASTContextDeathTest, TestEscapedNode) {
+  // A node interned while the context is active outlives the context
+  auto escape = []() {
+    vAST::ExprInterner interner;
+    {
+      vAST::ASTContext context;
+      vAST::ASTContext::Scope scope(context);
+      interner.intern(vAST::make_id("x"));
+    }
+  };
+  EXPECT_DEATH(escape(), "ASTContext destroyed while 1 of its nodes");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,3 +1,9 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
 #include "common.cpp"
 #include "gtest/gtest.h"
 #include "verilogAST.hpp"
@@ -44,6 +50,112 @@ TEST(BasicTests, TestIdentifier) {
   EXPECT_EQ(id.toString(), "x");
 }
 
+TEST(BasicTests, TestNumericLiteralBits) {
+  vAST::NumericLiteral hex("dead_BEEF", 32, false, vAST::HEX);
+  EXPECT_EQ(hex.getUInt(), 0xdeadbeefu);
+  EXPECT_EQ(vAST::NumericLiteral("17", 4).getUInt(), 1u);  // truncated
+  EXPECT_EQ(vAST::NumericLiteral("x1", vAST::HEX).getBits(), nullptr);
+
+  // Wide values
+  std::string digits = "123456789012345678901234567890";
+  vAST::NumericLiteral wide(digits);
+  ASSERT_NE(wide.getBits(), nullptr);
+  EXPECT_EQ(wide.getBits()->width(), 97u);
+  EXPECT_EQ(wide.getUInt(), std::nullopt);
+  EXPECT_EQ(wide.getBits()->toString(10), digits);
+  EXPECT_EQ(wide.getBits()->toString(16), "18ee90ff6c373e0ee4e3f0ad2");
+
+  // Literals built from bits render their digits
+  vAST::BitVector bits(12, 0xabc);
+  EXPECT_EQ(vAST::NumericLiteral(bits, vAST::HEX).getValue(), "abc");
+  EXPECT_EQ(vAST::NumericLiteral(bits, vAST::HEX).toString(), "12'habc");
+  EXPECT_EQ(vAST::NumericLiteral(bits).toString(), "12'd2748");
+  EXPECT_EQ(vAST::NumericLiteral(vAST::BitVector(32, 5)).toString(), "5");
+  EXPECT_TRUE(vAST::NumericLiteral(bits, vAST::OCTAL)
+                  .structurallyEqual(*vAST::NumericLiteral(bits, vAST::OCTAL)
+                                          .clone()));
+  EXPECT_FALSE(vAST::NumericLiteral(bits).structurallyEqual(
+      vAST::NumericLiteral(vAST::BitVector(12, 1))));
+
+  // Equal values are equal whether parsed or built from bits
+  EXPECT_TRUE(vAST::NumericLiteral("7", 8).structurallyEqual(
+      vAST::NumericLiteral(vAST::BitVector(8, 7))));
+  EXPECT_EQ(vAST::NumericLiteral("7", 8).hash(),
+            vAST::NumericLiteral(vAST::BitVector(8, 7)).hash());
+  EXPECT_TRUE(vAST::NumericLiteral("0_7", 8).structurallyEqual(
+      vAST::NumericLiteral("7", 8)));
+  EXPECT_FALSE(vAST::NumericLiteral("7", 8).structurallyEqual(
+      vAST::NumericLiteral("7", 8, false, vAST::HEX)));
+  EXPECT_TRUE(vAST::NumericLiteral("x1", 8, false, vAST::HEX)
+                  .structurallyEqual(
+                      vAST::NumericLiteral("x1", 8, false, vAST::HEX)));
+  EXPECT_FALSE(vAST::NumericLiteral("x1", 8, false, vAST::HEX)
+                   .structurallyEqual(
+                       vAST::NumericLiteral("x2", 8, false, vAST::HEX)));
+
+  // Modified in place
+  vAST::NumericLiteral num("1");
+  num.setValue("10");
+  EXPECT_EQ(num.getUInt(), 10u);
+  EXPECT_EQ(num.getValue(), "10");
+  num.setValue("300");
+  EXPECT_EQ(num.getUInt(), 300u);
+  num.setSize(8);
+  EXPECT_EQ(num.getUInt(), 44u);
+  EXPECT_EQ(num.toString(), "8'd300");
+  num.setSize(16);
+  EXPECT_EQ(num.getUInt(), 300u);
+  num.setRadix(vAST::HEX);
+  EXPECT_EQ(num.getUInt(), 300u);
+  EXPECT_EQ(num.toString(), "16'h12c");
+
+  // Edits of literals built from bits stay in sync
+  vAST::NumericLiteral built(vAST::BitVector(8, 200), vAST::HEX);
+  built.setRadix(vAST::BINARY);
+  EXPECT_EQ(built.toString(), "8'b11001000");
+  built.setSize(4);
+  EXPECT_EQ(built.getUInt(), 8u);
+  built.setSize(8);
+  EXPECT_EQ(built.getUInt(), 200u);
+  EXPECT_EQ(built.toString(), "8'b11001000");
+  vAST::NumericLiteral unknown("x1", 8, false, vAST::HEX);
+  unknown.setRadix(vAST::BINARY);
+  EXPECT_EQ(unknown.toString(), "8'bx1");
+}
+
+TEST(BasicTests, TestShortestLiterals) {
+  auto emit = [](const vAST::Node& node) {
+    std::string result;
+    vAST::StringSink sink(result);
+    vAST::EmitOptions options;
+    options.shortest_literals = true;
+    sink.setOptions(options);
+    node.emit(sink);
+    return result;
+  };
+  std::string ones(256, '1');
+  vAST::NumericLiteral wide(ones, 256, false, vAST::BINARY);
+  EXPECT_EQ(wide.toString(), "256'b" + ones);
+  EXPECT_EQ(emit(wide), "256'h" + std::string(64, 'f'));
+  EXPECT_EQ(emit(vAST::NumericLiteral("1000", 16, true, vAST::BINARY)),
+            "16'sh8");
+  EXPECT_EQ(emit(vAST::NumericLiteral("255", 8)), "8'hff");
+  EXPECT_EQ(emit(vAST::NumericLiteral("11111111", vAST::BINARY)), "'hff");
+  EXPECT_EQ(emit(vAST::NumericLiteral("0011", vAST::BINARY)), "'h3");
+  // Ties keep the original radix
+  EXPECT_EQ(emit(vAST::NumericLiteral("7", 3, false, vAST::OCTAL)), "3'o7");
+  // Unsized decimals and x/z digits are left alone
+  EXPECT_EQ(emit(vAST::NumericLiteral("123456789012")), "123456789012");
+  EXPECT_EQ(emit(vAST::NumericLiteral("xxxx0000", 8, false, vAST::BINARY)),
+            "8'bxxxx0000");
+  // Nested literals are re-encoded too
+  EXPECT_EQ(emit(*vAST::make_binop(
+                std::make_unique<vAST::NumericLiteral>("10000", 5, false,
+                                                       vAST::BINARY),
+                vAST::BinOp::ADD, vAST::make_id("x"))),
+            "5'h10 + x");
+}
+
 TEST(BasicTests, TestCast) {
   vAST::NumericLiteral n8("z", vAST::Radix::HEX);
   vAST::Cast cast(5, vAST::make_id("x"));
@@ -62,11 +174,29 @@ TEST(BasicTests, TestAttribute) {
 TEST(BasicTests, TestIdentifierEscaped) {
   vAST::Identifier id("instance[5]");
   EXPECT_EQ(id.toString(), "\\instance[5] ");
+  // The name is stored unescaped
+  EXPECT_EQ(id.value, "instance[5]");
+  // Escaping follows names assigned after construction
+  id.value = "x";
+  EXPECT_EQ(id.toString(), "x");
+  id.value = "a.b";
+  EXPECT_EQ(id.toString(), "\\a.b ");
+  EXPECT_TRUE(vAST::Identifier::needsEscape("1x"));
+  EXPECT_TRUE(vAST::Identifier::needsEscape(""));
+  EXPECT_FALSE(vAST::Identifier::needsEscape("$x_1"));
+  // Symbols carry the flag, computed when the name is interned
+  EXPECT_TRUE(vAST::Symbol("a.b").needsEscape());
+  EXPECT_TRUE(vAST::Symbol("or").needsEscape());
+  EXPECT_FALSE(vAST::Symbol("x").needsEscape());
 }
 
 TEST(BasicTests, TestIdentifierKeyword) {
   vAST::Identifier id("or");
   EXPECT_EQ(id.toString(), "\\or ");
+  EXPECT_TRUE(vAST::Identifier::needsEscape("always_comb"));
+  EXPECT_TRUE(vAST::Identifier::needsEscape("pulsestyle_ondetect"));
+  EXPECT_FALSE(vAST::Identifier::needsEscape("OR"));
+  EXPECT_FALSE(vAST::Identifier::needsEscape("ors"));
 }
 
 TEST(BasicTests, TestString) {
@@ -365,6 +495,13 @@ TEST(BasicTests, TestModule) {
       ");\n"
       "endmodule\n";
   EXPECT_EQ(module.toString(), expected_str);
+  EXPECT_EQ(module.emitModuleHeader(),
+            "module test_module #(\n"
+            "    parameter [3:0] param1 = 1\n"
+            ") (\n"
+            "    input i,\n"
+            "    output o\n"
+            ");\n");
 }
 
 TEST(BasicTests, TestParamModule) {
@@ -608,7 +745,7 @@ TEST(BasicTests, TestNumCopy) {
       std::make_unique<vAST::NumericLiteral>(*x);
   EXPECT_EQ(x->toString(), "32'hDEADBEEF");
   EXPECT_EQ(x1->toString(), "32'hDEADBEEF");
-  x1->value = "3b010";
+  x1->setValue("3b010");
   EXPECT_EQ(x->toString(), "32'hDEADBEEF");
   EXPECT_EQ(x1->toString(), "3b010");
 }
@@ -861,6 +998,406 @@ TEST(BasicTests, TestIfDefElse) {
             "`endif");
 }
 
+TEST(BasicTests, TestNestedIf) {
+  std::vector<std::unique_ptr<vAST::BehavioralStatement>> inner_body;
+  inner_body.push_back(std::make_unique<vAST::BlockingAssign>(
+      vAST::make_id("a"), vAST::make_id("b")));
+  // Blank lines inside a nested statement are indented too
+  inner_body.push_back(std::make_unique<vAST::BlockComment>("x\n\ny"));
+
+  std::vector<std::unique_ptr<vAST::BehavioralStatement>> inner_else;
+  inner_else.push_back(std::make_unique<vAST::BlockingAssign>(
+      vAST::make_id("a"), vAST::make_id("c")));
+
+  std::vector<std::unique_ptr<vAST::BehavioralStatement>> outer_body;
+  outer_body.push_back(std::make_unique<vAST::If>(
+      vAST::make_id("y"), std::move(inner_body), std::move(inner_else)));
+  outer_body.push_back(
+      std::make_unique<vAST::CallStmt>("$finish"));
+
+  vAST::If if_stmt(vAST::make_id("x"), std::move(outer_body),
+                   std::vector<std::unique_ptr<vAST::BehavioralStatement>>{});
+  EXPECT_EQ(if_stmt.toString(),
+            "if (x) begin\n"
+            "    if (y) begin\n"
+            "        a = b;\n"
+            "        /*\n"
+            "        x\n"
+            "        \n"
+            "        y\n"
+            "        */\n"
+            "    end else begin\n"
+            "        a = c;\n"
+            "    end\n"
+            "    $finish();\n"
+            "end");
+}
+
+TEST(BasicTests, TestEmitSinks) {
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  modules.push_back(std::make_unique<vAST::Module>(
+      "test_module0", make_simple_ports(), make_simple_body()));
+  modules.push_back(std::make_unique<vAST::StringModule>(
+      "module test_module1 ();\nendmodule\n"));
+  vAST::File file(modules);
+  std::string expected = file.toString();
+
+  std::ostringstream stream;
+  vAST::OStreamSink ostream_sink(stream);
+  file.emit(ostream_sink);
+  EXPECT_EQ(stream.str(), expected);
+
+  // StringSink appends to the existing contents
+  std::string buffer = "// header\n";
+  vAST::StringSink string_sink(buffer);
+  file.emit(string_sink);
+  EXPECT_EQ(buffer, "// header\n" + expected);
+
+  // Use a tiny buffer so both the buffered and write-through paths are hit
+  FILE *tmp = std::tmpfile();
+  {
+    vAST::FdSink fd_sink(fileno(tmp), 16);
+    file.emit(fd_sink);
+  }
+  std::rewind(tmp);
+  std::string contents;
+  char chunk[256];
+  size_t read;
+  while ((read = std::fread(chunk, 1, sizeof(chunk), tmp)) > 0) {
+    contents.append(chunk, read);
+  }
+  std::fclose(tmp);
+  EXPECT_EQ(contents, expected);
+}
+
+TEST(BasicTests, TestNodeKind) {
+  std::unique_ptr<vAST::Expression> id = vAST::make_id("x");
+  std::unique_ptr<vAST::Expression> index =
+      std::make_unique<vAST::Index>(vAST::make_id("x"), vAST::make_num("0"));
+  EXPECT_EQ(id->getKind(), vAST::NodeKind::Identifier);
+  EXPECT_TRUE(vAST::isa<vAST::Identifier>(id));
+  EXPECT_TRUE(vAST::isa<vAST::Expression>(id.get()));
+  EXPECT_FALSE(vAST::isa<vAST::Index>(id));
+  EXPECT_EQ(vAST::dyn_cast<vAST::Index>(index.get()), index.get());
+  EXPECT_EQ(vAST::dyn_cast<vAST::Slice>(index.get()), nullptr);
+  std::unique_ptr<vAST::Expression> null;
+  EXPECT_FALSE(vAST::isa<vAST::Expression>(null));
+
+  // Both bases of a statement with multiple inheritance report the same kind
+  std::unique_ptr<vAST::StructuralStatement> assign =
+      std::make_unique<vAST::ContinuousAssign>(vAST::make_id("a"),
+                                               vAST::make_id("b"));
+  EXPECT_TRUE(vAST::isa<vAST::ContinuousAssign>(assign));
+  EXPECT_TRUE(vAST::isa<vAST::Assign>(
+      vAST::dyn_cast<vAST::ContinuousAssign>(assign.get())));
+  std::unique_ptr<vAST::BehavioralStatement> comment =
+      std::make_unique<vAST::SingleLineComment>("x");
+  EXPECT_TRUE(vAST::isa<vAST::SingleLineComment>(comment));
+  EXPECT_TRUE(vAST::isa<vAST::StructuralStatement>(comment.get()));
+  std::unique_ptr<vAST::BehavioralStatement> blocking =
+      std::make_unique<vAST::BlockingAssign>(vAST::make_id("a"),
+                                             vAST::make_id("b"));
+  EXPECT_TRUE(vAST::isa<vAST::BehavioralAssign>(blocking));
+  EXPECT_FALSE(vAST::isa<vAST::StructuralStatement>(blocking.get()));
+
+  // Subclasses are instances of their bases
+  std::unique_ptr<vAST::Vector> vec = std::make_unique<vAST::PackedNDVector>(
+      vAST::make_id("x"), vAST::make_num("1"), vAST::make_num("0"),
+      std::vector<std::pair<std::unique_ptr<vAST::Expression>,
+                            std::unique_ptr<vAST::Expression>>>());
+  EXPECT_TRUE(vAST::isa<vAST::NDVector>(vec));
+  std::unique_ptr<vAST::AbstractModule> module =
+      std::make_unique<vAST::StringBodyModule>(
+          "m", std::vector<std::unique_ptr<vAST::AbstractPort>>(), "",
+          vAST::Parameters());
+  EXPECT_TRUE(vAST::isa<vAST::Module>(module));
+  EXPECT_FALSE(vAST::isa<vAST::StringModule>(module));
+  EXPECT_TRUE(vAST::isa<vAST::IfMacro>(std::make_unique<vAST::IfNDef>(
+      "X", std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                                    std::unique_ptr<vAST::Declaration>>>())));
+}
+
+TEST(BasicTests, TestNodeKindCasts) {
+  // A Node * to an assign or comment may point to either Node subobject, so
+  // casts from it must find the right one
+  auto assign = std::make_unique<vAST::ContinuousAssign>(vAST::make_id("a"),
+                                                         vAST::make_id("b"));
+  const vAST::Node *structural =
+      static_cast<vAST::StructuralStatement *>(assign.get());
+  const vAST::Node *base = static_cast<vAST::Assign *>(assign.get());
+  const vAST::Assign *expected = assign.get();
+  EXPECT_EQ(vAST::dyn_cast<vAST::Assign>(structural), expected);
+  EXPECT_EQ(vAST::dyn_cast<vAST::Assign>(base), expected);
+  EXPECT_EQ(vAST::dyn_cast<vAST::ContinuousAssign>(structural), assign.get());
+  EXPECT_EQ(vAST::dyn_cast<vAST::ContinuousAssign>(base), assign.get());
+  EXPECT_TRUE(structural->structurallyEqual(*base));
+
+  auto comment = std::make_unique<vAST::SingleLineComment>("x");
+  const vAST::Node *behavioral =
+      static_cast<vAST::BehavioralStatement *>(comment.get());
+  EXPECT_EQ(vAST::dyn_cast<vAST::SingleLineComment>(behavioral),
+            comment.get());
+  const vAST::StructuralStatement *expected_structural = comment.get();
+  EXPECT_EQ(vAST::dyn_cast<vAST::StructuralStatement>(behavioral),
+            expected_structural);
+}
+
+// Downstream subclasses of Assign and IfMacro use the constructors without a
+// NodeKind
+class MyAssign : public vAST::Assign {
+ public:
+  MyAssign(std::unique_ptr<vAST::Identifier> target,
+           std::unique_ptr<vAST::Expression> value)
+      : vAST::Assign(std::move(target), std::move(value), "force ", "="){};
+};
+
+class IfVerilator : public vAST::IfMacro {
+  std::string getMacroString() const { return "`ifdef VERILATOR // "; };
+
+ public:
+  using vAST::IfMacro::IfMacro;
+};
+
+TEST(BasicTests, TestCustomSubclasses) {
+  MyAssign assign(vAST::make_id("a"), vAST::make_id("b"));
+  const vAST::Node *node = &assign;
+  EXPECT_EQ(node->getKind(), vAST::NodeKind::Assign);
+  EXPECT_EQ(vAST::dyn_cast<vAST::Assign>(node), &assign);
+  EXPECT_TRUE(assign.structurallyEqual(
+      MyAssign(vAST::make_id("a"), vAST::make_id("b"))));
+  EXPECT_EQ(assign.toString(), "force a = b;");
+
+  std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                           std::unique_ptr<vAST::Declaration>>>
+      body;
+  body.push_back(std::make_unique<vAST::SingleLineComment>("x"));
+  IfVerilator macro("", std::move(body));
+  EXPECT_EQ(macro.getKind(), vAST::NodeKind::IfMacro);
+  EXPECT_TRUE(vAST::isa<vAST::IfMacro>(&macro));
+  EXPECT_EQ(macro.toString(), "`ifdef VERILATOR // \n// x\n`endif");
+
+  // Expressions and statements use the kinds reserved for them
+  SystemTime time;
+  EXPECT_EQ(time.getKind(), vAST::NodeKind::Expression);
+  const vAST::Node *time_node = &time;
+  EXPECT_TRUE(vAST::isa<vAST::Expression>(time_node));
+  EXPECT_TRUE(time.structurallyEqual(SystemTime()));
+  EXPECT_EQ(time.hash(), SystemTime().hash());
+  EXPECT_FALSE(time.structurallyEqual(*vAST::make_id("x")));
+  DefaultNettype nettype;
+  Finish finish;
+  EXPECT_EQ(nettype.getKind(), vAST::NodeKind::StructuralStatement);
+  EXPECT_EQ(finish.getKind(), vAST::NodeKind::BehavioralStatement);
+  EXPECT_FALSE(vAST::isa<vAST::BehavioralStatement>(
+      static_cast<const vAST::Node *>(&nettype)));
+  EXPECT_FALSE(vAST::isa<vAST::StructuralStatement>(
+      static_cast<const vAST::Node *>(&finish)));
+}
+
+TEST(BasicTests, TestParallelFileEmit) {
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  for (int i = 0; i < 50; i++) {
+    if (i % 5 == 0) {
+      modules.push_back(std::make_unique<vAST::StringModule>(
+          "module string_module" + std::to_string(i) + " ();\nendmodule\n"));
+    } else {
+      modules.push_back(std::make_unique<vAST::Module>(
+          "test_module" + std::to_string(i), make_simple_ports(),
+          make_simple_body(), make_simple_params()));
+    }
+  }
+  vAST::File file(modules);
+  std::string expected = file.toString();
+
+  for (unsigned int num_threads : {0, 1, 2, 7, 64}) {
+    EXPECT_EQ(file.toString(num_threads), expected);
+  }
+
+  std::string buffer = "// header\n";
+  vAST::StringSink string_sink(buffer);
+  file.emit(string_sink, 4);
+  EXPECT_EQ(buffer, "// header\n" + expected);
+
+  // Options reach the sinks of the worker threads
+  std::vector<std::unique_ptr<vAST::AbstractModule>> literal_modules;
+  for (int i = 0; i < 8; i++) {
+    vAST::Parameters params;
+    params.push_back(std::make_pair(
+        vAST::make_id("param0"),
+        std::make_unique<vAST::NumericLiteral>("11111111", 8, false,
+                                               vAST::BINARY)));
+    literal_modules.push_back(std::make_unique<vAST::Module>(
+        "test_module" + std::to_string(i), make_simple_ports(),
+        make_simple_body(), std::move(params)));
+  }
+  vAST::File literal_file(literal_modules);
+  vAST::EmitOptions options;
+  options.shortest_literals = true;
+  std::string serial;
+  vAST::StringSink serial_sink(serial);
+  serial_sink.setOptions(options);
+  literal_file.emit(serial_sink);
+  EXPECT_NE(serial.find("8'hff"), std::string::npos);
+  std::string parallel;
+  vAST::StringSink parallel_sink(parallel);
+  parallel_sink.setOptions(options);
+  literal_file.emit(parallel_sink, 4);
+  EXPECT_EQ(parallel, serial);
+}
+
+// Counts how many modules have started rendering
+class CountingModule : public vAST::StringModule {
+ public:
+  std::atomic<int> &started;
+
+  CountingModule(std::string definition, std::atomic<int> &started)
+      : vAST::StringModule(definition), started(started){};
+
+  void emit(vAST::Sink &sink) const override {
+    this->started++;
+    vAST::StringModule::emit(sink);
+  }
+};
+
+// Slow sink that records how far rendering got ahead of it
+class SlowSink : public vAST::Sink {
+  std::atomic<int> &started;
+
+ protected:
+  void put(const char *data, std::size_t size) override {
+    if (std::string(data, size).find("endmodule") == std::string::npos) return;
+    this->max_ahead = std::max(this->max_ahead, this->started - this->written);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    this->written++;
+  }
+
+ public:
+  int written = 0;
+  int max_ahead = 0;
+
+  explicit SlowSink(std::atomic<int> &started) : started(started){};
+};
+
+TEST(BasicTests, TestParallelFileEmitBackpressure) {
+  std::atomic<int> started{0};
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  for (int i = 0; i < 100; i++) {
+    modules.push_back(std::make_unique<CountingModule>(
+        "module m" + std::to_string(i) + " ();\nendmodule\n", started));
+  }
+  vAST::File file(modules);
+  SlowSink sink(started);
+  file.emit(sink, 4);
+  EXPECT_EQ(sink.written, 100);
+  // At most twice the number of threads are rendered ahead of the sink
+  EXPECT_LE(sink.max_ahead, 8);
+}
+
+TEST(BasicTests, TestFileEmitAndRelease) {
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  modules.push_back(std::make_unique<vAST::Module>(
+      "test_module0", make_simple_ports(), make_simple_body()));
+  modules.push_back(std::make_unique<vAST::StringModule>(
+      "module test_module1 ();\nendmodule\n"));
+  modules.push_back(std::make_unique<vAST::Module>(
+      "test_module2", make_simple_ports(), make_simple_body(),
+      make_simple_params()));
+  vAST::File file(modules);
+  std::string expected = file.toString();
+
+  std::ostringstream stream;
+  vAST::OStreamSink sink(stream);
+  file.emitAndRelease(sink);
+  EXPECT_EQ(stream.str(), expected);
+  EXPECT_TRUE(file.modules.empty());
+}
+
+// Fails once `name` is written
+class FailingSink : public vAST::Sink {
+  std::string name;
+
+ protected:
+  void put(const char *data, std::size_t size) override {
+    if (std::string(data, size).find(this->name) != std::string::npos) {
+      throw std::runtime_error("write failed");
+    }
+  }
+
+ public:
+  explicit FailingSink(std::string name) : name(name){};
+};
+
+TEST(BasicTests, TestFileEmitAndReleaseThrows) {
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  for (int i = 0; i < 4; i++) {
+    modules.push_back(std::make_unique<vAST::StringModule>(
+        "module test_module" + std::to_string(i) + " ();\nendmodule\n"));
+  }
+  vAST::File file(modules);
+  FailingSink sink("test_module2");
+  EXPECT_THROW(file.emitAndRelease(sink), std::runtime_error);
+  // The written modules are gone, the rest can still be emitted
+  ASSERT_EQ(file.modules.size(), 2u);
+  EXPECT_EQ(file.toString(),
+            "module test_module2 ();\nendmodule\n\n"
+            "module test_module3 ();\nendmodule\n");
+}
+
+TEST(BasicTests, TestStructuralHash) {
+  auto make_expr = [](const char *op_arg, vAST::BinOp::BinOp op) {
+    return vAST::make_binop(
+        std::make_unique<vAST::Index>(vAST::make_id("a"), vAST::make_num("0")),
+        op, vAST::make_num(op_arg));
+  };
+  auto x = make_expr("1", vAST::BinOp::ADD);
+  auto y = make_expr("1", vAST::BinOp::ADD);
+  EXPECT_EQ(x->hash(), y->hash());
+  EXPECT_TRUE(x->structurallyEqual(*y));
+  EXPECT_FALSE(x->structurallyEqual(*make_expr("1", vAST::BinOp::SUB)));
+  EXPECT_FALSE(x->structurallyEqual(*make_expr("2", vAST::BinOp::ADD)));
+  EXPECT_FALSE(x->structurallyEqual(*vAST::make_id("a")));
+
+  // Cached hashes are invalidated after mutating a node in place
+  auto z = make_expr("1", vAST::BinOp::ADD);
+  std::size_t hash = z->hash();
+  static_cast<vAST::NumericLiteral &>(*z->right).setValue("2");
+  z->invalidateHash();
+  EXPECT_NE(z->hash(), hash);
+  EXPECT_FALSE(x->structurallyEqual(*z));
+
+  std::unordered_set<std::unique_ptr<vAST::Expression>, vAST::StructuralHash,
+                     vAST::StructuralEqual>
+      exprs;
+  exprs.insert(std::move(x));
+  exprs.insert(std::move(y));
+  exprs.insert(std::move(z));
+  EXPECT_EQ(exprs.size(), 2u);
+
+  // Statements, including those with more than one Node base
+  vAST::ContinuousAssign assign0(vAST::make_id("a"), vAST::make_id("b"));
+  vAST::ContinuousAssign assign1(vAST::make_id("a"), vAST::make_id("b"));
+  vAST::BlockingAssign assign2(vAST::make_id("a"), vAST::make_id("b"));
+  EXPECT_EQ(assign0.hash(), assign1.hash());
+  EXPECT_TRUE(assign0.structurallyEqual(
+      static_cast<vAST::StructuralStatement &>(assign1)));
+  EXPECT_FALSE(assign0.structurallyEqual(
+      static_cast<vAST::BehavioralStatement &>(assign2)));
+  vAST::SingleLineComment comment0("x");
+  vAST::SingleLineComment comment1("x");
+  EXPECT_TRUE(comment0.structurallyEqual(
+      static_cast<vAST::BehavioralStatement &>(comment1)));
+
+  vAST::Module module0("test_module", make_simple_ports(), make_simple_body(),
+                       make_simple_params());
+  vAST::Module module1("test_module", make_simple_ports(), make_simple_body(),
+                       make_simple_params());
+  EXPECT_EQ(module0.hash(), module1.hash());
+  EXPECT_TRUE(module0.structurallyEqual(module1));
+  vAST::Module module2("other_module", make_simple_ports(), make_simple_body(),
+                       make_simple_params());
+  EXPECT_FALSE(module0.structurallyEqual(module2));
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
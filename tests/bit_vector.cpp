@@ -0,0 +1,48 @@
+#include "verilogAST/bit_vector.hpp"
+#include "gtest/gtest.h"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+TEST(BitVectorTests, TestParse) {
+  auto bits = vAST::BitVector::parse("1010_0101", 2, 8);
+  ASSERT_TRUE(bits);
+  EXPECT_EQ(bits->toUInt64(), 0xa5u);
+  EXPECT_EQ(vAST::BitVector::parse("777", 8, 9)->toUInt64(), 0777u);
+  EXPECT_EQ(vAST::BitVector::parse("Ff", 16, 8)->toUInt64(), 0xffu);
+  // Truncated to the width
+  EXPECT_EQ(vAST::BitVector::parse("1ff", 16, 8)->toUInt64(), 0xffu);
+  EXPECT_EQ(vAST::BitVector::parse("300", 10, 8)->toUInt64(), 44u);
+  EXPECT_FALSE(vAST::BitVector::parse("12", 2, 8));
+  EXPECT_FALSE(vAST::BitVector::parse("1x", 16, 8));
+  EXPECT_FALSE(vAST::BitVector::parse("_", 10, 8));
+}
+
+TEST(BitVectorTests, TestWide) {
+  auto bits = vAST::BitVector::parse("ffff_ffff_ffff_ffff_f", 16, 128);
+  ASSERT_TRUE(bits);
+  EXPECT_EQ(bits->activeBits(), 68u);
+  EXPECT_FALSE(bits->fitsUInt64());
+  EXPECT_EQ(bits->toString(10), "295147905179352825855");
+  EXPECT_EQ(bits->toString(2), std::string(68, '1'));
+  EXPECT_EQ(*bits, *vAST::BitVector::parse("295147905179352825855", 10, 128));
+  EXPECT_EQ(bits->hash(),
+            vAST::BitVector::parse("295147905179352825855", 10, 128)->hash());
+
+  bits->resize(64);
+  EXPECT_EQ(bits->toUInt64(), ~0ULL);
+  bits->resize(200);
+  EXPECT_EQ(bits->toString(16), "ffffffffffffffff");
+  bits->resize(4);
+  EXPECT_EQ(bits->toString(8), "17");
+  EXPECT_EQ(vAST::BitVector(70).toString(10), "0");
+  EXPECT_TRUE(vAST::BitVector(70).isZero());
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -94,3 +94,46 @@ make_simple_always_body() {
 
   return body;
 }
+
+// Nodes defined outside the library, which passes leave as they are
+class SystemTime : public vAST::Expression {
+ protected:
+  SystemTime *clone_impl() const override { return new SystemTime(); }
+
+ public:
+  void emit(vAST::Sink &sink) const override { sink << "$time"; }
+};
+
+class DefaultNettype : public vAST::StructuralStatement {
+ public:
+  void emit(vAST::Sink &sink) const override {
+    sink << "`default_nettype none";
+  }
+};
+
+class Finish : public vAST::BehavioralStatement {
+ public:
+  void emit(vAST::Sink &sink) const override { sink << "$finish;"; }
+};
+
+std::unique_ptr<vAST::Module> make_custom_node_module() {
+  std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                           std::unique_ptr<vAST::Declaration>>>
+      body;
+  body.push_back(std::make_unique<DefaultNettype>());
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("x"), vAST::make_binop(vAST::make_id("x"), vAST::BinOp::ADD,
+                                           std::make_unique<SystemTime>())));
+  std::vector<std::unique_ptr<vAST::BehavioralStatement>> always_body;
+  always_body.push_back(std::make_unique<Finish>());
+  std::vector<std::variant<
+      std::unique_ptr<vAST::Identifier>, std::unique_ptr<vAST::PosEdge>,
+      std::unique_ptr<vAST::NegEdge>, std::unique_ptr<vAST::Star>>>
+      sensitivity_list;
+  sensitivity_list.push_back(
+      std::make_unique<vAST::PosEdge>(vAST::make_id("x")));
+  body.push_back(std::make_unique<vAST::Always>(std::move(sensitivity_list),
+                                                std::move(always_body)));
+  return std::make_unique<vAST::Module>("test_module", make_simple_ports(),
+                                        std::move(body));
+}
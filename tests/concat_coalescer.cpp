@@ -16,6 +16,7 @@ auto makeVector(std::string name, int hi, int lo) {
                                         vAST::make_num(std::to_string(lo)));
 }
 
+template <typename Coalescer = vAST::ConcatCoalescer>
 void runTest(std::array<int, 8> indices, std::string pre, std::string post) {
   std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
   ports.push_back(std::make_unique<vAST::Port>(makeVector("I", 7, 0),
@@ -46,7 +47,7 @@ void runTest(std::array<int, 8> indices, std::string pre, std::string post) {
   EXPECT_EQ(module->toString(), pre);
 
   // Run ConcatCoalescer transformer.
-  vAST::ConcatCoalescer transformer;
+  Coalescer transformer;
   module = transformer.visit(std::move(module));
 
   EXPECT_EQ(module->toString(), post);
@@ -88,6 +89,24 @@ TEST(ConcatCoalescerTests, TestMultipleRuns) {
   runTest({3, 4, 0, 1, 2, 5, 6, 7}, pre, post);
 }
 
+TEST(ConcatCoalescerTests, TestInPlace) {
+  auto pre =
+      "module test_module (\n"
+      "    input [7:0] I,\n"
+      "    output [7:0] O\n"
+      ");\n"
+      "assign O = {I[3],I[2],I[1],I[0],I[7],I[6],I[5],I[4]};\n"
+      "endmodule\n";
+  auto post =
+      "module test_module (\n"
+      "    input [7:0] I,\n"
+      "    output [7:0] O\n"
+      ");\n"
+      "assign O = {I[3:0],I[7:4]};\n"
+      "endmodule\n";
+  runTest<vAST::ConcatCoalescerInPlace>({4, 5, 6, 7, 0, 1, 2, 3}, pre, post);
+}
+
 TEST(ConcatCoalescerTests, TestNoRuns) {
   auto pre =
       "module test_module (\n"
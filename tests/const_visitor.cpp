@@ -0,0 +1,97 @@
+#include "verilogAST/const_visitor.hpp"
+#include <thread>
+#include "common.cpp"
+#include "gtest/gtest.h"
+#include "verilogAST/hash_cons.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+// Counts the identifiers of each name
+class IdentifierCounter : public vAST::ConstVisitor {
+ public:
+  std::map<std::string, int> counts;
+
+  using vAST::ConstVisitor::visit;
+  void visit(const vAST::Identifier &node) override {
+    this->counts[node.value.str()]++;
+  }
+};
+
+// Counts the binary operators
+class BinaryOpCounter : public vAST::ConstVisitor {
+ public:
+  int count = 0;
+
+  using vAST::ConstVisitor::visit;
+  void visit(const vAST::BinaryOp &node) override {
+    this->count++;
+    vAST::ConstVisitor::visit(node);
+  }
+};
+
+std::unique_ptr<vAST::Module> make_module() {
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("a"),
+                                               vAST::INPUT, vAST::WIRE));
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("o"),
+                                               vAST::OUTPUT, vAST::WIRE));
+  std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                           std::unique_ptr<vAST::Declaration>>>
+      body;
+  vAST::ExprInterner interner;
+  auto shared = interner.intern(
+      vAST::make_binop(vAST::make_id("a"), vAST::BinOp::ADD,
+                       vAST::make_num("1")));
+  auto shared_copy = shared->clone();
+  body.push_back(std::make_unique<vAST::Wire>(vAST::make_id("x")));
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("x"), vAST::make_binop(std::move(shared), vAST::BinOp::MUL,
+                                           std::move(shared_copy))));
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("o"), std::make_unique<vAST::Index>(vAST::make_id("x"),
+                                                        vAST::make_num("0"))));
+  return std::make_unique<vAST::Module>("test_module", std::move(ports),
+                                        std::move(body));
+}
+
+TEST(ConstVisitorTests, TestVisit) {
+  std::unique_ptr<const vAST::Module> module = make_module();
+  std::string before = module->toString();
+
+  IdentifierCounter identifiers;
+  identifiers.visit(*module);
+  // Shared expressions are visited as the expression they refer to
+  std::map<std::string, int> expected = {{"a", 3}, {"o", 2}, {"x", 3}};
+  EXPECT_EQ(identifiers.counts, expected);
+  EXPECT_EQ(module->toString(), before);
+}
+
+TEST(ConstVisitorTests, TestCustomNodes) {
+  // Nodes defined outside the library are skipped
+  IdentifierCounter identifiers;
+  identifiers.visit(*make_custom_node_module());
+  std::map<std::string, int> expected = {{"i", 1}, {"o", 1}, {"x", 3}};
+  EXPECT_EQ(identifiers.counts, expected);
+}
+
+TEST(ConstVisitorTests, TestConcurrent) {
+  std::unique_ptr<const vAST::Module> module = make_module();
+
+  // Several analyses walk the same module at once
+  std::vector<IdentifierCounter> identifiers(4);
+  std::vector<BinaryOpCounter> binary_ops(4);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&, i]() { identifiers[i].visit(*module); });
+    threads.emplace_back([&, i]() { binary_ops[i].visit(*module); });
+  }
+  for (auto &thread : threads) thread.join();
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(identifiers[i].counts, identifiers[0].counts);
+    EXPECT_EQ(binary_ops[i].count, 3);
+  }
+}
+
+}  // namespace
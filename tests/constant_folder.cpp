@@ -0,0 +1,279 @@
+#include "verilogAST/constant_folder.hpp"
+#include "common.cpp"
+#include "gtest/gtest.h"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+std::string fold(std::unique_ptr<vAST::Expression> expr,
+                 bool fold_identities = true) {
+  vAST::ConstantFolder folder(fold_identities);
+  return folder.visit(std::move(expr))->toString();
+}
+
+std::unique_ptr<vAST::NumericLiteral> num(
+    std::string value, unsigned int size, bool _signed = false,
+    vAST::Radix radix = vAST::Radix::DECIMAL) {
+  return std::make_unique<vAST::NumericLiteral>(value, size, _signed, radix);
+}
+
+std::unique_ptr<vAST::Expression> binop(
+    std::unique_ptr<vAST::Expression> left, vAST::BinOp::BinOp op,
+    std::unique_ptr<vAST::Expression> right) {
+  return vAST::make_binop(std::move(left), op, std::move(right));
+}
+
+std::unique_ptr<vAST::Expression> unop(
+    std::unique_ptr<vAST::Expression> operand, vAST::UnOp::UnOp op) {
+  return std::make_unique<vAST::UnaryOp>(std::move(operand), op);
+}
+
+std::unique_ptr<vAST::Expression> ternary(
+    std::unique_ptr<vAST::Expression> cond,
+    std::unique_ptr<vAST::Expression> true_value,
+    std::unique_ptr<vAST::Expression> false_value) {
+  return std::make_unique<vAST::TernaryOp>(
+      std::move(cond), std::move(true_value), std::move(false_value));
+}
+
+TEST(ConstantFolderTests, TestArithmetic) {
+  EXPECT_EQ(fold(binop(num("3", 8), vAST::BinOp::ADD, num("4", 8))), "8'd7");
+  EXPECT_EQ(fold(binop(vAST::make_num("3"), vAST::BinOp::ADD,
+                       vAST::make_num("4"))),
+            "7");
+  // Unsigned 32 bit results keep their size
+  EXPECT_EQ(fold(binop(vAST::make_num("3"), vAST::BinOp::ADD, num("4", 8))),
+            "32'd7");
+  EXPECT_EQ(fold(binop(num("2", 4), vAST::BinOp::MUL, num("7", 4))), "4'd14");
+  EXPECT_EQ(fold(binop(num("14", 4), vAST::BinOp::DIV, num("4", 4))), "4'd3");
+  EXPECT_EQ(fold(binop(num("14", 4), vAST::BinOp::MOD, num("4", 4))), "4'd2");
+  EXPECT_EQ(fold(binop(num("f0", 8, false, vAST::HEX), vAST::BinOp::OR,
+                       num("f", 4, false, vAST::HEX))),
+            "8'hff");
+  EXPECT_EQ(fold(binop(num("1", 8), vAST::BinOp::LSHIFT, num("3", 2))),
+            "8'd8");
+  EXPECT_EQ(fold(binop(num("70", 8, true, vAST::HEX), vAST::BinOp::ARSHIFT,
+                       vAST::make_num("4"))),
+            "8'sh7");
+  EXPECT_EQ(fold(binop(num("f0", 8, true, vAST::HEX), vAST::BinOp::AND,
+                       num("ff", 8, true, vAST::HEX))),
+            "8'shf0");
+  // Nested expressions fold in one pass
+  EXPECT_EQ(fold(binop(binop(num("1", 8), vAST::BinOp::ADD, num("2", 8)),
+                       vAST::BinOp::MUL, num("3", 8))),
+            "8'd9");
+
+  // Results that depend on the width they are evaluated at are kept
+  EXPECT_EQ(fold(binop(num("200", 8), vAST::BinOp::ADD, num("100", 8))),
+            "8'd200 + 8'd100");
+  EXPECT_EQ(fold(binop(num("3", 8), vAST::BinOp::SUB, num("4", 8))),
+            "8'd3 - 8'd4");
+  EXPECT_EQ(fold(binop(vAST::make_num("3"), vAST::BinOp::SUB,
+                       vAST::make_num("4"))),
+            "3 - 4");
+  EXPECT_EQ(fold(binop(num("1", 8), vAST::BinOp::LSHIFT, num("8", 4))),
+            "8'd1 << 4'd8");
+  EXPECT_EQ(fold(binop(num("f0", 8, true, vAST::HEX), vAST::BinOp::RSHIFT,
+                       vAST::make_num("4"))),
+            "8'shf0 >> 4");
+  // Signed in a signed context, but a logical shift in an unsigned one
+  EXPECT_EQ(fold(binop(num("f0", 8, true, vAST::HEX), vAST::BinOp::ARSHIFT,
+                       vAST::make_num("4"))),
+            "8'shf0 >>> 4");
+  EXPECT_EQ(fold(binop(num("1000", 4, true, vAST::BINARY), vAST::BinOp::AND,
+                       num("ff", 8, true, vAST::HEX))),
+            "4'sb1000 & 8'shff");
+  EXPECT_EQ(fold(binop(num("3", 8), vAST::BinOp::DIV, num("0", 8))),
+            "8'd3 / 8'd0");
+  EXPECT_EQ(fold(unop(num("0", 8), vAST::UnOp::INVERT)), "~ 8'd0");
+  EXPECT_EQ(fold(unop(num("1", 8, true), vAST::UnOp::MINUS)), "- 8'sd1");
+  // x/z digits and wide literals are not evaluated
+  EXPECT_EQ(fold(binop(num("x", 8, false, vAST::HEX), vAST::BinOp::ADD,
+                       num("1", 8)),
+                 false),
+            "8'hx + 8'd1");
+  EXPECT_EQ(fold(binop(num("1", 65), vAST::BinOp::ADD, num("1", 65))),
+            "65'd1 + 65'd1");
+}
+
+TEST(ConstantFolderTests, TestBool) {
+  EXPECT_EQ(fold(binop(num("3", 8), vAST::BinOp::LT, num("4", 8))), "1'b1");
+  EXPECT_EQ(fold(binop(num("1111", 4, true, vAST::BINARY), vAST::BinOp::LT,
+                       num("0", 4, true))),
+            "1'b1");
+  EXPECT_EQ(fold(binop(num("1111", 4, true, vAST::BINARY), vAST::BinOp::LT,
+                       num("0", 4))),
+            "1'b0");
+  EXPECT_EQ(fold(binop(num("200", 8), vAST::BinOp::EQ, num("200", 16))),
+            "1'b1");
+  EXPECT_EQ(fold(binop(num("2", 8), vAST::BinOp::GTE, num("3", 8))), "1'b0");
+  EXPECT_EQ(fold(binop(num("0", 8), vAST::BinOp::LOR, num("2", 8))), "1'b1");
+  EXPECT_EQ(fold(binop(num("0", 8), vAST::BinOp::LAND, num("2", 8))), "1'b0");
+  EXPECT_EQ(fold(unop(num("0", 8), vAST::UnOp::NOT)), "1'b1");
+  EXPECT_EQ(fold(unop(num("f", 4, false, vAST::HEX), vAST::UnOp::AND)),
+            "1'b1");
+  EXPECT_EQ(fold(unop(num("7", 4, false, vAST::HEX), vAST::UnOp::NAND)),
+            "1'b1");
+  EXPECT_EQ(fold(unop(num("101", 3, false, vAST::BINARY), vAST::UnOp::XOR)),
+            "1'b0");
+  EXPECT_EQ(fold(unop(num("100", 3, false, vAST::BINARY), vAST::UnOp::XNOR)),
+            "1'b0");
+  EXPECT_EQ(fold(unop(num("0", 3), vAST::UnOp::NOR)), "1'b1");
+}
+
+TEST(ConstantFolderTests, TestTernary) {
+  EXPECT_EQ(fold(ternary(vAST::make_num("1"), num("1", 4), num("2", 8))),
+            "8'd1");
+  EXPECT_EQ(fold(ternary(num("0", 1), num("1", 4), num("2", 8))), "8'd2");
+  // Sign extension of the chosen branch would depend on the context
+  EXPECT_EQ(fold(ternary(vAST::make_num("1"),
+                         num("1111", 4, true, vAST::BINARY),
+                         num("0", 8, true))),
+            "1 ? 4'sb1111 : 8'sd0");
+  // The widths of `a` and `b` are unknown, so either may be wider
+  EXPECT_EQ(fold(ternary(vAST::make_num("1"), vAST::make_id("a"),
+                         vAST::make_id("b"))),
+            "1 ? a : b");
+  auto eq = [] {
+    return binop(vAST::make_id("a"), vAST::BinOp::EQ, vAST::make_id("b"));
+  };
+  auto lt = [] {
+    return binop(vAST::make_id("c"), vAST::BinOp::LT, vAST::make_id("d"));
+  };
+  EXPECT_EQ(fold(ternary(vAST::make_num("1"), eq(), lt())), "a == b");
+  EXPECT_EQ(fold(ternary(binop(num("1", 8), vAST::BinOp::GT, num("2", 8)),
+                         eq(), lt())),
+            "c < d");
+  EXPECT_EQ(fold(ternary(vAST::make_num("1"), eq(), lt()), false),
+            "1 ? a == b : c < d");
+  // The result is as wide as the other branch
+  EXPECT_EQ(fold(ternary(vAST::make_num("1"), eq(), num("2", 8))),
+            "1 ? a == b : 8'd2");
+  // The result is unsigned
+  EXPECT_EQ(fold(ternary(vAST::make_num("0"), eq(),
+                         num("1", 1, true, vAST::BINARY))),
+            "0 ? a == b : 1'sb1");
+  EXPECT_EQ(fold(ternary(vAST::make_id("c"), vAST::make_id("a"),
+                         vAST::make_id("b"))),
+            "c ? a : b");
+}
+
+TEST(ConstantFolderTests, TestIdentities) {
+  auto x = [] { return vAST::make_id("x"); };
+  auto zero = [] { return vAST::make_num("0"); };
+  auto one = [] { return vAST::make_num("1"); };
+  // One bit signed literals never change the width or signedness
+  auto signed_zero = [] { return num("0", 1, true, vAST::BINARY); };
+  EXPECT_EQ(fold(binop(x(), vAST::BinOp::ADD, signed_zero())), "x");
+  EXPECT_EQ(fold(binop(signed_zero(), vAST::BinOp::ADD, x())), "x");
+  EXPECT_EQ(fold(binop(x(), vAST::BinOp::SUB, signed_zero())), "x");
+  EXPECT_EQ(fold(binop(signed_zero(), vAST::BinOp::SUB, x())), "1'sb0 - x");
+  EXPECT_EQ(fold(binop(x(), vAST::BinOp::OR, signed_zero())), "x");
+  EXPECT_EQ(fold(binop(x(), vAST::BinOp::XOR, signed_zero())), "x");
+  // `x` may be narrower than the literal
+  EXPECT_EQ(fold(binop(x(), vAST::BinOp::ADD, zero())), "x + 0");
+  EXPECT_EQ(fold(binop(x(), vAST::BinOp::AND, zero())), "x & 0");
+  EXPECT_EQ(fold(binop(x(), vAST::BinOp::MUL, one())), "x * 1");
+  EXPECT_EQ(fold(binop(x(), vAST::BinOp::MUL, num("1", 1))), "x * 1'd1");
+  // or wider
+  auto ones = [] { return num("ff", 8, false, vAST::HEX); };
+  EXPECT_EQ(fold(binop(x(), vAST::BinOp::AND, ones())), "x & 8'hff");
+  EXPECT_EQ(fold(binop(ones(), vAST::BinOp::OR, x())), "8'hff | x");
+
+  // Comparisons are one bit unsigned
+  auto eq = [] {
+    return binop(vAST::make_id("a"), vAST::BinOp::EQ, vAST::make_id("b"));
+  };
+  EXPECT_EQ(fold(binop(eq(), vAST::BinOp::ADD, num("0", 1))), "a == b");
+  EXPECT_EQ(fold(binop(eq(), vAST::BinOp::MUL, num("1", 1))), "a == b");
+  EXPECT_EQ(fold(binop(eq(), vAST::BinOp::DIV, num("1", 1))), "a == b");
+  EXPECT_EQ(fold(binop(num("1", 1), vAST::BinOp::DIV, eq())),
+            "1'd1 / (a == b)");
+  EXPECT_EQ(fold(binop(eq(), vAST::BinOp::AND, num("0", 8))), "8'd0");
+  EXPECT_EQ(fold(binop(eq(), vAST::BinOp::ADD, zero())), "(a == b) + 0");
+  // The result would be signed
+  EXPECT_EQ(fold(binop(eq(), vAST::BinOp::AND, zero())), "(a == b) & 0");
+  // The result would be wider
+  EXPECT_EQ(fold(binop(unop(eq(), vAST::UnOp::INVERT), vAST::BinOp::MUL,
+                       num("1", 8))),
+            "(~ (a == b)) * 8'd1");
+  // Folded operands enable identities
+  EXPECT_EQ(fold(binop(eq(), vAST::BinOp::ADD,
+                       binop(num("1", 1), vAST::BinOp::SUB, num("1", 1)))),
+            "a == b");
+
+  // These don't depend on the width of `x`
+  for (bool fold_identities : {false, true}) {
+    EXPECT_EQ(fold(binop(x(), vAST::BinOp::LSHIFT, zero()), fold_identities),
+              "x");
+    EXPECT_EQ(fold(binop(x(), vAST::BinOp::LAND, zero()), fold_identities),
+              "1'b0");
+    EXPECT_EQ(fold(binop(one(), vAST::BinOp::LOR, x()), fold_identities),
+              "1'b1");
+  }
+  EXPECT_EQ(fold(binop(x(), vAST::BinOp::LAND, one())), "x && 1");
+  EXPECT_EQ(fold(binop(x(), vAST::BinOp::ADD, signed_zero()), false),
+            "x + 1'sb0");
+  EXPECT_EQ(fold(binop(eq(), vAST::BinOp::AND, num("0", 8)), false),
+            "(a == b) & 8'd0");
+}
+
+TEST(ConstantFolderTests, TestModule) {
+  std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                           std::unique_ptr<vAST::Declaration>>>
+      body;
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("o"),
+      binop(binop(vAST::make_id("i"), vAST::BinOp::AND, vAST::make_num("0")),
+            vAST::BinOp::OR,
+            binop(num("3", 8), vAST::BinOp::ADD, num("4", 8)))));
+  std::unique_ptr<vAST::AbstractModule> module = std::make_unique<vAST::Module>(
+      "test_module", make_simple_ports(), std::move(body));
+
+  std::string expected =
+      "module test_module (\n"
+      "    input i,\n"
+      "    output o\n"
+      ");\n"
+      "assign o = (i & 0) | 8'd7;\n"
+      "endmodule\n";
+  vAST::ConstantFolder folder;
+  module = folder.visit(std::move(module));
+  EXPECT_EQ(module->toString(), expected);
+}
+
+// Passes are Transformers, so they can be used through the base class and
+// their visit overloads can be overridden
+class RenamingFolder : public vAST::ConstantFolder {
+ public:
+  using vAST::ConstantFolder::visit;
+  std::unique_ptr<vAST::Identifier> visit(
+      std::unique_ptr<vAST::Identifier> node) override {
+    return vAST::make_id(node->value + "_1");
+  }
+};
+
+TEST(ConstantFolderTests, TestTransformer) {
+  vAST::ConstantFolder folder;
+  vAST::Transformer &transformer = folder;
+  EXPECT_EQ(
+      transformer.visit(binop(num("3", 8), vAST::BinOp::ADD, num("4", 8)))
+          ->toString(),
+      "8'd7");
+
+  RenamingFolder renaming;
+  EXPECT_EQ(renaming
+                .visit(binop(vAST::make_id("x"), vAST::BinOp::ADD,
+                             binop(num("3", 8), vAST::BinOp::ADD,
+                                   num("4", 8))))
+                ->toString(),
+            "x_1 + 8'd7");
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
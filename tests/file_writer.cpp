@@ -0,0 +1,131 @@
+#include "verilogAST/file_writer.hpp"
+#include <unistd.h>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include "common.cpp"
+#include "gtest/gtest.h"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+std::unique_ptr<vAST::AbstractModule> make_module(int i) {
+  if (i % 3 == 0) {
+    return std::make_unique<vAST::StringModule>(
+        "module string_module" + std::to_string(i) + " ();\nendmodule\n");
+  }
+  return std::make_unique<vAST::Module>(
+      "test_module" + std::to_string(i), make_simple_ports(),
+      make_simple_body(), make_simple_params());
+}
+
+std::string make_expected(int num_modules) {
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  for (int i = 0; i < num_modules; i++) modules.push_back(make_module(i));
+  vAST::File file(modules);
+  return file.toString();
+}
+
+class ThrowingSink : public vAST::Sink {
+ protected:
+  void put(const char *, std::size_t) override {
+    throw std::runtime_error("disk full");
+  }
+};
+
+TEST(FileWriterTests, TestSink) {
+  const int num_modules = 20;
+  std::string expected = make_expected(num_modules);
+  for (bool background : {false, true}) {
+    // Small buffers so that many full buffers are handed off
+    for (std::size_t buffer_size : {1, 300, 1 << 20}) {
+      std::string result;
+      vAST::StringSink sink(result);
+      vAST::FileWriter writer(sink, background, buffer_size);
+      for (int i = 0; i < num_modules; i++) writer.append(make_module(i));
+      writer.close();
+      EXPECT_EQ(result, expected);
+    }
+  }
+}
+
+TEST(FileWriterTests, TestPath) {
+  const int num_modules = 20;
+  std::string expected = make_expected(num_modules);
+  char path[] = "/tmp/vast_file_writer_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  ::close(fd);
+  for (bool background : {false, true}) {
+    {
+      // Closed by the destructor
+      vAST::FileWriter writer(std::string(path), background, 256);
+      for (int i = 0; i < num_modules; i++) writer.append(make_module(i));
+    }
+    std::ifstream file(path);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    EXPECT_EQ(contents.str(), expected);
+  }
+  std::remove(path);
+}
+
+TEST(FileWriterTests, TestOptions) {
+  auto make_literal_module = []() {
+    vAST::Parameters params;
+    params.push_back(std::make_pair(
+        vAST::make_id("param0"),
+        std::make_unique<vAST::NumericLiteral>("11111111", 8, false,
+                                               vAST::BINARY)));
+    return std::make_unique<vAST::Module>("test_module", make_simple_ports(),
+                                          make_simple_body(),
+                                          std::move(params));
+  };
+  vAST::EmitOptions options;
+  options.shortest_literals = true;
+  std::string expected;
+  vAST::StringSink expected_sink(expected);
+  expected_sink.setOptions(options);
+  make_literal_module()->emit(expected_sink);
+  EXPECT_NE(expected.find("8'hff"), std::string::npos);
+
+  for (bool background : {false, true}) {
+    std::string result;
+    vAST::StringSink sink(result);
+    vAST::FileWriter writer(sink, background);
+    writer.setOptions(options);
+    writer.append(make_literal_module());
+    writer.close();
+    EXPECT_EQ(result, expected);
+  }
+}
+
+TEST(FileWriterTests, TestErrors) {
+  EXPECT_THROW(vAST::FileWriter("/nonexistent/dir/out.v"), std::runtime_error);
+
+  for (bool background : {false, true}) {
+    ThrowingSink sink;
+    vAST::FileWriter writer(sink, background, 1);
+    EXPECT_THROW(
+        {
+          for (int i = 0; i < 4; i++) writer.append(make_module(i));
+          writer.close();
+        },
+        std::runtime_error);
+  }
+
+  std::string result;
+  vAST::StringSink sink(result);
+  vAST::FileWriter writer(sink);
+  writer.close();
+  EXPECT_EQ(result, "");
+  EXPECT_THROW(writer.append(make_module(0)), std::runtime_error);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
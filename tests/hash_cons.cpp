@@ -0,0 +1,238 @@
+#include "verilogAST/hash_cons.hpp"
+#include "common.cpp"
+#include "gtest/gtest.h"
+#include "verilogAST/assign_inliner.hpp"
+#include "verilogAST/concat_coalescer.hpp"
+#include "verilogAST/mutating_visitor.hpp"
+#include "verilogAST/zext_coalescer.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+using BodyElement = std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                                 std::unique_ptr<vAST::Declaration>>;
+
+std::unique_ptr<vAST::Expression> make_sum() {
+  return vAST::make_binop(vAST::make_id("a"), vAST::BinOp::ADD,
+                          vAST::make_id("b"));
+}
+
+TEST(HashConsTests, TestIntern) {
+  vAST::ExprInterner interner;
+  auto expr = interner.intern(
+      vAST::make_binop(make_sum(), vAST::BinOp::MUL, make_sum()));
+  // a, b, a + b and the product
+  EXPECT_EQ(interner.size(), 4u);
+  EXPECT_EQ(expr->toString(), "(a + b) * (a + b)");
+
+  auto product = vAST::dyn_cast<vAST::BinaryOp>(expr->value.get());
+  ASSERT_NE(product, nullptr);
+  auto left = vAST::dyn_cast<vAST::SharedExpr>(product->left.get());
+  auto right = vAST::dyn_cast<vAST::SharedExpr>(product->right.get());
+  ASSERT_NE(left, nullptr);
+  ASSERT_NE(right, nullptr);
+  EXPECT_EQ(left->value, right->value);
+
+  // Equal expressions from other trees share the same node
+  auto sum = interner.intern(make_sum());
+  EXPECT_EQ(interner.size(), 4u);
+  EXPECT_EQ(sum->value, left->value);
+
+  // Clones refer to the same node, and compare equal to plain expressions
+  auto clone = expr->clone();
+  EXPECT_EQ(clone->value, expr->value);
+  auto plain = vAST::make_binop(make_sum(), vAST::BinOp::MUL, make_sum());
+  EXPECT_EQ(plain->hash(), expr->hash());
+  EXPECT_TRUE(plain->structurallyEqual(*expr));
+  EXPECT_TRUE(expr->structurallyEqual(*plain));
+}
+
+TEST(HashConsTests, TestStaticInterner) {
+  // The StaticTransformer core of ExprInterner can be used on its own
+  vAST::StaticExprInterner interner;
+  auto expr = interner.visit(std::unique_ptr<vAST::Expression>(
+      vAST::make_binop(make_sum(), vAST::BinOp::MUL, make_sum())));
+  EXPECT_EQ(interner.size(), 4u);
+  EXPECT_EQ(expr->toString(), "(a + b) * (a + b)");
+  ASSERT_TRUE(vAST::isa<vAST::SharedExpr>(expr));
+  auto product = vAST::dyn_cast<vAST::BinaryOp>(
+      vAST::strip_shared(expr.get()));
+  ASSERT_NE(product, nullptr);
+  EXPECT_EQ(vAST::dyn_cast<vAST::SharedExpr>(product->left.get())->value,
+            vAST::dyn_cast<vAST::SharedExpr>(product->right.get())->value);
+}
+
+TEST(HashConsTests, TestTransformer) {
+  vAST::ExprInterner interner;
+  std::unique_ptr<vAST::Expression> expr = interner.intern(
+      vAST::make_binop(make_sum(), vAST::BinOp::MUL, vAST::make_id("c")));
+  auto shared = vAST::dyn_cast<vAST::SharedExpr>(expr.get())->value;
+
+  // Unchanged expressions stay shared
+  vAST::Transformer identity;
+  expr = identity.visit(std::move(expr));
+  auto ptr = vAST::dyn_cast<vAST::SharedExpr>(expr.get());
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(ptr->value, shared);
+
+  // Rewrites see through references
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  for (auto name : {"a", "b", "c"}) {
+    ports.push_back(std::make_unique<vAST::Port>(vAST::make_id(name),
+                                                 vAST::INPUT, vAST::WIRE));
+  }
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("o"),
+                                               vAST::OUTPUT, vAST::WIRE));
+  std::vector<BodyElement> body;
+  body.push_back(std::make_unique<vAST::Wire>(vAST::make_id("x")));
+  body.push_back(
+      std::make_unique<vAST::ContinuousAssign>(vAST::make_id("x"), make_sum()));
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("o"), vAST::make_binop(vAST::make_id("x"),
+                                           vAST::BinOp::MUL,
+                                           vAST::make_id("c"))));
+  auto module = std::make_unique<vAST::Module>("test_module", std::move(ports),
+                                               std::move(body));
+  module = interner.visit(std::move(module));
+  vAST::AssignInliner inliner;
+  module = inliner.visit(std::move(module));
+  EXPECT_EQ(module->toString(),
+            "module test_module (\n"
+            "    input a,\n"
+            "    input b,\n"
+            "    input c,\n"
+            "    output o\n"
+            ");\n"
+            "assign o = (a + b) * c;\n"
+            "endmodule\n");
+
+  std::vector<std::unique_ptr<vAST::Expression>> args;
+  args.push_back(std::make_unique<vAST::Index>(vAST::make_id("I"),
+                                               vAST::make_num("1")));
+  args.push_back(std::make_unique<vAST::Index>(vAST::make_id("I"),
+                                               vAST::make_num("0")));
+  vAST::ConcatCoalescer coalescer;
+  auto concat = coalescer.visit(
+      interner.intern(std::make_unique<vAST::Concat>(std::move(args))));
+  EXPECT_EQ(concat->toString(), "I[1:0]");
+}
+
+// Renames a to c, counting the binary operators visited
+class CountingRenamer : public vAST::Transformer {
+ public:
+  int num_binops = 0;
+
+  using vAST::Transformer::visit;
+  std::unique_ptr<vAST::Identifier> visit(
+      std::unique_ptr<vAST::Identifier> node) override {
+    if (node->value == "a") return vAST::make_id("c");
+    return node;
+  }
+  std::unique_ptr<vAST::BinaryOp> visit(
+      std::unique_ptr<vAST::BinaryOp> node) override {
+    this->num_binops++;
+    return vAST::Transformer::visit(std::move(node));
+  }
+};
+
+class MutatingCountingRenamer : public vAST::MutatingVisitor {
+ public:
+  int num_binops = 0;
+
+  using vAST::MutatingVisitor::visit;
+  void visit(std::unique_ptr<vAST::Expression> &node) override {
+    auto id = vAST::dyn_cast<vAST::Identifier>(node.get());
+    if (id && id->value == "a") {
+      this->replace(node, vAST::make_id("c"));
+      return;
+    }
+    vAST::MutatingVisitor::visit(node);
+  }
+  void visit(vAST::BinaryOp &node) override {
+    this->num_binops++;
+    vAST::MutatingVisitor::visit(node);
+  }
+};
+
+// x1 = a + a, x2 = x1 + x1, ..., which has 2^depth - 1 paths to binary
+// operators but only `depth` distinct ones
+std::unique_ptr<vAST::Expression> make_dag(vAST::ExprInterner &interner,
+                                           int depth) {
+  std::unique_ptr<vAST::Expression> expr = interner.intern(vAST::make_id("a"));
+  for (int i = 0; i < depth; i++) {
+    auto copy = expr->clone();
+    expr = interner.intern(
+        vAST::make_binop(std::move(expr), vAST::BinOp::ADD, std::move(copy)));
+  }
+  return expr;
+}
+
+TEST(HashConsTests, TestMemoizedVisit) {
+  vAST::ExprInterner interner;
+  CountingRenamer renamer;
+  auto small = renamer.visitMemoized(make_dag(interner, 2));
+  EXPECT_EQ(small->toString(), "(c + c) + (c + c)");
+  EXPECT_EQ(renamer.num_binops, 2);
+  // The result is shared as well
+  auto sum = vAST::dyn_cast<vAST::SharedExpr>(small.get());
+  ASSERT_NE(sum, nullptr);
+  auto binop = vAST::dyn_cast<vAST::BinaryOp>(sum->value.get());
+  ASSERT_NE(binop, nullptr);
+  EXPECT_EQ(vAST::dyn_cast<vAST::SharedExpr>(binop->left.get())->value,
+            vAST::dyn_cast<vAST::SharedExpr>(binop->right.get())->value);
+
+  // Each shared node is visited once however deep the DAG is
+  renamer.num_binops = 0;
+  auto deep = renamer.visitMemoized(make_dag(interner, 40));
+  EXPECT_EQ(renamer.num_binops, 40);
+  renamer.num_binops = 0;
+  renamer.visitMemoized(std::move(deep));
+  EXPECT_EQ(renamer.num_binops, 40);
+
+  MutatingCountingRenamer mutating;
+  auto mutated = mutating.visitMemoized(make_dag(interner, 40));
+  EXPECT_EQ(mutating.num_binops, 40);
+  auto expected = renamer.visitMemoized(make_dag(interner, 2));
+  EXPECT_TRUE(mutating.visitMemoized(make_dag(interner, 2))
+                  ->structurallyEqual(*expected));
+}
+
+TEST(HashConsTests, TestLiteralPool) {
+  vAST::LiteralPool pool;
+  auto zero = pool.get(0);
+  EXPECT_EQ(zero->value, pool.get("0")->value);
+  EXPECT_NE(zero->value, pool.get("0", 1)->value);
+  EXPECT_EQ(pool.get("0", 1, false, vAST::BINARY)->toString(), "1'b0");
+  EXPECT_EQ(pool.size(), 3u);
+
+  // Coalescers take the literals they create from the pool
+  std::vector<std::unique_ptr<vAST::Expression>> args;
+  for (int i = 3; i >= 0; i--) {
+    if (i == 0) args.push_back(vAST::make_id("x"));
+    args.push_back(std::make_unique<vAST::Index>(
+        vAST::make_id("I"), vAST::make_num(std::to_string(i))));
+  }
+  vAST::ConcatCoalescer coalescer(&pool);
+  auto concat = coalescer.visit(std::unique_ptr<vAST::Expression>(
+      std::make_unique<vAST::Concat>(std::move(args))));
+  EXPECT_EQ(concat->toString(), "{I[3:1],x,I[0]}");
+  EXPECT_EQ(pool.size(), 5u);  // 1 and 3 were added
+
+  std::vector<std::unique_ptr<vAST::Expression>> zext_args;
+  zext_args.push_back(std::make_unique<vAST::NumericLiteral>("0", 1));
+  zext_args.push_back(std::make_unique<vAST::NumericLiteral>("0", 1));
+  zext_args.push_back(vAST::make_id("x"));
+  vAST::ZextCoalescer zext(false, &pool);
+  auto zext_concat = zext.visit(std::unique_ptr<vAST::Expression>(
+      std::make_unique<vAST::Concat>(std::move(zext_args))));
+  EXPECT_EQ(zext_concat->toString(), "{2'd0,x}");
+  EXPECT_EQ(pool.size(), 6u);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
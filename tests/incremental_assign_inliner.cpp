@@ -0,0 +1,152 @@
+#include "verilogAST/incremental_assign_inliner.hpp"
+#include "common.cpp"
+#include "gtest/gtest.h"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+std::unique_ptr<vAST::Module> make_module(
+    std::vector<vAST::IncrementalAssignInliner::Statement> body) {
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  for (auto name : {"a", "b"}) {
+    ports.push_back(std::make_unique<vAST::Port>(vAST::make_id(name),
+                                                 vAST::INPUT, vAST::WIRE));
+  }
+  for (auto name : {"o0", "o1", "o2"}) {
+    ports.push_back(std::make_unique<vAST::Port>(vAST::make_id(name),
+                                                 vAST::OUTPUT, vAST::WIRE));
+  }
+  return std::make_unique<vAST::Module>("test_module", std::move(ports),
+                                        std::move(body));
+}
+
+vAST::IncrementalAssignInliner::Statement wire(std::string name) {
+  return std::make_unique<vAST::Wire>(vAST::make_id(name));
+}
+
+vAST::IncrementalAssignInliner::Statement assign(
+    std::string target, std::unique_ptr<vAST::Expression> value) {
+  return std::make_unique<vAST::ContinuousAssign>(vAST::make_id(target),
+                                                  std::move(value));
+}
+
+std::unique_ptr<vAST::Expression> binop(std::string left, vAST::BinOp::BinOp op,
+                                        std::string right) {
+  return vAST::make_binop(vAST::make_id(left), op, vAST::make_id(right));
+}
+
+std::string header =
+    "module test_module (\n"
+    "    input a,\n"
+    "    input b,\n"
+    "    output o0,\n"
+    "    output o1,\n"
+    "    output o2\n"
+    ");\n";
+
+TEST(IncrementalAssignInlinerTests, TestEditCone) {
+  std::vector<vAST::IncrementalAssignInliner::Statement> body;
+  body.push_back(wire("x"));
+  body.push_back(assign("x", binop("a", vAST::BinOp::AND, "b")));
+  body.push_back(assign("o0", vAST::make_id("x")));
+  body.push_back(wire("y"));
+  body.push_back(assign("y", binop("a", vAST::BinOp::OR, "b")));
+  body.push_back(assign("o1", binop("y", vAST::BinOp::XOR, "a")));
+  body.push_back(assign("o2", vAST::make_id("a")));
+
+  vAST::IncrementalAssignInliner inliner(make_module(std::move(body)));
+  // The whole module is inlined first
+  EXPECT_EQ(inliner.update(), 7);
+  EXPECT_EQ(inliner.getModule().toString(),
+            header +
+                "assign o0 = a & b;\n"
+                "assign o1 = (a | b) ^ a;\n"
+                "assign o2 = a;\n"
+                "endmodule\n");
+
+  // Inputs do not couple statements, so o0 and o1 are not inlined again
+  inliner.insert(2, wire("z"));
+  inliner.insert(3, assign("z", binop("b", vAST::BinOp::ADD, "b")));
+  inliner.replace(4, assign("o2", binop("z", vAST::BinOp::XOR, "b")));
+  EXPECT_EQ(inliner.update(), 3);
+  EXPECT_EQ(inliner.getModule().toString(),
+            header +
+                "assign o0 = a & b;\n"
+                "assign o1 = (a | b) ^ a;\n"
+                "assign o2 = (b + b) ^ b;\n"
+                "endmodule\n");
+  EXPECT_EQ(inliner.update(), 0);
+}
+
+TEST(IncrementalAssignInlinerTests, TestEditFanOut) {
+  std::vector<vAST::IncrementalAssignInliner::Statement> body;
+  body.push_back(wire("w"));
+  body.push_back(assign("w", binop("a", vAST::BinOp::SUB, "b")));
+  body.push_back(assign("o0", binop("w", vAST::BinOp::AND, "a")));
+  body.push_back(assign("o1", binop("w", vAST::BinOp::OR, "b")));
+  body.push_back(assign("o2", binop("a", vAST::BinOp::XOR, "b")));
+
+  vAST::IncrementalAssignInliner inliner(make_module(std::move(body)));
+  EXPECT_EQ(inliner.update(), 5);
+  // w is read twice
+  EXPECT_EQ(inliner.getModule().toString(),
+            header +
+                "wire w;\n"
+                "assign w = a - b;\n"
+                "assign o0 = w & a;\n"
+                "assign o1 = w | b;\n"
+                "assign o2 = a ^ b;\n"
+                "endmodule\n");
+
+  // Now read once, its declaration, assign and remaining read are inlined
+  // again, o2 is not
+  inliner.replace(3, assign("o1", vAST::make_id("a")));
+  EXPECT_EQ(inliner.update(), 4);
+  EXPECT_EQ(inliner.getModule().toString(),
+            header +
+                "assign o0 = (a - b) & a;\n"
+                "assign o1 = a;\n"
+                "assign o2 = a ^ b;\n"
+                "endmodule\n");
+
+  inliner.erase(1);
+  EXPECT_EQ(inliner.update(), 0);
+  EXPECT_EQ(inliner.release()->toString(),
+            header +
+                "assign o0 = (a - b) & a;\n"
+                "assign o2 = a ^ b;\n"
+                "endmodule\n");
+}
+
+TEST(IncrementalAssignInlinerTests, TestIndexTarget) {
+  std::vector<vAST::IncrementalAssignInliner::Statement> body;
+  body.push_back(std::make_unique<vAST::Wire>(std::make_unique<vAST::Vector>(
+      vAST::make_id("x"), vAST::make_num("1"), vAST::make_num("0"))));
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      std::make_unique<vAST::Index>(vAST::make_id("x"), vAST::make_id("a")),
+      vAST::make_id("b")));
+  body.push_back(assign(
+      "o0", std::make_unique<vAST::Index>(vAST::make_id("x"),
+                                          vAST::make_num("0"))));
+  body.push_back(assign("o1", binop("a", vAST::BinOp::AND, "b")));
+  body.push_back(assign("o2", vAST::make_id("a")));
+
+  vAST::IncrementalAssignInliner inliner(make_module(std::move(body)));
+  EXPECT_EQ(inliner.update(), 5);
+
+  // The input `a` is only the index of a target, it does not couple the
+  // statements reading it
+  inliner.replace(4, assign("o2", binop("a", vAST::BinOp::XOR, "b")));
+  EXPECT_EQ(inliner.update(), 1);
+  EXPECT_EQ(inliner.getModule().toString(),
+            header +
+                "wire [1:0] x;\n"
+                "assign x[a] = b;\n"
+                "assign o0 = x[0];\n"
+                "assign o1 = a & b;\n"
+                "assign o2 = a ^ b;\n"
+                "endmodule\n");
+}
+
+}  // namespace
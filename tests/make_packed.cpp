@@ -17,7 +17,8 @@ Dim makeDim(std::unique_ptr<vAST::Expression> hi,
   return std::make_pair(std::move(hi), std::move(lo));
 }
 
-TEST(MakePackedTests, TestBasic) {
+template <typename Pass>
+void runTest() {
   std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
 
   auto make_dims = []() {
@@ -51,7 +52,7 @@ TEST(MakePackedTests, TestBasic) {
   EXPECT_EQ(module->toString(), pre);
 
   // Run MakePacked transformer.
-  vAST::MakePacked transformer {};
+  Pass transformer {};
   module = transformer.visit(std::move(module));
 
   auto post =
@@ -62,6 +63,10 @@ TEST(MakePackedTests, TestBasic) {
   EXPECT_EQ(module->toString(), post);
 }
 
+TEST(MakePackedTests, TestBasic) { runTest<vAST::MakePacked>(); }
+
+TEST(MakePackedTests, TestInPlace) { runTest<vAST::MakePackedInPlace>(); }
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -0,0 +1,123 @@
+#include "verilogAST/mutating_visitor.hpp"
+#include "common.cpp"
+#include "gtest/gtest.h"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+// Renames identifiers
+class Renamer : public vAST::MutatingVisitor {
+  std::string from;
+  std::string to;
+
+ public:
+  Renamer(std::string from, std::string to) : from(from), to(to){};
+
+  using vAST::MutatingVisitor::visit;
+  void visit(std::unique_ptr<vAST::Expression> &node) override {
+    auto id = vAST::dyn_cast<vAST::Identifier>(node.get());
+    if (id && id->value == this->from) {
+      this->replace(node, vAST::make_id(this->to));
+      return;
+    }
+    vAST::MutatingVisitor::visit(node);
+  }
+};
+
+TEST(MutatingVisitorTests, TestReplaceChild) {
+  // (a + b) * (c - d)
+  auto left = vAST::make_binop(vAST::make_id("a"), vAST::BinOp::ADD,
+                               vAST::make_id("b"));
+  auto right = vAST::make_binop(vAST::make_id("c"), vAST::BinOp::SUB,
+                                vAST::make_id("d"));
+  std::unique_ptr<vAST::Expression> expr =
+      vAST::make_binop(std::move(left), vAST::BinOp::MUL, std::move(right));
+  auto root = static_cast<vAST::BinaryOp *>(expr.get());
+  auto add = static_cast<vAST::BinaryOp *>(root->left.get());
+  auto sub = root->right.get();
+  auto a = add->left.get();
+  root->hash();
+
+  Renamer renamer("b", "x");
+  renamer.visit(expr);
+  EXPECT_EQ(expr->toString(), "(a + x) * (c - d)");
+  // Only the renamed identifier is replaced
+  EXPECT_EQ(expr.get(), root);
+  EXPECT_EQ(root->left.get(), add);
+  EXPECT_EQ(root->right.get(), sub);
+  EXPECT_EQ(add->left.get(), a);
+
+  // The hashes of its ancestors are recomputed
+  auto expected = vAST::make_binop(
+      vAST::make_binop(vAST::make_id("a"), vAST::BinOp::ADD,
+                       vAST::make_id("x")),
+      vAST::BinOp::MUL,
+      vAST::make_binop(vAST::make_id("c"), vAST::BinOp::SUB,
+                       vAST::make_id("d")));
+  EXPECT_EQ(expr->hash(), expected->hash());
+  EXPECT_EQ(sub->hash(), expected->right->hash());
+
+  // Nothing to rename
+  Renamer noop("y", "z");
+  expr = noop.visit(std::move(expr));
+  EXPECT_EQ(expr.get(), root);
+  EXPECT_EQ(expr->toString(), "(a + x) * (c - d)");
+}
+
+TEST(MutatingVisitorTests, TestModule) {
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("i"),
+                                               vAST::INPUT, vAST::WIRE));
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("o"),
+                                               vAST::OUTPUT, vAST::WIRE));
+  std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                           std::unique_ptr<vAST::Declaration>>>
+      body;
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("o"), std::make_unique<vAST::UnaryOp>(
+                              vAST::make_id("i"), vAST::UnOp::INVERT)));
+  std::unique_ptr<vAST::AbstractModule> module = std::make_unique<vAST::Module>(
+      "test_module", std::move(ports), std::move(body));
+  auto ptr = module.get();
+  auto assign = std::get<std::unique_ptr<vAST::StructuralStatement>>(
+                    static_cast<vAST::Module *>(ptr)->body[0])
+                    .get();
+
+  // Port names are not expressions, so the port is not renamed
+  Renamer renamer("i", "x");
+  module = renamer.visit(std::move(module));
+  EXPECT_EQ(module.get(), ptr);
+  EXPECT_EQ(std::get<std::unique_ptr<vAST::StructuralStatement>>(
+                static_cast<vAST::Module *>(ptr)->body[0])
+                .get(),
+            assign);
+  EXPECT_EQ(module->toString(),
+            "module test_module (\n"
+            "    input i,\n"
+            "    output o\n"
+            ");\n"
+            "assign o = ~ x;\n"
+            "endmodule\n");
+}
+
+TEST(MutatingVisitorTests, TestCustomNodes) {
+  // Nodes defined outside the library are left as they are
+  std::unique_ptr<vAST::AbstractModule> module = make_custom_node_module();
+  Renamer renamer("x", "y");
+  module = renamer.visit(std::move(module));
+  EXPECT_EQ(module->toString(),
+            "module test_module (\n"
+            "    input i,\n"
+            "    output o\n"
+            ");\n"
+            "`default_nettype none\n"
+            "assign x = y + ($time);\n"
+            "always @(posedge x) begin\n"
+            "$finish;\n"
+            "end\n"
+            "\n"
+            "endmodule\n");
+}
+
+}  // namespace
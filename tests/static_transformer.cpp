@@ -0,0 +1,130 @@
+#include "verilogAST/static_transformer.hpp"
+#include "common.cpp"
+#include "gtest/gtest.h"
+#include "verilogAST/hash_cons.hpp"
+#include "verilogAST/transformer.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+std::unique_ptr<vAST::Identifier> rename(
+    std::unique_ptr<vAST::Identifier> node) {
+  if (node->value == "c") return vAST::make_id("g");
+  if (node->value == "param0") return vAST::make_id("y");
+  return node;
+}
+
+class VirtualRename : public vAST::Transformer {
+ public:
+  using vAST::Transformer::visit;
+  std::unique_ptr<vAST::Identifier> visit(
+      std::unique_ptr<vAST::Identifier> node) override {
+    return rename(std::move(node));
+  }
+};
+
+class StaticRename : public vAST::StaticTransformer<StaticRename> {
+ public:
+  using vAST::StaticTransformer<StaticRename>::visit;
+  std::unique_ptr<vAST::Identifier> visit(
+      std::unique_ptr<vAST::Identifier> node) {
+    return rename(std::move(node));
+  }
+};
+
+// Replaces `x` with `z - w`
+class ReplaceNameWithExpr
+    : public vAST::StaticTransformer<ReplaceNameWithExpr> {
+ public:
+  using vAST::StaticTransformer<ReplaceNameWithExpr>::visit;
+  std::unique_ptr<vAST::Expression> visit(
+      std::unique_ptr<vAST::Expression> node) {
+    auto id = vAST::dyn_cast<vAST::Identifier>(node.get());
+    if (id && id->value == "x") {
+      return vAST::make_binop(vAST::make_id("z"), vAST::BinOp::SUB,
+                              vAST::make_id("w"));
+    }
+    return StaticTransformer::visit(std::move(node));
+  }
+};
+
+std::unique_ptr<vAST::File> make_file() {
+  std::vector<std::unique_ptr<vAST::AbstractPort>> ports;
+  ports.push_back(std::make_unique<vAST::Port>(vAST::make_id("i"), vAST::INPUT,
+                                               vAST::WIRE));
+  std::vector<std::pair<std::unique_ptr<vAST::Expression>,
+                        std::unique_ptr<vAST::Expression>>>
+      outer_dims;
+  outer_dims.push_back({vAST::make_id("c"), vAST::make_num("0")});
+  ports.push_back(std::make_unique<vAST::Port>(
+      std::make_unique<vAST::NDVector>(vAST::make_id("o"), vAST::make_num("3"),
+                                       vAST::make_id("c"),
+                                       std::move(outer_dims)),
+      vAST::OUTPUT, vAST::WIRE));
+
+  std::vector<std::variant<std::unique_ptr<vAST::StructuralStatement>,
+                           std::unique_ptr<vAST::Declaration>>>
+      body = make_simple_body();
+  body.push_back(std::make_unique<vAST::ContinuousAssign>(
+      vAST::make_id("c"), vAST::make_id("b")));
+  body.push_back(std::make_unique<vAST::Wire>(vAST::make_id("c")));
+  std::vector<std::variant<
+      std::unique_ptr<vAST::Identifier>, std::unique_ptr<vAST::PosEdge>,
+      std::unique_ptr<vAST::NegEdge>, std::unique_ptr<vAST::Star>>>
+      sensitivity_list;
+  sensitivity_list.push_back(
+      std::make_unique<vAST::PosEdge>(vAST::make_id("c")));
+  body.push_back(std::make_unique<vAST::Always>(std::move(sensitivity_list),
+                                                make_simple_always_body()));
+
+  std::vector<std::unique_ptr<vAST::AbstractModule>> modules;
+  modules.push_back(std::make_unique<vAST::Module>(
+      "test_module", std::move(ports), std::move(body), make_simple_params()));
+  modules.push_back(std::make_unique<vAST::StringBodyModule>(
+      "string_module", make_simple_ports(), "assign c = d;",
+      make_simple_params()));
+  return std::make_unique<vAST::File>(modules);
+}
+
+TEST(StaticTransformerTests, TestSameAsTransformer) {
+  VirtualRename virtual_rename;
+  StaticRename static_rename;
+  std::string expected = virtual_rename.visit(make_file())->toString();
+  EXPECT_EQ(static_rename.visit(make_file())->toString(), expected);
+  EXPECT_NE(make_file()->toString(), expected);
+}
+
+TEST(StaticTransformerTests, TestReplaceNameWithExpr) {
+  std::vector<std::unique_ptr<vAST::Expression>> args;
+  args.push_back(vAST::make_id("x"));
+  args.push_back(vAST::make_id("y"));
+  std::unique_ptr<vAST::Expression> expr = vAST::make_binop(
+      std::make_unique<vAST::Concat>(std::move(args)), vAST::BinOp::MUL,
+      vAST::make_id("x"));
+  ReplaceNameWithExpr transformer;
+  EXPECT_EQ(transformer.visit(std::move(expr))->toString(),
+            "({z - w,y}) * (z - w)");
+}
+
+TEST(StaticTransformerTests, TestShared) {
+  vAST::ExprInterner interner;
+  std::unique_ptr<vAST::Expression> expr = interner.intern(vAST::make_binop(
+      vAST::make_id("a"), vAST::BinOp::ADD, vAST::make_id("b")));
+  auto shared = vAST::dyn_cast<vAST::SharedExpr>(expr.get())->value;
+
+  // Unchanged expressions stay shared
+  ReplaceNameWithExpr transformer;
+  expr = transformer.visit(std::move(expr));
+  auto ptr = vAST::dyn_cast<vAST::SharedExpr>(expr.get());
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(ptr->value, shared);
+
+  // Rewrites see through references
+  expr = interner.intern(vAST::make_binop(vAST::make_id("a"), vAST::BinOp::ADD,
+                                          vAST::make_id("x")));
+  expr = transformer.visit(std::move(expr));
+  EXPECT_EQ(expr->toString(), "a + (z - w)");
+}
+
+}  // namespace
@@ -0,0 +1,179 @@
+#include "verilogAST/symbol.hpp"
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "common.cpp"
+#include "gtest/gtest.h"
+#include "verilogAST/symbol_map.hpp"
+
+namespace vAST = verilogAST;
+
+namespace {
+
+TEST(SymbolTests, TestIntern) {
+  vAST::Symbol x("x");
+  vAST::Symbol y("y");
+  EXPECT_EQ(x, vAST::Symbol(std::string("x")));
+  EXPECT_NE(x, y);
+  EXPECT_EQ(x.id(), vAST::Symbol("x").id());
+  EXPECT_EQ(x.str(), "x");
+  EXPECT_EQ(vAST::SymbolTable::global().lookup(y.id()), y);
+  EXPECT_TRUE(x < y);
+  EXPECT_FALSE(y < x);
+  EXPECT_TRUE(vAST::Symbol().empty());
+  EXPECT_EQ(vAST::Symbol(), vAST::Symbol(""));
+
+  // Comparable with and assignable from strings
+  EXPECT_TRUE(x == "x");
+  EXPECT_TRUE("y" != x);
+  x = "y";
+  EXPECT_EQ(x, y);
+
+  std::unordered_set<vAST::Symbol> symbols{x, y, vAST::Symbol("z")};
+  EXPECT_EQ(symbols.size(), 2u);
+
+  // Identifiers hold interned names
+  auto id = vAST::make_id("x");
+  EXPECT_EQ(id->value, vAST::Symbol("x"));
+  id->value = "w";
+  EXPECT_EQ(id->toString(), "w");
+}
+
+TEST(SymbolTests, TestStringLike) {
+  auto id = vAST::make_id("x");
+  std::string name = id->value;
+  EXPECT_EQ(name, "x");
+  const std::string &ref = id->value;
+  EXPECT_EQ(&ref, &id->value.str());
+  EXPECT_EQ(id->value + "_1", "x_1");
+  EXPECT_EQ("_" + id->value, "_x");
+  EXPECT_EQ(name + id->value, "xx");
+  EXPECT_EQ(id->value + id->value, "xx");
+  EXPECT_EQ(id->value.size(), 1u);
+  EXPECT_EQ(id->value.length(), 1u);
+  EXPECT_EQ(id->value[0], 'x');
+  EXPECT_STREQ(id->value.c_str(), "x");
+  id->value = "abc";
+  EXPECT_EQ(std::string(id->value.begin(), id->value.end()), "abc");
+  EXPECT_EQ(id->value.substr(1), "bc");
+  EXPECT_EQ(id->value.find("c"), 2u);
+  std::string_view view = id->value;
+  EXPECT_EQ(view, "abc");
+}
+
+TEST(SymbolTests, TestScope) {
+  vAST::Symbol global("scoped");
+  auto table = std::make_unique<vAST::SymbolTable>();
+  {
+    vAST::SymbolTable::Scope scope(*table);
+    EXPECT_EQ(&vAST::SymbolTable::current(), table.get());
+    vAST::Symbol local("scoped");
+    EXPECT_NE(local, global);
+    EXPECT_EQ(local, vAST::Symbol("scoped"));
+    EXPECT_EQ(local.str(), "scoped");
+    // The empty symbol is shared
+    EXPECT_EQ(vAST::Symbol(""), vAST::Symbol());
+    EXPECT_EQ(table->size(), 1u);
+
+    // Same ids in different tables are different keys
+    vAST::SymbolTable first, second;
+    vAST::Symbol a = first.intern("a");
+    vAST::Symbol b = second.intern("b");
+    EXPECT_EQ(a.id(), b.id());
+    vAST::SymbolMap<int> map;
+    map[a] = 1;
+    map[b] = 2;
+    EXPECT_EQ(map.size(), 2u);
+    EXPECT_EQ(map[a], 1);
+    EXPECT_EQ(map[b], 2);
+    EXPECT_EQ(map.erase(a), 1u);
+    EXPECT_EQ(map.count(a), 0u);
+    EXPECT_EQ(map[b], 2);
+  }
+  EXPECT_EQ(&vAST::SymbolTable::current(), &vAST::SymbolTable::global());
+  table.reset();
+  EXPECT_EQ(vAST::Symbol("scoped"), global);
+}
+
+TEST(SymbolTests, TestThreads) {
+  vAST::SymbolTable table;
+  const int num_threads = 4;
+  const int num_symbols = 1000;
+  std::vector<std::vector<vAST::Symbol>> results(num_threads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&, i] {
+      for (int j = 0; j < num_symbols; j++) {
+        results[i].push_back(table.intern("s" + std::to_string(j)));
+      }
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  EXPECT_EQ(table.size(), static_cast<std::size_t>(num_symbols));
+  for (int i = 1; i < num_threads; i++) EXPECT_EQ(results[i], results[0]);
+  for (int j = 0; j < num_symbols; j++) {
+    EXPECT_EQ(results[0][j].str(), "s" + std::to_string(j));
+  }
+}
+
+TEST(SymbolTests, TestSymbolMap) {
+  vAST::SymbolMap<int> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(map.find(vAST::Symbol("x")), map.end());
+  map[vAST::Symbol("x")] = 1;
+  map[vAST::Symbol("y")]++;
+  EXPECT_TRUE(map.emplace(vAST::Symbol("z"), 3).second);
+  EXPECT_FALSE(map.emplace(vAST::Symbol("z"), 4).second);
+  EXPECT_EQ(map.size(), 3u);
+  EXPECT_EQ(map[vAST::Symbol("x")], 1);
+  EXPECT_EQ(map[vAST::Symbol("y")], 1);
+  EXPECT_EQ(map.find(vAST::Symbol("z"))->second, 3);
+  EXPECT_EQ(map.erase(vAST::Symbol("y")), 1u);
+  EXPECT_EQ(map.erase(vAST::Symbol("y")), 0u);
+  EXPECT_EQ(map.count(vAST::Symbol("y")), 0u);
+  int sum = 0;
+  for (auto &entry : map) sum += entry.second;
+  EXPECT_EQ(sum, 4);
+
+  vAST::SymbolSet set;
+  EXPECT_TRUE(set.insert(vAST::Symbol("x")));
+  EXPECT_FALSE(set.insert(vAST::Symbol("x")));
+  EXPECT_EQ(set.count(vAST::Symbol("x")), 1u);
+  EXPECT_EQ(*set.begin(), vAST::Symbol("x"));
+  set.clear();
+  EXPECT_EQ(set.count(vAST::Symbol("x")), 0u);
+  EXPECT_EQ(set.begin(), set.end());
+}
+
+TEST(SymbolTests, TestSymbolMapRandom) {
+  // Compare against std::unordered_map under random inserts and erases, so
+  // growing and backward shift deletion are exercised
+  std::mt19937 rng(0);
+  vAST::SymbolMap<int> map;
+  std::unordered_map<vAST::Symbol, int> expected;
+  for (int i = 0; i < 20000; i++) {
+    vAST::Symbol key("k" + std::to_string(rng() % 2000));
+    if (rng() % 3 == 0) {
+      EXPECT_EQ(map.erase(key), expected.erase(key));
+    } else {
+      map[key] += i;
+      expected[key] += i;
+    }
+  }
+  EXPECT_EQ(map.size(), expected.size());
+  std::size_t size = 0;
+  for (auto &entry : map) {
+    EXPECT_EQ(entry.second, expected.at(entry.first));
+    size++;
+  }
+  EXPECT_EQ(size, expected.size());
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -296,6 +296,39 @@ TEST(TransformerTests, File) {
   FileTransformer transformer;
   EXPECT_EQ(transformer.visit(std::move(file))->toString(), expected_str);
 }
+
+TEST(TransformerTests, TestNull) {
+  // Passes remove nodes by returning null, which is passed on as is
+  XtoZ transformer;
+  EXPECT_EQ(transformer.visit(std::unique_ptr<vAST::Expression>()), nullptr);
+  EXPECT_EQ(transformer.visit(std::unique_ptr<vAST::Declaration>()), nullptr);
+  EXPECT_EQ(transformer.visit(std::unique_ptr<vAST::BehavioralStatement>()),
+            nullptr);
+  EXPECT_EQ(transformer.visit(std::unique_ptr<vAST::AbstractPort>()), nullptr);
+  EXPECT_EQ(transformer.visit(std::unique_ptr<vAST::StructuralStatement>()),
+            nullptr);
+  EXPECT_EQ(transformer.visit(std::unique_ptr<vAST::AbstractModule>()),
+            nullptr);
+}
+
+TEST(TransformerTests, TestCustomNodes) {
+  // Nodes defined outside the library are passed on as they are
+  std::string expected_str =
+      "module test_module (\n"
+      "    input i,\n"
+      "    output o\n"
+      ");\n"
+      "`default_nettype none\n"
+      "assign z = z + ($time);\n"
+      "always @(posedge z) begin\n"
+      "$finish;\n"
+      "end\n"
+      "\n"
+      "endmodule\n";
+  XtoZ transformer;
+  EXPECT_EQ(transformer.visit(make_custom_node_module())->toString(),
+            expected_str);
+}
 }  // namespace
 
 int main(int argc, char **argv) {
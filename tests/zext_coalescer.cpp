@@ -15,6 +15,7 @@ auto makeVector(std::string name, int hi, int lo) {
                                         vAST::make_num(std::to_string(lo)));
 }
 
+template <typename Coalescer = vAST::ZextCoalescer>
 void runTest(std::vector<int> prefix,
              std::string pre,
              std::string post,
@@ -52,7 +53,7 @@ void runTest(std::vector<int> prefix,
   EXPECT_EQ(module->toString(), pre);
 
   // Run ZextCoalescer transformer.
-  vAST::ZextCoalescer transformer(elide);
+  Coalescer transformer(elide);
   module = transformer.visit(std::move(module));
 
   EXPECT_EQ(module->toString(), post);
@@ -94,6 +95,24 @@ TEST(ZextCoalescerTests, TestElide) {
   runTest({1, 2}, pre, post, true /* elide */);
 }
 
+TEST(ZextCoalescerTests, TestInPlace) {
+  auto pre =
+      "module test_module (\n"
+      "    input [7:0] I,\n"
+      "    output [7:0] O\n"
+      ");\n"
+      "assign O = {1'd0,2'd0,I[4:0]};\n"
+      "endmodule\n";
+  auto post =
+      "module test_module (\n"
+      "    input [7:0] I,\n"
+      "    output [7:0] O\n"
+      ");\n"
+      "assign O = {3'd0,I[4:0]};\n"
+      "endmodule\n";
+  runTest<vAST::ZextCoalescerInPlace>({1, 2}, pre, post);
+}
+
 TEST(ZextCoalescerTests, TestNoop) {
   auto pre =
       "module test_module (\n"
@@ -112,6 +131,22 @@ TEST(ZextCoalescerTests, TestNoop) {
   runTest({}, pre, post);
 }
 
+TEST(ZextCoalescerTests, TestRadix) {
+  // Zeros are recognized in any radix and width, x/z digits are not zeros
+  std::vector<std::unique_ptr<vAST::Expression>> args;
+  args.emplace_back(new vAST::NumericLiteral("0", 4, false, vAST::HEX));
+  args.emplace_back(new vAST::NumericLiteral("0000_0000", 8, false,
+                                             vAST::BINARY));
+  args.emplace_back(new vAST::NumericLiteral(std::string(30, '0'), 100,
+                                             false, vAST::DECIMAL));
+  args.emplace_back(new vAST::NumericLiteral("z", 2, false, vAST::BINARY));
+  args.push_back(vAST::make_id("I"));
+  vAST::ZextCoalescer transformer;
+  auto result = transformer.visit(
+      std::unique_ptr<vAST::Expression>(new vAST::Concat(std::move(args))));
+  EXPECT_EQ(result->toString(), "{112'd0,2'bz,I}");
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {